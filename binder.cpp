@@ -27,10 +27,12 @@
 
 #include <set>
 #include <fstream>
+#include <algorithm>
 
 #include "binder.h"
 
 #include "heli.h"
+#include "pick_queue.h"
 #include "config.h"
 #include "rtloc.h"
 #include "rtmag.h"
@@ -193,9 +195,10 @@ void quake_t :: LinkPick(const binder_pick_t & new_pick)
 	pair<binder_picks_set_t::iterator,bool> new_pick_result = picks.insert(new_pick);
 	bool new_pick_found = new_pick_result.second;
 
-	// FIXME: circumvent the fact we aren't allowed to change set elements
-	const_cast<pick_t *>(&new_pick_result.first->pick)->quake_id = id;
-	new_pick_result.first->heli->UpdatePick( new_pick_result.first->pick );
+	stations.Set(new_pick.heli->station->index);
+
+	// Shared with the heli pick, for display
+	new_pick_result.first->pick.Rec().quake_id = id;
 
 	// Exit on duplicate pick
 	if (!new_pick_found)
@@ -275,9 +278,27 @@ void binder_t :: SaveQuakeId()
 	f.close();
 }
 
-void binder_t :: Init()
+void binder_t :: Init(const vector<station_t *> & stations)
 {
 	LoadQuakeId();
+	InitStationPairs(stations);
+	arrival_index.assign(num_stations, arrival_index_t());
+
+	// Threads processing the quakes, besides the main one
+
+	int num_threads = int(param_binder_threads);
+	if (num_threads < 0)
+		num_threads = max(0, SDL_GetCPUCount() - 1);
+
+	pool.Start(num_threads, "binder");
+
+	for (size_t i = 0; i < workers_scratch.size(); i++)
+		delete workers_scratch[i];
+	workers_scratch.resize(pool.NumWorkers());
+	for (size_t i = 0; i < workers_scratch.size(); i++)
+		workers_scratch[i] = new binder_scratch_t();
+
+	cout << SecsToString(SecsNow()) << ": BINDER threads: " << pool.NumWorkers() << endl;
 }
 
 
@@ -358,21 +379,43 @@ binder_t binder;
 
 void binder_t :: Reset()
 {
+	PurgeLocJobs(true);
+
 	picks.clear();
 	quakes.clear();
+	for (size_t s = 0; s < arrival_index.size(); s++)
+		arrival_index[s].clear();
 	if (!realtime)
 		quake_id = 0;
 
 	secs_heartbeat_sent = secs_latencies_logged = SecsNow();
+	assoc_perf_ticks = 0;
+	assoc_perf_picks = 0;
 
 	Sound_Alarm()->Stop();
 	Sound_Shaking()->Stop();
 }
 
+// Wait for the worker threads (cancelling the locations in flight)
+void binder_t :: Stop()
+{
+	PurgeLocJobs(true);
+
+	pool.Stop();
+
+	for (list<loc_job_t *>::iterator j = loc_jobs.begin(); j != loc_jobs.end(); j++)
+		delete *j;
+	loc_jobs.clear();
+}
+
 binder_t :: binder_t()
 {
+	loc_mutex = SDL_CreateMutex();
 	quake_id = 0;
+	num_stations = 0;
 	secs_heartbeat_sent = secs_latencies_logged = 0;
+	assoc_perf_ticks = 0;
+	assoc_perf_picks = 0;
 }
 
 /*******************************************************************************
@@ -388,15 +431,19 @@ void binder_t :: PurgeOldPicks()
 
 	secs_t now = SecsNow();
 
-	binder_picks_set_t::iterator p = picks.begin();
-	while (p != picks.end())
-	{
-		if (abs(now - p->pick.t) > PICKS_MEMORY_MAX_SECS)
-//			p = picks.erase(p);	// requires c++11
-			picks.erase(p++);
-		else
-			++p;
-	}
+	// The picks are sorted by time: the old ones are at the front, those too far in the future at the back
+	while (!picks.empty() && (now - picks.begin()->pick.t > PICKS_MEMORY_MAX_SECS))
+		picks.erase(picks.begin());
+
+	while (!picks.empty() && (picks.rbegin()->pick.t - now > PICKS_MEMORY_MAX_SECS))
+		picks.erase(--picks.end());
+}
+
+// First pick in picks at or after time t (picks are sorted by time, see binder_pick_t::operator<)
+static binder_picks_set_t::iterator LowerBoundTime(binder_picks_set_t & picks, secs_t t)
+{
+	// A NULL heli sorts before any other pick with the same time. The key has no pick table record (no locking)
+	return picks.lower_bound( binder_pick_t(NULL, pick_t(t)) );
 }
 
 void binder_t :: PurgeOldQuakes()
@@ -410,72 +457,92 @@ void binder_t :: PurgeOldQuakes()
 	while (q != quakes.end())
 	{
 		if (abs(now - q->picks.begin()->pick.t) > QUAKES_MEMORY_MAX_SECS)
+		{
+			UnindexQuakeArrivals(*q);
 			q = quakes.erase( q );
+		}
 		else
 			++q;
 	}
 }
 
-// Return true if the apparent velocity measured between this pick and the input pick is within a physically possible range
-// (i.e. not much faster or slower than P-waves)
-bool binder_pick_t :: CheckApparentVel( const binder_pick_t & bp ) const
+// Precompute, for every pair of stations, the range of pick time differences with a physically possible apparent velocity
+// (station positions never change, so CheckApparentVel is just a table lookup)
+void binder_t :: InitStationPairs(const vector<station_t *> & stations)
 {
-	float dt = float(bp.pick.t - pick.t);
-	if (dt < 0.001f)
-		dt = 0.001f;
-
-	float dr = heli->station->Distance( *bp.heli->station );
+	const float never_min	=	 numeric_limits<float>::max();
+	const float never_max	=	-numeric_limits<float>::max();
 
-	// Do not associate picks too far away, even if they would match the highest apparent velocity at the longest time window.
-	// Useful for nation-wide networks
-	if (dr >= param_binder_apparent_vel_max_distance)
-		return false;
+	num_stations = stations.size();
+	pairs_dt.resize(num_stations * num_stations);
 
-	// Relax velocity checks when the distance between the two triggered stations is comparable
-	// to the inter-station distance of the network
-	if (dr <= param_binder_apparent_vel_stations_spacing)
+	for (size_t i = 0; i < num_stations; i++)
 	{
-//		if ( (dt >= -2.0f) && (dt <= 4.0f) )
-			return true;
-	}
+		for (size_t j = 0; j < num_stations; j++)
+		{
+			pair_dt_t & w = pairs_dt[stations[i]->index * num_stations + stations[j]->index];
 
-	// The apparent velocity can be slow, yet not as slow as S-waves, or fast,
-	// up to "simultaneous" arrival at many stations (deep/external events)
-	float vel = dr / dt;
-	if ( (vel >= param_binder_apparent_vel_min) && (vel <= param_binder_apparent_vel_max) )
-		return true;
+			float dr = stations[i]->Distance( *stations[j] );
 
-	return false;
+			// Do not associate picks too far away, even if they would match the highest apparent velocity at the longest time window.
+			// Useful for nation-wide networks
+			if (dr >= param_binder_apparent_vel_max_distance)
+			{
+				w.min	=	never_min;
+				w.max	=	never_max;
+			}
+			// Relax velocity checks when the distance between the two triggered stations is comparable
+			// to the inter-station distance of the network
+			else if (dr <= param_binder_apparent_vel_stations_spacing)
+			{
+				w.min	=	-numeric_limits<float>::max();
+				w.max	=	 numeric_limits<float>::max();
+			}
+			// The apparent velocity can be slow, yet not as slow as S-waves, or fast,
+			// up to "simultaneous" arrival at many stations (deep/external events)
+			else
+			{
+				w.min	=	float(dr / param_binder_apparent_vel_max);
+				w.max	=	(param_binder_apparent_vel_min > 0) ? float(dr / param_binder_apparent_vel_min) : numeric_limits<float>::max();
+			}
+		}
+	}
 }
 
-// Return true if the new pick falls within the association window, it has a compatible apparent velocity
-// and its station is not already in picks
-bool binder_t :: CheckPickAssoc(const binder_picks_set_t & picks, const binder_pick_t & new_pick, secs_t secs) const
+// Return true if the apparent velocity measured between the first pick and the input pick is within a physically possible range
+// (i.e. not much faster or slower than P-waves)
+bool binder_t :: CheckApparentVel( const binder_pick_t & first, const binder_pick_t & bp ) const
 {
-	secs_t dt = new_pick.pick.t - picks.begin()->pick.t;
+	float dt = float(bp.pick.t - first.pick.t);
+	if (dt < 0.001f)
+		dt = 0.001f;
 
-	if ( (dt >= 0) && (dt <= secs) && picks.begin()->CheckApparentVel(new_pick) )
-	{
-		// Check if the station of new_pick is already in picks
-		for (binder_picks_set_t :: iterator p = picks.begin(); p != picks.end(); ++p)
-		{
-			if ( p->heli == new_pick.heli )
-				return false;
-		}
+	const pair_dt_t & w = pairs_dt[first.heli->station->index * num_stations + bp.heli->station->index];
 
-		return true;
-	}
+	return (dt >= w.min) && (dt <= w.max);
+}
 
-	return false;
+// Return true if the new pick falls within the association window of the first pick of a set, it has a compatible
+// apparent velocity and its station is not already in the set (stations holds the stations of the set)
+bool binder_t :: CheckPickAssoc(const binder_pick_t & first, const station_bits_t & stations, const binder_pick_t & new_pick, secs_t secs) const
+{
+	secs_t dt = new_pick.pick.t - first.pick.t;
+
+	return	(dt >= 0) && (dt <= secs) &&
+			!stations.Test(new_pick.heli->station->index) &&
+			CheckApparentVel(first, new_pick);
 }
 
 // Link picks in the association window (of secs duration) of quake q
 void binder_t :: LinkAssocPicks(quake_t & q, secs_t secs)
 {
-	binder_picks_set_t::iterator p = picks.begin();
-	while (p != picks.end())
+	// Only picks from the first quake pick to secs later can be associated (linking them does not change the first pick)
+	secs_t t0 = q.picks.begin()->pick.t;
+
+	binder_picks_set_t::iterator p = LowerBoundTime(picks, t0);
+	while ( (p != picks.end()) && (p->pick.t - t0 <= secs) )
 	{
-		if ( CheckPickAssoc(q.picks, *p, secs) )
+		if ( CheckPickAssoc(*q.picks.begin(), q.stations, *p, secs) )
 		{
 			q.LinkPick(*p);
 			// Remove pick from not linked ones
@@ -498,7 +565,8 @@ void binder_t :: FindCoincPicks(const binder_pick_t & new_pick, const quake_t *q
 	// Allow multiple picks from the same station (we'll be able to choose the best one later)
 	secs_t quake_t_min = ((q == NULL) ? 0 : q->picks.rbegin()->pick.t - param_binder_secs_for_association);	// ignore picks too early for q
 	vector<binder_picks_set_t::iterator> near_picks_iter;
-	for (binder_picks_set_t :: iterator p = picks.begin(); p != picks.end(); ++p)
+	binder_picks_set_t :: iterator p = LowerBoundTime(picks, max(quake_t_min, new_pick.pick.t - param_binder_secs_for_coincidence));
+	for ( ; (p != picks.end()) && (p->pick.t - new_pick.pick.t < param_binder_secs_for_coincidence); ++p)
 	{
 		if ( p->pick.t >= quake_t_min && abs(new_pick.pick.t - p->pick.t) < param_binder_secs_for_coincidence )
 			near_picks_iter.push_back(p);
@@ -506,66 +574,247 @@ void binder_t :: FindCoincPicks(const binder_pick_t & new_pick, const quake_t *q
 
 	// Find the largest set of picks in the coincidence window, with compatible apparent velocity (from the first pick in the set),
 	// that contains enough picks to declare a new quake. Include picks from q if not NULL.
+	// Each near pick (in time order) is tried as the first one of a set.
 	best_picks_iter.clear();
-	while (!near_picks_iter.empty())
+
+	const int min_picks		=	int(param_binder_stations_for_coincidence);
+	const size_t num_near	=	near_picks_iter.size();
+	const size_t num_q		=	(q == NULL) ? 0 : q->picks.size();
+
+	vector<binder_picks_set_t::iterator> good_picks_iter;
+	station_bits_t good_stations;
+
+	size_t last = 0;	// one past the last near pick in the coincidence window of the current first pick
+	for (size_t first_i = 0; first_i < num_near; first_i++)
 	{
-		// "Good" picks satisfy the apparent velocity and coincidence criteria
-		binder_picks_set_t good_picks;
-		good_picks.clear();
-		good_picks.insert(*near_picks_iter.front());
+		const binder_pick_t & first_pick = *near_picks_iter[first_i];
+
+		// Later near picks can only join the set if they lie in the coincidence window of the first pick.
+		// The window slides forward with the first pick
+		if (last <= first_i)
+			last = first_i + 1;
+		while ( (last < num_near) && (near_picks_iter[last]->pick.t - first_pick.pick.t <= param_binder_secs_for_coincidence) )
+			++last;
+
+		// Skip the first pick if even accepting all the candidates (no apparent velocity checks)
+		// would not give a set large enough to replace the best one
+		size_t max_good = (last - first_i) + num_q;
+		if ( (int(max_good) < min_picks) || (max_good <= best_picks_iter.size()) )
+			continue;
+
+		// "Good" picks satisfy the apparent velocity and coincidence criteria.
+		// Only their earliest pick (the reference for the checks), their stations and their number are needed
+		const binder_pick_t *first = &first_pick;
+		size_t num_good = 1;
+
+		good_stations.Clear();
+		good_stations.Set(first_pick.heli->station->index);
 
-		vector<binder_picks_set_t::iterator> good_picks_iter;
 		good_picks_iter.clear();
-		good_picks_iter.push_back(near_picks_iter.front());
+		good_picks_iter.push_back(near_picks_iter[first_i]);
 
 		// Check compatibility of all the current quake picks with the first good pick
 		if (q != NULL)
 		{
-			binder_picks_set_t :: iterator qp;
+			binder_picks_set_t :: const_iterator qp;
 			for (qp = q->picks.begin(); qp != q->picks.end(); ++qp)
 			{
-				if (CheckPickAssoc(good_picks, *qp, param_binder_secs_for_coincidence))
+				if (CheckPickAssoc(*first, good_stations, *qp, param_binder_secs_for_coincidence))
+				{
 					// Do not insert into good_picks_iter as the container is different (q->picks instead of picks).
 					// Also, we don't want to link the quake picks again.
-					good_picks.insert(*qp);
-				else if (!CheckPickAssoc(good_picks, *qp, param_binder_secs_for_association))
+					if (*qp < *first)
+						first = &*qp;
+					good_stations.Set(qp->heli->station->index);
+					++num_good;
+				}
+				else if (!CheckPickAssoc(*first, good_stations, *qp, param_binder_secs_for_association))
 					break;
 			}
 			if (qp != q->picks.end())
-			{
-				near_picks_iter.erase(near_picks_iter.begin());
 				continue;
-			}
 		}
 
 		// Enlarge the set of good picks with compatible not linked picks
-		for (vector<binder_picks_set_t::iterator>::iterator np = ++near_picks_iter.begin(); np != near_picks_iter.end(); ++np)
+		for (size_t np = first_i + 1; np < last; np++)
 		{
-			if ( CheckPickAssoc(good_picks, **np, param_binder_secs_for_coincidence) )
+			if ( CheckPickAssoc(*first, good_stations, *near_picks_iter[np], param_binder_secs_for_coincidence) )
 			{
-				good_picks.insert(**np);
-				good_picks_iter.push_back(*np);
+				good_stations.Set(near_picks_iter[np]->heli->station->index);
+				good_picks_iter.push_back(near_picks_iter[np]);
+				++num_good;
 			}
 		}
 
 		// The largest set of good picks that satisfies the coincidence criteria is the best one
 		// (prefer the previous set in case of a tie: it contains earlier picks)
-		if ( (good_picks.size() >= int(param_binder_stations_for_coincidence)) && (good_picks.size() > best_picks_iter.size()) )
+		if ( (int(num_good) >= min_picks) && (num_good > best_picks_iter.size()) )
 			best_picks_iter = good_picks_iter;
+	}
+}
+
+// Return the difference between the pick time and the P arrival predicted by the current location of q,
+// or -1 if there is no prediction (quake not located yet, or outside the travel time grids)
+float binder_t :: ArrivalResidual(const quake_t & q, const binder_pick_t & bp) const
+{
+	size_t index = size_t(bp.heli->station->index);
+	if (index >= q.arrivals.size())
+		return -1;
+
+	float ttime = q.arrivals[index];
+	if (ttime < 0)
+		return -1;
+
+	return float(abs(bp.pick.t - (q.origin.time + secs_t(ttime))));
+}
 
-		// Try checking apparent velocities using the next pick as first pick
-		near_picks_iter.erase(near_picks_iter.begin());
+// Predict the P arrivals of the current origin of q at all the stations (one travel time grid read per station,
+// instead of one per pick and quake when binding). Runs on any worker thread: it only writes to q
+void binder_t :: CalcQuakeArrivals(quake_t & q, const vector<station_t *> & stations) const
+{
+	q.arrivals.clear();
+	q.arrivals_changed = true;
+
+	if (!q.origin.time)
+		return;
+
+	q.arrivals.resize(num_stations, -1);
+
+	for (vector<station_t *>::const_iterator s = stations.begin(); s != stations.end(); ++s)
+		q.arrivals[(*s)->index] = (*s)->CalcTravelTime('P', q.origin);
+}
+
+void binder_t :: UnindexQuakeArrivals(quake_t & q)
+{
+	for (size_t s = 0; s < q.arrival_keys.size(); s++)
+	{
+		if (!q.arrival_keys[s])
+			continue;
+
+		pair<arrival_index_t::iterator, arrival_index_t::iterator> range = arrival_index[s].equal_range(q.arrival_keys[s]);
+		for (arrival_index_t::iterator i = range.first; i != range.second; ++i)
+		{
+			if (i->second == q.id)
+			{
+				arrival_index[s].erase(i);
+				break;
+			}
+		}
+	}
+
+	q.arrival_keys.clear();
+}
+
+void binder_t :: IndexQuakeArrivals(quake_t & q)
+{
+	UnindexQuakeArrivals(q);
+	q.arrivals_changed = false;
+
+	if (q.arrivals.empty())
+		return;
+
+	q.arrival_keys.assign(q.arrivals.size(), 0);
+	for (size_t s = 0; s < q.arrivals.size() && s < arrival_index.size(); s++)
+	{
+		if (q.arrivals[s] < 0)
+			continue;
+
+		q.arrival_keys[s] = q.origin.time + secs_t(q.arrivals[s]);
+		arrival_index[s].insert( arrival_index_t::value_type(q.arrival_keys[s], q.id) );
+	}
+}
+
+// Quakes are sorted by id
+struct QuakeIdLess
+{
+	bool operator () (const quake_t & q, int id) const
+	{
+		return q.id < id;
+	}
+};
+
+quake_t *binder_t :: FindQuake(int id)
+{
+	vector<quake_t>::iterator q = lower_bound(quakes.begin(), quakes.end(), id, QuakeIdLess());
+	return (q != quakes.end() && q->id == id) ? &*q : NULL;
+}
+
+// Return the live quake whose predicted P arrival at the station of the pick is closest to the pick time,
+// within binder_secs_for_arrival, or NULL if none. Quakes already having a pick from that station, or with
+// an impossible apparent velocity between their first pick and the new one, are skipped.
+// Only the quakes predicting an arrival within binder_secs_for_arrival are looked at (see arrival_index)
+quake_t *binder_t :: FindQuakeByArrival(const binder_pick_t & bp)
+{
+	size_t index = size_t(bp.heli->station->index);
+	if (!param_binder_secs_for_arrival || index >= arrival_index.size())
+		return NULL;
+
+	secs_t secs_live = SecsNow() - param_binder_quakes_life;
+
+	quake_t *best_q = NULL;
+	float best_residual = 0;
+
+	arrival_index_t & station_index = arrival_index[index];
+	arrival_index_t::iterator i		=	station_index.lower_bound(bp.pick.t - param_binder_secs_for_arrival);
+	arrival_index_t::iterator end	=	station_index.upper_bound(bp.pick.t + param_binder_secs_for_arrival);
+	for ( ; i != end; ++i)
+	{
+		quake_t *q = FindQuake(i->second);
+		if ( (q == NULL) || (q->secs_creation < secs_live) )
+			continue;
+
+		if (q->stations.Test(index))
+			continue;
+
+		float residual = float(abs(bp.pick.t - i->first));
+
+		const binder_pick_t & first = *q->picks.begin();
+		if ( !((bp.pick.t >= first.pick.t) ? CheckApparentVel(first, bp) : CheckApparentVel(bp, first)) )
+			continue;
+
+		if ( (best_q == NULL) || (residual < best_residual) )
+		{
+			best_q			=	q;
+			best_residual	=	residual;
+		}
 	}
+
+	return best_q;
+}
+
+// Return true if q could explain any of the picks, i.e. q is not located yet
+// or any pick is close to the P arrival predicted by its location
+bool binder_t :: FitsArrivals(const quake_t & q, const vector<binder_picks_set_t::iterator> & picks_iter) const
+{
+	if (!param_binder_secs_for_arrival)
+		return true;
+
+	bool predicted = false;
+	for (vector<binder_picks_set_t::iterator>::const_iterator p = picks_iter.begin(); p != picks_iter.end(); ++p)
+	{
+		float residual = ArrivalResidual(q, **p);
+		if (residual < 0)
+			continue;
+
+		predicted = true;
+		if (residual <= param_binder_secs_for_arrival)
+			return true;
+	}
+
+	return !predicted;
 }
 
 /*
 	Run binding algorithm on the new pick:
 		- Insert the new pick in the list of not linked picks.
+		- Link the new pick to an earlier live quake if it fits the P arrival
+		  predicted by its location better than the last quake.
 		- Link the new pick to the last quake if within the association window,
 		  and with compatible apparent velocity.
 		- Declare a new quake if enough picks lie in the coincidence window,
 		  all with compatible apparent velocity, and no other quake occurred
-		  within quake_life seconds from the new one.
+		  within quake_life seconds from the new one (unless its location
+		  does not explain those picks).
 
 	Note: keep in mind picks are not received in time order due to latency/concurrency.
 */
@@ -584,6 +833,31 @@ bool binder_t :: AddAndLinkPick(const binder_pick_t & new_pick, int *res_quake_i
 
 	cout << SecsToString(SecsNow()) << ": PICK " << new_pick.heli->station->name << " " << new_pick.pick << endl;
 
+	// Try to link the new pick to an earlier live quake, based on the predicted arrivals
+	// (e.g. late picks of a quake while another one is in progress). The last quake is handled below
+	quake_t *arrival_q = FindQuakeByArrival(new_pick);
+	if ( (arrival_q != NULL) && (arrival_q != &quakes.back()) )
+	{
+		arrival_q->LinkPick(new_pick);
+		// Remove pick from not linked ones
+		picks.erase(new_pick_result.first);
+
+		*res_quake_id = arrival_q->id;
+		quake_found = true;
+	}
+	else
+		quake_found = LinkPickToLastOrNewQuake(new_pick, new_pick_result.first, res_quake_id);
+
+	PurgeOldPicks();
+
+	return quake_found;
+}
+
+// Link a new pick (new_pick_iter in the not linked picks) to the last quake, or declare a new quake (see AddAndLinkPick)
+bool binder_t :: LinkPickToLastOrNewQuake(const binder_pick_t & new_pick, binder_picks_set_t::iterator new_pick_iter, int *res_quake_id)
+{
+	bool quake_found = false;
+
 	// Try to link the new pick to the last quake
 	vector<binder_picks_set_t::iterator> best_picks_iter;
 
@@ -597,12 +871,12 @@ bool binder_t :: AddAndLinkPick(const binder_pick_t & new_pick, int *res_quake_i
 		bool coinc = !best_picks_iter.empty();
 
 		// Otherwise check the association window from the first linked pick
-		bool assoc = !coinc && CheckPickAssoc(q.picks, new_pick, param_binder_secs_for_association);
+		bool assoc = !coinc && CheckPickAssoc(*q.picks.begin(), q.stations, new_pick, param_binder_secs_for_association);
 		if (assoc)
 		{
 			q.LinkPick(new_pick);
 			// Remove pick from not linked ones
-			picks.erase(new_pick_result.first);
+			picks.erase(new_pick_iter);
 		}
 
 		if (assoc || coinc)
@@ -632,8 +906,10 @@ bool binder_t :: AddAndLinkPick(const binder_pick_t & new_pick, int *res_quake_i
 	FindCoincPicks(new_pick, NULL, best_picks_iter);
 	if ( !best_picks_iter.empty() )
 	{
-		// Do not declare a new quake it is too close in time to the last declared one (either before or after)
-		if ( quakes.empty() || (abs(best_picks_iter.front()->pick.t - quakes.back().picks.begin()->pick.t) > param_binder_quakes_separation) )
+		// Do not declare a new quake it is too close in time to the last declared one (either before or after),
+		// unless the location of the last one does not explain any of the new picks
+		if ( quakes.empty() || (abs(best_picks_iter.front()->pick.t - quakes.back().picks.begin()->pick.t) > param_binder_quakes_separation) ||
+		     !FitsArrivals(quakes.back(), best_picks_iter) )
 		{
 			// New quake
 			quake_found = true;
@@ -660,8 +936,6 @@ bool binder_t :: AddAndLinkPick(const binder_pick_t & new_pick, int *res_quake_i
 		}
 	}
 
-	PurgeOldPicks();
-
 	return quake_found;
 }
 
@@ -707,14 +981,16 @@ secs_t binder_t :: SecsFromBrokerConnection()
 
 *******************************************************************************/
 
-bool binder_t :: CalcQuakeLoc( quake_t & q )
+// Locate the picks of a quake (on any thread). Return false if cancelled
+bool binder_t :: CalcQuakeLoc( const binder_picks_set_t & q_picks, origin_t *res, vector<float> *picks_rms, SDL_atomic_t *cancel, NodeArena *arena )
 {
-	q.secs_located = SecsNow();
-
 	origin_t o(0,0,0);
 
 	if ( float(param_locate_force_lon) == sac_header_t::UNDEF || float(param_locate_force_lat) == sac_header_t::UNDEF || float(param_locate_force_dep) == sac_header_t::UNDEF )
-		rtloc.Locate( q, &o );
+	{
+		if ( !rtloc.Locate( q_picks, &o, picks_rms, cancel, arena ) )
+			return false;
+	}
 
 	if ( float(param_locate_force_lon) != sac_header_t::UNDEF || float(param_locate_force_lat) != sac_header_t::UNDEF || float(param_locate_force_dep) != sac_header_t::UNDEF )
 	{
@@ -738,10 +1014,10 @@ bool binder_t :: CalcQuakeLoc( quake_t & q )
 
 		// Average origin time over stations
 		o.time = 0;
-		binder_picks_set_t::const_iterator bp = q.picks.begin(), end = q.picks.end();
+		binder_picks_set_t::const_iterator bp = q_picks.begin(), end = q_picks.end();
 		for (; bp != end; bp++)
 			o.time += bp->pick.t - secs_t(rtloc.TravelTime(bp->heli->station->name,'P',o.lon,o.lat,o.dep));
-		o.time /= q.picks.size();
+		o.time /= q_picks.size();
 	}
 
 	// Round to 4 decimal digits
@@ -750,9 +1026,129 @@ bool binder_t :: CalcQuakeLoc( quake_t & q )
 	o.dep = RoundToInt(o.dep*10000)/10000.0f;
 	// o.time?
 
+	*res = o;
+	return true;
+}
+
+void binder_t :: LocateQuake_JobFunc(void *loc_job_ptr, int worker)
+{
+	loc_job_t *job = (loc_job_t *)loc_job_ptr;
+
+	// Each worker runs one search at a time, so its arena is reused by all of them
+	bool located = CalcQuakeLoc( job->picks, &job->origin, &job->picks_rms, &job->cancel, &job->binder->workers_scratch[worker]->loc_arena );
+
+	SDL_LockMutex(job->binder->loc_mutex);
+	job->located	=	located;
+	job->done		=	true;
+	SDL_UnlockMutex(job->binder->loc_mutex);
+}
+
+/*
+	Locations are searched asynchronously on the worker pool, so that a long search does not hold back
+	the binder. Each request is given the next generation number of the quake and a copy of its picks,
+	and only the result of the latest request is used. Meanwhile the quake keeps its last origin for
+	magnitude and alarms.
+	New picks normally wait for the search in flight to finish (the quake is then marked as pending and
+	requested again): cancelling it on every new pick would never let the first origin out during a burst
+	of picks. A located quake cancels its search in flight (it stops early) only when its picks have doubled
+	since, so that a search is restarted at most a few times. Periodic relocations (no new picks) just wait.
+*/
+void binder_t :: RequestQuakeLoc( quake_t & q, bool has_new_picks )
+{
+	SDL_LockMutex(loc_mutex);
+
+	loc_job_t *in_flight = NULL;
+	for (list<loc_job_t *>::iterator j = loc_jobs.begin(); j != loc_jobs.end(); j++)
+	{
+		if ( (*j)->quake_id != q.id || (*j)->done || SDL_AtomicGet(&(*j)->cancel) )
+			continue;
+
+		in_flight = *j;
+	}
+
+	if (in_flight)
+	{
+		bool restart = has_new_picks && q.secs_located && ( q.picks.size() >= 2 * in_flight->picks.size() );
+
+		if (!restart)
+		{
+			if (has_new_picks)
+				q.loc_pending = true;
+
+			SDL_UnlockMutex(loc_mutex);
+			return;
+		}
+
+		SDL_AtomicSet(&in_flight->cancel, 1);
+	}
+
+	loc_job_t *job = new loc_job_t();
+	job->binder		=	this;
+	job->quake_id	=	q.id;
+	job->generation	=	++q.loc_generation;
+	job->picks		=	q.picks;
+	job->done		=	false;
+	job->located	=	false;
+	SDL_AtomicSet(&job->cancel, 0);
+
+	loc_jobs.push_back(job);
+
+	SDL_UnlockMutex(loc_mutex);
+
+	q.secs_loc_requested = SecsNow();
+	q.loc_pending = false;
+
+	pool.Submit( LocateQuake_JobFunc, job );
+}
+
+// Pick up the finished locations of a quake. Return true if the latest one changed its origin
+// (the predicted arrivals are then updated too)
+bool binder_t :: CollectQuakeLoc( quake_t & q, const vector<station_t *> & stations )
+{
+	bool located = false;
+	origin_t o(0,0,0);
+
+	SDL_LockMutex(loc_mutex);
+
+	for (list<loc_job_t *>::iterator j = loc_jobs.begin(); j != loc_jobs.end(); )
+	{
+		loc_job_t *job = *j;
+
+		if ( job->quake_id != q.id || !job->done )
+		{
+			++j;
+			continue;
+		}
+
+		if ( job->located && job->generation == q.loc_generation && !SDL_AtomicGet(&job->cancel) )
+		{
+			located	=	true;
+			o		=	job->origin;
+
+			// The pick records are shared by overlapping searches of the quake, so they are only written here
+			if ( job->picks_rms.size() == job->picks.size() )
+			{
+				binder_picks_set_t::const_iterator p = job->picks.begin();
+				for (size_t i = 0; i < job->picks_rms.size(); i++, p++)
+					p->pick.Rec().quake_rms = job->picks_rms[i];
+			}
+		}
+
+		delete job;
+		j = loc_jobs.erase(j);
+	}
+
+	SDL_UnlockMutex(loc_mutex);
+
+	if (!located)
+		return false;
+
+	q.secs_located = SecsNow();
+
 	if (o != q.origin)
 	{
 		q.origin = o;
+		CalcQuakeArrivals( q, stations );
 //		Do not log magnitude yet. Otherwise we log the magnitude of the previous location
 //		which is plain wrong if the location has changed much.
 //		LogQuake( q, true );
@@ -764,16 +1160,44 @@ bool binder_t :: CalcQuakeLoc( quake_t & q )
 	return false;
 }
 
+// Cancel the locations of the quakes that are gone (or all of them), and free the finished ones
+void binder_t :: PurgeLocJobs( bool cancel_all )
+{
+	SDL_LockMutex(loc_mutex);
+
+	for (list<loc_job_t *>::iterator j = loc_jobs.begin(); j != loc_jobs.end(); )
+	{
+		loc_job_t *job = *j;
+
+		// Quakes can be purged from anywhere in the list (see PurgeOldQuakes)
+		bool quake_gone = (FindQuake(job->quake_id) == NULL);
+		if (cancel_all || quake_gone)
+			SDL_AtomicSet(&job->cancel, 1);
+
+		if ( job->done && SDL_AtomicGet(&job->cancel) )
+		{
+			delete job;
+			j = loc_jobs.erase(j);
+		}
+		else
+			++j;
+	}
+
+	SDL_UnlockMutex(loc_mutex);
+}
+
 /*******************************************************************************
 
 	binder_t - CalcQuakeMag
 
 *******************************************************************************/
 
-bool binder_t :: CalcQuakeMag( quake_t & q )
+bool binder_t :: CalcQuakeMag( quake_t & q, binder_scratch_t & scratch )
 {
 	//	Magnitude has to be always updated (new quake location, new picks, new signal)
 
+	rtmag_t & rtmag = scratch.rtmag;
+
 	// Calc the event magnitude from the displacement at each station
 
 	float mag_p, mag_s, mag, mag_min, mag_max;
@@ -802,31 +1226,27 @@ bool binder_t :: CalcQuakeMag( quake_t & q )
 		{
 			float sta_ms = -1, sta_mp = -1;
 
-			// Magnitudes
-			// FIXME: circumvent the fact we aren't allowed to change set elements
-			if ( CalcAndAddAllPickMagnitudes( magfilt, *const_cast<binder_pick_t *>(&(*p)), q.origin, rtmag_log ) )
+			// Magnitudes (stored in the pick record, shared with the heli pick for display)
+			if ( CalcAndAddAllPickMagnitudes( magfilt, *p, q.origin, rtmag_log, scratch ) )
 				hasNewWindow = true;
 
-			// Store the updated parameters in the heli pick for display
-			p->heli->UpdatePick( p->pick );
-
 			// MS
-			if (p->pick.quake_mag[MAG_S] != -1)
+			if (p->pick.Rec().quake_mag[MAG_S] != -1)
 			{
-				sta_ms = p->pick.quake_mag[MAG_S];
+				sta_ms = p->pick.Rec().quake_mag[MAG_S];
 				++num_s;
 			}
 
 			// FIXME: review
 			// MP - Use P_SHORT if it's less than 5 else P_LONG
-			if (p->pick.quake_mag[MAG_P_SHORT] != -1 && ((p->pick.quake_mag[MAG_P_SHORT] < 5) || (p->pick.quake_mag[MAG_P_LONG] == -1)))
+			if (p->pick.Rec().quake_mag[MAG_P_SHORT] != -1 && ((p->pick.Rec().quake_mag[MAG_P_SHORT] < 5) || (p->pick.Rec().quake_mag[MAG_P_LONG] == -1)))
 			{
-				sta_mp = p->pick.quake_mag[MAG_P_SHORT];
+				sta_mp = p->pick.Rec().quake_mag[MAG_P_SHORT];
 				++num_p;
 			}
-			else if (p->pick.quake_mag[MAG_P_LONG] != -1)
+			else if (p->pick.Rec().quake_mag[MAG_P_LONG] != -1)
 			{
-				sta_mp = p->pick.quake_mag[MAG_P_LONG];
+				sta_mp = p->pick.Rec().quake_mag[MAG_P_LONG];
 				++num_p;
 			}
 
@@ -907,18 +1327,18 @@ bool binder_t :: CalcQuakeMag( quake_t & q )
 
 		for (binder_picks_set_t::iterator p = q.picks.begin(); p != q.picks.end(); p++)
 		{
-			if ( (p->pick.quake_mag[MAG_P_SHORT] != -1) || (p->pick.quake_mag[MAG_P_LONG] != -1) || (p->pick.quake_mag[MAG_S] != -1) )
+			if ( (p->pick.Rec().quake_mag[MAG_P_SHORT] != -1) || (p->pick.Rec().quake_mag[MAG_P_LONG] != -1) || (p->pick.Rec().quake_mag[MAG_S] != -1) )
 			{
 				q.mail_log += SecsToString(SecsNow()) + ": MAG " + p->heli->station->name;
 
-				if (p->pick.quake_mag[MAG_P_SHORT] != -1)
-					q.mail_log += " " +  rtmag.GetLabel(MAG_P_SHORT) + ": " + MagToString(p->pick.quake_mag[MAG_P_SHORT]);
+				if (p->pick.Rec().quake_mag[MAG_P_SHORT] != -1)
+					q.mail_log += " " +  rtmag.GetLabel(MAG_P_SHORT) + ": " + MagToString(p->pick.Rec().quake_mag[MAG_P_SHORT]);
 
-				if (p->pick.quake_mag[MAG_P_LONG] != -1)
-					q.mail_log += " " +  rtmag.GetLabel(MAG_P_LONG)  + ": " + MagToString(p->pick.quake_mag[MAG_P_LONG]);
+				if (p->pick.Rec().quake_mag[MAG_P_LONG] != -1)
+					q.mail_log += " " +  rtmag.GetLabel(MAG_P_LONG)  + ": " + MagToString(p->pick.Rec().quake_mag[MAG_P_LONG]);
 
-				if (p->pick.quake_mag[MAG_S] != -1)
-					q.mail_log += " " +  rtmag.GetLabel(MAG_S)       + ": " + MagToString(p->pick.quake_mag[MAG_S]);
+				if (p->pick.Rec().quake_mag[MAG_S] != -1)
+					q.mail_log += " " +  rtmag.GetLabel(MAG_S)       + ": " + MagToString(p->pick.Rec().quake_mag[MAG_S]);
 
 				q.mail_log += "\n";
 			}
@@ -942,8 +1362,10 @@ inline void logDISP( stringstream & rtmag_log, station_t *station, const string
 				<< endl;
 }
 
-bool binder_t :: CalcAndAddPickMagnitude( magfilt_t magfilt, magtype_t magtype, binder_pick_t & bp, const origin_t & origin, stringstream & rtmag_log )
+bool binder_t :: CalcAndAddPickMagnitude( magfilt_t magfilt, magtype_t magtype, const binder_pick_t & bp, const origin_t & origin, stringstream & rtmag_log, binder_scratch_t & scratch )
 {
+	rtmag_t & rtmag = scratch.rtmag;
+
 	bool hasNewWindow =	false;
 
 	float duration = rtmag.GetDuration(magtype);
@@ -961,12 +1383,12 @@ bool binder_t :: CalcAndAddPickMagnitude( magfilt_t magfilt, magtype_t magtype,
 	switch (magfilt)
 	{
 		case MAGFILT_LOW:
-			bp.heli->station->CalcPeakDisplacement( float(param_magnitude_low_fmin),  float(param_magnitude_low_fmax),  rtmag.GetLabel(magtype) + " LOW",  rtmag.GetComponents(magtype), bp.pick.t + delay, duration, &disp,  &disp_time  );
+			bp.heli->station->CalcPeakDisplacement( float(param_magnitude_low_fmin),  float(param_magnitude_low_fmax),  rtmag.GetLabel(magtype) + " LOW",  rtmag.GetComponents(magtype), bp.pick.t + delay, duration, &disp,  &disp_time, scratch.bufs );
 			label += " LOW";
 			break;
 
 		case MAGFILT_HIGH:
-			bp.heli->station->CalcPeakDisplacement( float(param_magnitude_high_fmin), float(param_magnitude_high_fmax), rtmag.GetLabel(magtype) + " HIGH", rtmag.GetComponents(magtype), bp.pick.t + delay, duration, &disp, &disp_time );
+			bp.heli->station->CalcPeakDisplacement( float(param_magnitude_high_fmin), float(param_magnitude_high_fmax), rtmag.GetLabel(magtype) + " HIGH", rtmag.GetComponents(magtype), bp.pick.t + delay, duration, &disp, &disp_time, scratch.bufs );
 			label += " HIGH";
 			break;
 	}
@@ -979,7 +1401,7 @@ bool binder_t :: CalcAndAddPickMagnitude( magfilt_t magfilt, magtype_t magtype,
 		rtloc.DistanceWithError( bp.heli->station->name, origin, &distance, &distance_err);
 		mag = rtmag.Mag( magtype, disp, distance );
 
-		float snr = bp.heli->station->CalcPickSNR(rtmag.GetComponents(magtype), bp.pick.t, 10.0f, delay, duration);
+		float snr = bp.heli->station->CalcPickSNR(rtmag.GetComponents(magtype), bp.pick.t, 10.0f, delay, duration, scratch.bufs);
 		logDISP( rtmag_log, bp.heli->station, label, mag, disp, disp_time, bp.pick.t + delay, distance, distance_err, snr );
 
 		if (snr == -1 || snr >= float(param_waveform_min_snr))
@@ -993,14 +1415,16 @@ bool binder_t :: CalcAndAddPickMagnitude( magfilt_t magfilt, magtype_t magtype,
 		}
 	}
 
-	hasNewWindow				=	(bp.pick.disp[magtype] != disp);
-	bp.pick.disp[magtype]		=	disp;
-	bp.pick.quake_mag[magtype]	=	mag;
+	pick_rec_t & rec = bp.pick.Rec();
+
+	hasNewWindow			=	(rec.disp[magtype] != disp);
+	rec.disp[magtype]		=	disp;
+	rec.quake_mag[magtype]	=	mag;
 
 	return hasNewWindow;
 }
 
-bool binder_t :: CalcAndAddAllPickMagnitudes( magfilt_t magfilt, binder_pick_t & bp, const origin_t & origin, stringstream & rtmag_log )
+bool binder_t :: CalcAndAddAllPickMagnitudes( magfilt_t magfilt, const binder_pick_t & bp, const origin_t & origin, stringstream & rtmag_log, binder_scratch_t & scratch )
 {
 	// Continuously update the magnitudes, in case one of the components arrives later than the others
 
@@ -1008,7 +1432,7 @@ bool binder_t :: CalcAndAddAllPickMagnitudes( magfilt_t magfilt, binder_pick_t &
 
 	// S-waves
 	if (param_magnitude_s_secs)
-		hasNewS = CalcAndAddPickMagnitude( magfilt, MAG_S, bp, origin, rtmag_log );
+		hasNewS = CalcAndAddPickMagnitude( magfilt, MAG_S, bp, origin, rtmag_log, scratch );
 
 	// Skip any P time window that overlaps the S time window, unless told to ignore the overlapping
 
@@ -1016,11 +1440,11 @@ bool binder_t :: CalcAndAddAllPickMagnitudes( magfilt_t magfilt, binder_pick_t &
 
 	// P-waves (short)
 	if ( param_magnitude_p_secs_short && (!param_magnitude_s_secs || s_delay >= (float)param_magnitude_p_secs_short || param_magnitude_p_can_overlap_s) )
-		hasNewPShort = CalcAndAddPickMagnitude( magfilt, MAG_P_SHORT, bp, origin, rtmag_log );
+		hasNewPShort = CalcAndAddPickMagnitude( magfilt, MAG_P_SHORT, bp, origin, rtmag_log, scratch );
 
 	// P-waves (long)
 	if ( param_magnitude_p_secs_long && (!param_magnitude_s_secs || s_delay >= (float)param_magnitude_p_secs_long || param_magnitude_p_can_overlap_s) )
-		hasNewPLong = CalcAndAddPickMagnitude( magfilt, MAG_P_LONG, bp, origin, rtmag_log );
+		hasNewPLong = CalcAndAddPickMagnitude( magfilt, MAG_P_LONG, bp, origin, rtmag_log, scratch );
 
 	bool hasNewWindow =	(hasNewS || hasNewPShort || hasNewPLong);
 
@@ -1033,11 +1457,14 @@ bool binder_t :: CalcAndAddAllPickMagnitudes( magfilt_t magfilt, binder_pick_t &
 
 *******************************************************************************/
 
-void binder_t :: SendTargetsAlarm( quake_t & q, const vector<station_t *> & stations, targets_t & targets, bool logToLog, bool logToMail )
+void binder_t :: SendTargetsAlarm( quake_t & q, const vector<station_t *> & stations, targets_t & targets, bool logToLog, bool logToMail, binder_scratch_t & scratch )
 {
 	if (q.mag == -1)
 		return;
 
+	pgx_t & pga = scratch.pga;
+	pgx_t & pgv = scratch.pgv;
+
 	stringstream ss;
 
 	// Targets: send UDP alarms and log PGX
@@ -1291,39 +1718,124 @@ void binder_t :: SendBrokerAlarm( quake_t & q, const vector<station_t *> & stati
 
 *******************************************************************************/
 
-void binder_t :: Run(vector<station_t *> & stations)
+void binder_t :: LogAssocPerf()
 {
-	// Get new picks from all the stations (ordered by pick time)
-	binder_picks_set_t bpicks;
-	for (vector<station_t *>::const_iterator s = stations.begin(); s != stations.end(); s++)
+	cout << SecsToString(SecsNow()) << ": BINDER picks: " << assoc_perf_picks <<
+			" not linked: " << picks.size() <<
+			" usecs/pick: " << ((assoc_perf_picks == 0) ? 0.0 : double(assoc_perf_ticks) * 1000000 / SDL_GetPerformanceFrequency() / assoc_perf_picks) << endl;
+
+	assoc_perf_ticks = 0;
+	assoc_perf_picks = 0;
+}
+
+/*
+	Recalc location and magnitude of a quake and send its alarms. Runs on any worker thread:
+	quakes are independent, apart from the shared locator (see rtloc_t::Locate)
+*/
+void binder_t :: ProcessQuake( quake_t & q, bool has_new_picks, secs_t secs_now, const vector<station_t *> & stations, binder_scratch_t & scratch )
+{
+	bool hasNewLoc = false, hasNewMag = false;
+
+	// Location: request on new picks (also those left pending by the search in flight) or if enough time
+	// has passed since the last request. It runs asynchronously, until it's done magnitude and alarms use
+	// the last origin. Finished searches are collected first, before a new request supersedes them
+
+	hasNewLoc = CollectQuakeLoc( q, stations );
+
+	if (	has_new_picks || q.loc_pending ||
+			( param_locate_use_non_triggering_stations && ((secs_now - q.secs_loc_requested) >= param_locate_period) )	)
+		RequestQuakeLoc( q, has_new_picks );
+
+	// Magnitude: calc continuously (new waveform data may be available)
+
+	if (q.secs_located)
+		hasNewMag = CalcQuakeMag( q, scratch );
+
+	// Log QUAKE message: when mag is available, on loc or mag changes
+
+	if ((q.mag != -1) && (hasNewLoc || hasNewMag))
 	{
-		heli_t *heli = (*s)->z;
+		bool logToMail	=	!q.mail_sent;
+		LogQuake( q, logToMail );
+	}
 
-		if (!heli)
-			continue;
+	bool mustSendAlarm = (q.mag != -1) && ( hasNewLoc || hasNewMag || ((secs_now - q.secs_alarm_sent) >= param_alarm_max_period) );
+
+	// Targets PGA, PGV and Alarms: when mag is available, on loc or mag changes
+
+	if (mustSendAlarm)
+	{
+		q.secs_alarm_sent = SecsNow();
+
+		vector<station_t *> empty;
+
+		bool logToLog	=	true;
+		bool logToMail	=	!q.mail_sent;
+		SendTargetsAlarm( q, empty, targets, logToLog, logToMail, scratch );
+	}
+
+	// Stations PGA, PGV: when mag is available, on loc or mag changes
 
-		picks_set_t hpicks;
-		heli->GetNewPicks(hpicks);
+	if (mustSendAlarm)
+	{
+		targets_t empty;
+
+		bool logToLog	=	true;
+		bool logToMail	=	false;
+		SendTargetsAlarm( q, stations, empty, logToLog, logToMail, scratch );
+	}
 
-		for (picks_set_t :: const_iterator hp = hpicks.begin(); hp != hpicks.end(); hp++)
-			bpicks.insert( binder_pick_t(heli, *hp) );
+	// Broker alarm: when mag is available, on loc or mag changes
+
+	if ( (q.mag != -1) && ( hasNewLoc || hasNewMag ) )
+	{
+		bool logToLog	=	true;
+		bool logToMail	=	false;
+		SendBrokerAlarm( q, stations, broker, logToLog, logToMail );
 	}
 
+	// KML: update on loc, mag changes
+
+	if (hasNewLoc || hasNewMag)
+		q.estimates.push_back( quake_estimate_t( q.picks, q.origin, q.mag, q.mag_min, q.mag_max ) );
+}
+
+void binder_t :: ProcessQuake_JobFunc(void *quake_task_ptr, int worker)
+{
+	quake_task_t *t = (quake_task_t *)quake_task_ptr;
+	t->binder->ProcessQuake( *t->q, t->has_new_picks, t->secs_now, *t->stations, *t->binder->workers_scratch[worker] );
+}
+
+void binder_t :: Run(vector<station_t *> & stations)
+{
+	// Get the new picks queued by the stations (ordered by pick time)
+	binder_picks_set_t bpicks;
+	pick_queue.PopAll(bpicks);
+
 	// Add new picks (in pick time order) and get a set of quakes that had new picks linked to them.
 	// (note: later picks may still be processed before earlier picks due to latency/concurrency)
 	set<int> quake_ids;
+	Uint64 perf_start = SDL_GetPerformanceCounter();
 	for (binder_picks_set_t :: const_iterator bp = bpicks.begin(); bp != bpicks.end(); bp++)
 	{
 		int res_quake_id;
 		if ( AddAndLinkPick( *bp, &res_quake_id ) )
 			quake_ids.insert( res_quake_id );
 	}
+	if (!bpicks.empty())
+	{
+		assoc_perf_ticks	+=	SDL_GetPerformanceCounter() - perf_start;
+		assoc_perf_picks	+=	bpicks.size();
+	}
 
 	// Reprocess quakes
 
+	PurgeLocJobs(false);
+
 	secs_t secs_now = SecsNow();
 	bool isAlarm = false;
 
+	quake_tasks.clear();
 	for (vector<quake_t>::iterator q = quakes.begin(); q != quakes.end(); q++)
 	{
 		bool quake_has_new_picks = (quake_ids.find(q->id) != quake_ids.end());
@@ -1337,67 +1849,32 @@ void binder_t :: Run(vector<station_t *> & stations)
 		// in their buffers, otherwise the magnitude calculation would be performed on the new data only!
 		if ( (quake_alive || quake_has_new_picks) && (secs_now - q->secs_creation < 60*2) )
 		{
-			bool hasNewLoc = false, hasNewMag = false;
-
-			// Location: calc on new picks or if enough time has passed since the last estimate
-
-			if (	quake_has_new_picks ||
-					( param_locate_use_non_triggering_stations && ((secs_now - q->secs_located) >= param_locate_period) )	)
-				hasNewLoc = CalcQuakeLoc( *q );
-
-			// Magnitude: calc continuously (new waveform data may be available)
-
-			if (q->secs_located)
-				hasNewMag = CalcQuakeMag( *q );
-
-			// Log QUAKE message: when mag is available, on loc or mag changes
-
-			if ((q->mag != -1) && (hasNewLoc || hasNewMag))
-			{
-				bool logToMail	=	!q->mail_sent;
-				LogQuake( *q, logToMail );
-			}
-
-			bool mustSendAlarm = (q->mag != -1) && ( hasNewLoc || hasNewMag || ((secs_now - q->secs_alarm_sent) >= param_alarm_max_period) );
-
-			// Targets PGA, PGV and Alarms: when mag is available, on loc or mag changes
-
-			if (mustSendAlarm)
-			{
-				q->secs_alarm_sent = SecsNow();
-
-				vector<station_t *> empty;
-
-				bool logToLog	=	true;
-				bool logToMail	=	!q->mail_sent;
-				SendTargetsAlarm( *q, empty, targets, logToLog, logToMail );
-			}
-
-			// Stations PGA, PGV: when mag is available, on loc or mag changes
-
-			if (mustSendAlarm)
-			{
-				targets_t empty;
+			quake_task_t t;
+			t.binder		=	this;
+			t.q				=	&*q;
+			t.has_new_picks	=	quake_has_new_picks;
+			t.secs_now		=	secs_now;
+			t.stations		=	&stations;
+			quake_tasks.push_back(t);
+		}
+	}
 
-				bool logToLog	=	true;
-				bool logToMail	=	false;
-				SendTargetsAlarm( *q, stations, empty, logToLog, logToMail );
-			}
+	// Process the quakes in parallel (each sends its alarms as soon as it is done)
 
-			// Broker alarm: when mag is available, on loc or mag changes
+	quake_task_args.resize(quake_tasks.size());
+	for (size_t i = 0; i < quake_tasks.size(); i++)
+		quake_task_args[i] = &quake_tasks[i];
 
-			if ( (q->mag != -1) && ( hasNewLoc || hasNewMag ) )
-			{
-				bool logToLog	=	true;
-				bool logToMail	=	false;
-				SendBrokerAlarm( *q, stations, broker, logToLog, logToMail );
-			}
+	pool.Run( ProcessQuake_JobFunc, quake_task_args.empty() ? NULL : &quake_task_args[0], int(quake_task_args.size()) );
 
-			// KML: update on loc, mag changes
+	// Index the new predicted arrivals, for binding the next picks
+	for (size_t i = 0; i < quake_tasks.size(); i++)
+		if (quake_tasks[i].q->arrivals_changed)
+			IndexQuakeArrivals(*quake_tasks[i].q);
 
-			if (hasNewLoc || hasNewMag)
-				q->estimates.push_back( quake_estimate_t( q->picks, q->origin, q->mag, q->mag_min, q->mag_max ) );
-		}
+	for (vector<quake_t>::iterator q = quakes.begin(); q != quakes.end(); q++)
+	{
+		bool quake_alive = (secs_now - q->secs_creation) <= param_binder_quakes_life;
 
 		// Last step: save a screenshot, a KML animation and send the Mail
 
@@ -1420,7 +1897,7 @@ void binder_t :: Run(vector<station_t *> & stations)
 
 				bool logToLog	=	false;
 				bool logToMail	=	true;
-				SendTargetsAlarm( *q, stations, empty, logToLog, logToMail );
+				SendTargetsAlarm( *q, stations, empty, logToLog, logToMail, *workers_scratch[0] );
 			}
 
 			// Save Mail log to file
@@ -1504,6 +1981,7 @@ void binder_t :: Run(vector<station_t *> & stations)
 					(*s)->z->ResetMeanLatencies();
 				}
 			}
+			LogAssocPerf();
 		}
 	}
 }
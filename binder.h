@@ -28,12 +28,33 @@
 #ifndef BINDER_H_DEF
 #define BINDER_H_DEF
 
+#include <list>
+#include <map>
+#include "SDL_thread.h"
+#include "SDL_atomic.h"
+
 #include "global.h"
 
 #include "broker.h"
 #include "heli.h"
+#include "pgx.h"
 #include "quake.h"
+#include "rtloc.h"
+#include "rtmag.h"
 #include "target.h"
+#include "worker_pool.h"
+
+// State used to process a quake, one per thread (copies of the global rtmag, pga and pgv)
+struct binder_scratch_t
+{
+	rtmag_t rtmag;
+	pgx_t pga, pgv;
+	compbufs_t bufs;
+	NodeArena loc_arena;	// nodes of the location searches run by the thread (see rtloc_t::Locate)
+
+	binder_scratch_t() : rtmag(::rtmag), pga(::pga), pgv(::pgv)	{ initNodeArena(&loc_arena, 0); }
+	~binder_scratch_t()											{ freeNodeArena(&loc_arena); }
+};
 
 class binder_t
 {
@@ -44,25 +65,86 @@ private:
 
 	void PurgeOldPicks();
 
-	bool CheckPickAssoc(const binder_picks_set_t & picks, const binder_pick_t & new_pick, secs_t secs) const;
+	// Allowed pick time differences (from the first station to the second) for each pair of stations,
+	// indexed by station_t::index
+	struct pair_dt_t { float min, max; };
+	vector<pair_dt_t> pairs_dt;
+	size_t num_stations;
+	void InitStationPairs(const vector<station_t *> & stations);
+	bool CheckApparentVel(const binder_pick_t & first, const binder_pick_t & bp) const;
+
+	bool CheckPickAssoc(const binder_pick_t & first, const station_bits_t & stations, const binder_pick_t & new_pick, secs_t secs) const;
 	void LinkAssocPicks(quake_t & q, secs_t secs);
 	void FindCoincPicks(const binder_pick_t & new_pick, const quake_t *q, vector<binder_picks_set_t::iterator> & best_picks_iter);
+	bool LinkPickToLastOrNewQuake(const binder_pick_t & new_pick, binder_picks_set_t::iterator new_pick_iter, int *res_quake_id);
 	bool AddAndLinkPick(const binder_pick_t & new_pick, int *res_quake_id);
 
-	bool CalcAndAddPickMagnitude( magfilt_t magfilt, magtype_t magtype, binder_pick_t & bp, const origin_t & origin, stringstream & rtmag_log );
-	bool CalcAndAddAllPickMagnitudes( magfilt_t magfilt, binder_pick_t & bp, const origin_t & origin, stringstream & rtmag_log );
+	float ArrivalResidual(const quake_t & q, const binder_pick_t & bp) const;
+	quake_t *FindQuakeByArrival(const binder_pick_t & bp);
+	quake_t *FindQuake(int id);
+
+	// For each station (by station_t::index), the located quakes by their predicted P arrival at the station,
+	// so that a new pick is only compared with the quakes it may belong to. Only used by the main thread
+	typedef multimap<secs_t, int> arrival_index_t;
+	vector<arrival_index_t> arrival_index;
+	void CalcQuakeArrivals(quake_t & q, const vector<station_t *> & stations) const;
+	void IndexQuakeArrivals(quake_t & q);
+	void UnindexQuakeArrivals(quake_t & q);
+	bool FitsArrivals(const quake_t & q, const vector<binder_picks_set_t::iterator> & picks_iter) const;
+
+	bool CalcAndAddPickMagnitude( magfilt_t magfilt, magtype_t magtype, const binder_pick_t & bp, const origin_t & origin, stringstream & rtmag_log, binder_scratch_t & scratch );
+	bool CalcAndAddAllPickMagnitudes( magfilt_t magfilt, const binder_pick_t & bp, const origin_t & origin, stringstream & rtmag_log, binder_scratch_t & scratch );
 
 	void PurgeOldQuakes();
 
-	bool CalcQuakeLoc( quake_t & q );
-	bool CalcQuakeMag( quake_t & q );
+	static bool CalcQuakeLoc( const binder_picks_set_t & q_picks, origin_t *o, vector<float> *picks_rms, SDL_atomic_t *cancel, NodeArena *arena );
+	bool CalcQuakeMag( quake_t & q, binder_scratch_t & scratch );
+
+	// Locations run asynchronously on the pool (see RequestQuakeLoc)
+	struct loc_job_t
+	{
+		binder_t *binder;
+		int quake_id, generation;
+		binder_picks_set_t picks;
+		SDL_atomic_t cancel;
+		bool done, located;		// written under loc_mutex
+		origin_t origin;
+		vector<float> picks_rms;	// in picks order (empty if the location is forced)
+
+		loc_job_t() : origin(0,0,0)	{ }
+	};
+	list<loc_job_t *> loc_jobs;		// in flight, or done and not collected yet
+	SDL_mutex *loc_mutex;
+
+	static void LocateQuake_JobFunc(void *loc_job_ptr, int worker);
+	void RequestQuakeLoc( quake_t & q, bool has_new_picks );
+	bool CollectQuakeLoc( quake_t & q, const vector<station_t *> & stations );
+	void PurgeLocJobs( bool cancel_all );
+
+	// Quakes are processed in parallel by a pool of threads (plus the main one), each with its own scratch state
+	worker_pool_t pool;
+	vector<binder_scratch_t *> workers_scratch;	// indexed by worker
+
+	struct quake_task_t
+	{
+		binder_t *binder;
+		quake_t *q;
+		bool has_new_picks;
+		secs_t secs_now;
+		const vector<station_t *> *stations;
+	};
+	vector<quake_task_t> quake_tasks;
+	vector<void *> quake_task_args;
+
+	static void ProcessQuake_JobFunc(void *quake_task_ptr, int worker);
+	void ProcessQuake( quake_t & q, bool has_new_picks, secs_t secs_now, const vector<station_t *> & stations, binder_scratch_t & scratch );
 
 	int quake_id;
 	void LoadQuakeId();
 	void SaveQuakeId();
 
 	void LogQuake( quake_t & q, bool logToMail );
-	void SendTargetsAlarm( quake_t & q, const vector<station_t *> & stations, targets_t & targets, bool logToLog, bool logToMail );
+	void SendTargetsAlarm( quake_t & q, const vector<station_t *> & stations, targets_t & targets, bool logToLog, bool logToMail, binder_scratch_t & scratch );
 	void SendBrokerAlarm( quake_t & q, const vector<station_t *> & stations, broker_t & broker, bool logToLog, bool logToMail );
 	void SendBrokerHeartBeat( broker_t & broker );
 	void SaveQuakeKML( const string & fileprefix, quake_t & q, const vector<station_t *> & stations );
@@ -73,6 +155,11 @@ private:
 	secs_t secs_heartbeat_sent;
 	secs_t secs_latencies_logged;
 
+	// Cost of binding the new picks, logged with the latencies
+	Uint64 assoc_perf_ticks;
+	unsigned long assoc_perf_picks;
+	void LogAssocPerf();
+
 public:
 
 	// For e.g. drawing
@@ -82,9 +169,10 @@ public:
 
 	binder_t();
 
-	void Init();
+	void Init(const vector<station_t *> & stations);
 
 	void Reset();
+	void Stop();
 
 	void Run(vector<station_t *> & stations);
 
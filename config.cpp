@@ -62,7 +62,9 @@ double
 		param_debug_gaps_period,
 		param_debug_gaps_duration,
 		param_debug_save_rtloc,
-		param_debug_save_rtmag;
+		param_debug_save_rtmag,
+		param_debug_picker_compare,
+		param_debug_picker_allocs;
 
 double
 		param_display_heli_min_accel,
@@ -86,14 +88,21 @@ int
 		param_waveform_rmean_secs;
 double
 		param_waveform_clipping_secs,
-		param_waveform_min_snr;
+		param_waveform_min_snr,
+		param_waveform_decimate_sps;
 
 double
 		param_picker_filterWindow,
 		param_picker_longTermWindow,
 		param_picker_threshold1,
 		param_picker_threshold2,
-		param_picker_tUpEvent;
+		param_picker_tUpEvent,
+		param_picker_batch_secs,
+		param_picker_stalta_sta_secs,
+		param_picker_stalta_lta_secs,
+		param_picker_stalta_on,
+		param_picker_stalta_off,
+		param_picker_stalta_aic_secs;
 
 double
 		param_binder_stations_for_coincidence,
@@ -104,7 +113,9 @@ double
 		param_binder_apparent_vel_min,
 		param_binder_apparent_vel_max,
 		param_binder_apparent_vel_stations_spacing,
-		param_binder_apparent_vel_max_distance;
+		param_binder_apparent_vel_max_distance,
+		param_binder_secs_for_arrival,
+		param_binder_threads;
 
 double
 		param_locate_period,
@@ -113,7 +124,11 @@ double
 		param_locate_force_lat,
 		param_locate_force_dep,
 		param_locate_use_non_triggering_stations,
-		param_locate_ignore_error;
+		param_locate_ignore_error,
+		param_locate_interleaved_tt,
+		param_locate_mmap_grids,
+		param_locate_load_threads,
+		param_locate_quantized_grids;
 
 double
 		param_magnitude_max_value,
@@ -412,6 +427,15 @@ string Check_Params()
 	if (param_magnitude_p_secs_short > param_magnitude_p_secs_long)
 		errors += "\n\"magnitude_p_secs_long\" must be greater than \"magnitude_p_secs_short\"\n";
 
+	if (param_binder_secs_for_arrival < 0)
+		errors += "\n\"binder_secs_for_arrival\" must be 0 (disabled) or greater than 0\n";
+
+	if (param_binder_threads < -1 || param_binder_threads != int(param_binder_threads))
+		errors += "\n\"binder_threads\" must be -1 (one per core) or an integer greater than or equal to 0\n";
+
+	if (param_locate_load_threads < 1 || param_locate_load_threads != int(param_locate_load_threads))
+		errors += "\n\"locate_load_threads\" must be an integer greater than or equal to 1\n";
+
 	// Frequencies
 	if ((param_magnitude_low_fmin <= 0) || (param_magnitude_low_fmax <= 0) || (param_magnitude_low_fmin >= param_magnitude_low_fmax))
 		errors += "\nInvalid frequencies, it must be:\n 0 < \"magnitude_low_fmin\" < \"magnitude_low_fmax\"\n";
@@ -428,6 +452,21 @@ string Check_Params()
 	if (param_waveform_clipping_secs && param_waveform_clipping_secs < 1)
 		errors += "\n\"waveform_clipping_secs\" must be 0 (disabled) or greater than 1.0\n";
 
+	if (param_waveform_decimate_sps && param_waveform_decimate_sps < 10)
+		errors += "\n\"waveform_decimate_sps\" must be 0 (disabled) or greater than 10\n";
+
+	if (param_picker_batch_secs && (param_picker_batch_secs < 0.01 || param_picker_batch_secs > 1))
+		errors += "\n\"picker_batch_secs\" must be 0 (disabled) or between 0.01 and 1.0\n";
+
+	if (param_picker_stalta_sta_secs <= 0 || param_picker_stalta_lta_secs <= param_picker_stalta_sta_secs)
+		errors += "\n\"picker_stalta_sta_secs\" must be greater than 0 and less than \"picker_stalta_lta_secs\"\n";
+
+	if (param_picker_stalta_off <= 0 || param_picker_stalta_on <= param_picker_stalta_off)
+		errors += "\n\"picker_stalta_off\" must be greater than 0 and less than \"picker_stalta_on\"\n";
+
+	if (param_picker_stalta_aic_secs < 0)
+		errors += "\n\"picker_stalta_aic_secs\" must be 0 (disabled) or greater\n";
+
 	if (param_alarm_max_period < 0.2)
 		errors += "\n\"alarm_max_period\" must be 0.2 seconds or greater\n";
 
@@ -518,6 +557,8 @@ void Load_Params()
 	READ_PARAM(		debug_gaps_duration,					0.0		)
 	READ_PARAM(		debug_save_rtloc,						0.0		)
 	READ_PARAM(		debug_save_rtmag,						0.0		)
+	READ_PARAM(		debug_picker_compare,					0.0		)
+	READ_PARAM(		debug_picker_allocs,					0.0		)
 
 	// Display
 
@@ -544,6 +585,7 @@ void Load_Params()
 	READ_PARAM(		waveform_rmean_secs,					30		)
 	READ_PARAM(		waveform_clipping_secs,					30.0	)
 	READ_PARAM(		waveform_min_snr,						5.0		)
+	READ_PARAM(		waveform_decimate_sps,					0		)
 
 	// Picker
 
@@ -552,6 +594,12 @@ void Load_Params()
 	READ_PARAM(		picker_threshold1,						10.0	)
 	READ_PARAM(		picker_threshold2,						10.0	)
 	READ_PARAM(		picker_tUpEvent,						0.5		)
+	READ_PARAM(		picker_batch_secs,						0		)
+	READ_PARAM(		picker_stalta_sta_secs,					0.5		)
+	READ_PARAM(		picker_stalta_lta_secs,					10.0	)
+	READ_PARAM(		picker_stalta_on,						4.0		)
+	READ_PARAM(		picker_stalta_off,						1.5		)
+	READ_PARAM(		picker_stalta_aic_secs,					1.0		)
 
 	// Binder
 
@@ -564,6 +612,8 @@ void Load_Params()
 	READ_PARAM(		binder_apparent_vel_max,				20.0	)
 	READ_PARAM(		binder_apparent_vel_stations_spacing,	30.0	)
 	READ_PARAM(		binder_apparent_vel_max_distance,		120.0	)
+	READ_PARAM(		binder_secs_for_arrival,				3.0		)
+	READ_PARAM(		binder_threads,							-1		)
 
 	// Locate
 
@@ -574,6 +624,10 @@ void Load_Params()
 	READ_PARAM(		locate_force_dep,						sac_header_t::UNDEF	)
 	READ_PARAM(		locate_use_non_triggering_stations,		1.0		)
 	READ_PARAM(		locate_ignore_error,					0.0		)
+	READ_PARAM(		locate_interleaved_tt,					0.0		)
+	READ_PARAM(		locate_mmap_grids,						1.0		)
+	READ_PARAM(		locate_load_threads,					4.0		)
+	READ_PARAM(		locate_quantized_grids,					0.0		)
 
 	// Magnitude
 
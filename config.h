@@ -86,7 +86,9 @@ extern double
 		param_debug_gaps_period,
 		param_debug_gaps_duration,
 		param_debug_save_rtloc,
-		param_debug_save_rtmag;
+		param_debug_save_rtmag,
+		param_debug_picker_compare,		// if non zero, also run the other picker on every channel and log the CPU usage and pick time differences
+		param_debug_picker_allocs;		// if non zero, log the packets whose picking needed heap allocations
 
 extern double
 		param_display_heli_min_accel,
@@ -110,14 +112,21 @@ extern int
 		param_waveform_rmean_secs;
 extern double
 		param_waveform_clipping_secs,
-		param_waveform_min_snr;
+		param_waveform_min_snr,
+		param_waveform_decimate_sps;
 
 extern double
 		param_picker_filterWindow,		// in seconds, determines how far back in time the previous samples are examined.  The filter window will be adjusted upwards to be an integer N power of 2 times the sample interval (deltaTime).  Then numRecursive = N + 1 "filter bands" are created.  For each filter band n = 0,N  the data samples are processed through a simple recursive filter backwards from the current sample, and picking statistics and characteristic function are generated.  Picks are generated based on the maximum of the characteristic function values over all filter bands relative to the threshold values threshold1 and threshold2.
 		param_picker_longTermWindow,	// determines: a) a stabilisation delay time after the beginning of data; before this delay time picks will not be generated. b) the decay constant of a simple recursive filter to accumulate/smooth all picking statistics and characteristic functions for all filter bands.
 		param_picker_threshold1,		// sets the threshold to trigger a pick event (potential pick).  This threshold is reached when the (clipped) characteristic function for any filter band exceeds threshold1.
 		param_picker_threshold2,		// sets the threshold to declare a pick (pick will be accepted when tUpEvent reached).  This threshold is reached when the integral of the (clipped) characteristic function for any filter band over the window tUpEvent exceeds threshold2 * tUpEvent (i.e. the average (clipped) characteristic function over tUpEvent is greater than threshold2)..
-		param_picker_tUpEvent;			// determines the maximum time the integral of the (clipped) characteristic function is accumulated after threshold1 is reached (pick event triggered) to check for this integral exceeding threshold2 * tUpEvent (pick declared).
+		param_picker_tUpEvent,			// determines the maximum time the integral of the (clipped) characteristic function is accumulated after threshold1 is reached (pick event triggered) to check for this integral exceeding threshold2 * tUpEvent (pick declared).
+		param_picker_batch_secs,		// if > 0, pick all the channels in a single thread, processing the packets received during this interval as one batch
+		param_picker_stalta_sta_secs,	// STA/LTA picker (stations.txt): short term average window
+		param_picker_stalta_lta_secs,	// long term average window (also the stabilisation delay)
+		param_picker_stalta_on,			// STA/LTA ratio declaring a pick
+		param_picker_stalta_off,		// STA/LTA ratio re-arming the trigger
+		param_picker_stalta_aic_secs;	// window before the trigger where the onset is refined with the AIC (0 = disabled)
 
 extern double
 		param_binder_stations_for_coincidence,
@@ -128,7 +137,9 @@ extern double
 		param_binder_apparent_vel_min,
 		param_binder_apparent_vel_max,
 		param_binder_apparent_vel_stations_spacing,
-		param_binder_apparent_vel_max_distance;
+		param_binder_apparent_vel_max_distance,
+		param_binder_secs_for_arrival,		// max residual of a pick w.r.t. the P arrival predicted by the location of a live quake (0 = only bind to the last quake)
+		param_binder_threads;				// threads processing quakes in parallel besides the main one (-1 = number of cores - 1, 0 = none)
 
 extern double
 		param_locate_period,
@@ -137,7 +148,11 @@ extern double
 		param_locate_force_lat,
 		param_locate_force_dep,
 		param_locate_use_non_triggering_stations,
-		param_locate_ignore_error;
+		param_locate_ignore_error,
+		param_locate_interleaved_tt,		// keep a copy of the P travel times with all the stations of a grid node side by side (faster with many stations, doubles the memory for P times)
+		param_locate_mmap_grids,			// map the travel time grid files instead of reading them (instant startup, memory shared by all the PRESTo instances on the host)
+		param_locate_load_threads,			// travel time grids loaded at once at startup, the main thread included (bounds the concurrent disk reads)
+		param_locate_quantized_grids;		// keep the travel times as 16-bit fixed point (half the memory, max error logged at startup): from the grid.buf16 files made by rtloc/quantgrid, or else quantized when loaded
 
 extern double
 		param_magnitude_max_value,
@@ -24,6 +24,7 @@
 *******************************************************************************/
 
 #include <cmath>
+#include <cstring>
 
 #include "global.h"
 
@@ -233,12 +234,15 @@ void Filter_4_Poles(float * b_first, float * b_last, float fmin, float fc, float
 	%final array results into trace_suppl
 *******************************************************************************/
 
-void Filter_2_Poles_Matlab(float * b_first, float * b_last, float fmin, float fmax, float dt)
+/*******************************************************************************
+  The MatLab filter above, as a processing stage that can be fused with other
+  stages (see filter.h). Both sections are causal, so running them back to
+  back on each sample gives the same output as the two passes.
+*******************************************************************************/
+
+Stage_BandPass Stage_Filter(float fmin, float fmax, float dt)
 {
-	float a0, b0,b1,b2, c, c0,c1,c2;
-	float x, x_1, x_2;
-	float y, y_1, y_2;
-	float *b;
+	float a0, b0,b1,b2, c;
 
 	// fmin,fmax must not be greater than the Nyquist frequency.
 
@@ -256,27 +260,7 @@ void Filter_2_Poles_Matlab(float * b_first, float * b_last, float fmin, float fm
 	b1 = -2 * (c*c - 1);
 	b2 = c*c - sqrt(2.0f) * c + 1;
 
-	c0 = a0 / b0;
-	c1 = b1 / b0;
-	c2 = b2 / b0;
-
-	x_1 = x_2 = 0;
-	y_1 = y_2 = 0;
-
-	for (b = b_first; b <= b_last; b++)
-	{
-		// trace_suppl(i,2) = la0 * (trace(i,2) -2*trace(i-1,2)+trace(i-2,2)) - lb1 * trace_suppl(i-1,2) -  lb2 * trace_suppl(i-2,2);
-
-		x = *b;
-		y = c0 * (x - 2 * x_1 + x_2) - c1 * y_1 - c2 * y_2;
-		*b = y;
-
-		x_2 = x_1;
-		x_1 = x;
-
-		y_2 = y_1;
-		y_1 = y;
-	}
+	Stage_Biquad<float> hp(a0 / b0, b1 / b0, b2 / b0, -2);
 
 	// Low pass
 
@@ -288,31 +272,91 @@ void Filter_2_Poles_Matlab(float * b_first, float * b_last, float fmin, float fm
 	b1 = -2 * (c*c - 1);
 	b2 = c*c - sqrt(2.0f) * c + 1;
 
-	c0 = a0 / b0;
-	c1 = b1 / b0;
-	c2 = b2 / b0;
+	Stage_Biquad<float> lp(a0 / b0, b1 / b0, b2 / b0, +2);
 
-	x_1 = x_2 = 0;
-	y_1 = y_2 = 0;
+	return Stages(hp, lp);
+}
 
-	for (b = b_first; b <= b_last; b++)
-	{
-//		trace_suppl(i,2) = la0 * (trace(i,2) +2*trace(i-1,2)+trace(i-2,2)) - lb1 * trace_suppl(i-1,2) -  lb2 * trace_suppl(i-2,2);
-		x = *b;
-		y = c0 * (x + 2 * x_1 + x_2) - c1 * y_1 - c2 * y_2;
-		*b = y;
+void Filter(float * b_first, float * b_last, float fmin, float fmax, float dt)
+{
+//	Filter_2_Poles(b_first, b_last, fmin, fc, fmax, dt);
+	Process(b_first, b_last, b_first, Stage_Filter(fmin, fmax, dt));
+}
 
-		x_2 = x_1;
-		x_1 = x;
+/*******************************************************************************
 
-		y_2 = y_1;
-		y_1 = y;
+	decimator_t
+
+*******************************************************************************/
+
+void decimator_t :: Init(int _factor)
+{
+	factor = max(_factor, 1);
+
+	taps.clear();
+
+	if (factor > 1)
+	{
+		// Hamming windowed sinc with cutoff at 80% of the output Nyquist frequency
+		int num_taps	=	16 * factor + 1;
+		int half		=	num_taps / 2;
+		double fc		=	0.8 * 0.5 / factor;		// cycles per input sample
+
+		vector<double> h(num_taps);
+		double sum = 0;
+		for (int k = 0; k < num_taps; k++)
+		{
+			int m = k - half;
+			double sinc = (m == 0) ? 2 * fc : sin(2 * FLOAT_PI * fc * m) / (FLOAT_PI * m);
+			h[k] = sinc * (0.54 - 0.46 * cos(2 * FLOAT_PI * k / (num_taps - 1)));
+			sum += h[k];
+		}
+
+		// Unity gain at DC, stored reversed so that the newest sample is multiplied by h[0]
+		taps.resize(num_taps);
+		for (int k = 0; k < num_taps; k++)
+			taps[num_taps - 1 - k] = float(h[k] / sum);
 	}
+
+	Reset();
 }
 
+void decimator_t :: Reset()
+{
+	history.assign(2 * taps.size(), 0.0f);
+	pos		=	0;
+	phase	=	0;
+}
 
-void Filter(float * b_first, float * b_last, float fmin, float fmax, float dt)
+int decimator_t :: Process(const float *src, int num, float *dst)
 {
-//	Filter_2_Poles(b_first, b_last, fmin, fc, fmax, dt);
-	Filter_2_Poles_Matlab(b_first, b_last, fmin, fmax, dt);
+	if (factor == 1)
+	{
+		memcpy(dst, src, num * sizeof(*dst));
+		return num;
+	}
+
+	int num_taps	=	int(taps.size());
+	const float *h	=	&taps[0];
+	float *x		=	&history[0];
+	float *d		=	dst;
+
+	for (const float *s = src; s < src + num; s++)
+	{
+		// The oldest sample is overwritten: x[pos+1 .. pos+num_taps] then runs from oldest to newest
+		pos = (pos + 1) % num_taps;
+		x[pos] = x[pos + num_taps] = *s;
+
+		if (++phase < factor)
+			continue;
+		phase = 0;
+
+		const float *xs = x + pos + 1;
+		float y = 0;
+		for (int k = 0; k < num_taps; k++)
+			y += h[k] * xs[k];
+		*d++ = y;
+	}
+
+	return int(d - dst);
 }
@@ -26,6 +26,8 @@
 #ifndef FILTER_H_DEF
 #define FILTER_H_DEF
 
+#include <vector>
+
 void Filter(float * b_first, float * b_last, float fmin, float fmax, float dt);
 
 // Remove mean
@@ -80,4 +82,146 @@ T Integral(T * b_first, T * b_last, T dt)
 	return sum * dt;
 }
 
+/*******************************************************************************
+
+	Processing stages
+
+	Stateful per-sample functors (T operator()(T x)) that can be chained at
+	compile time with Stages(a, b), so that a sequence of operations like
+	integrate -> integrate -> band pass runs as a single loop over the samples
+	(see Process) instead of one full pass over the buffer per operation.
+
+*******************************************************************************/
+
+// Trapezoidal integration, same output as Integrate
+template< typename T >
+struct Stage_Integrate
+{
+	T half_dt;
+	T x_1, y_1;
+	bool first;
+
+	Stage_Integrate(T dt) : half_dt(dt / 2), x_1(0), y_1(0), first(true)	{ }
+
+	T operator()(T x)
+	{
+		if (first)
+		{
+			first	=	false;
+			x_1		=	x;
+			return y_1;
+		}
+
+		y_1	=	y_1 + half_dt * (x_1 + x);
+		x_1	=	x;
+		return y_1;
+	}
+};
+
+// Two-pole recursive section: y[k] = c0 * (x[k] + k1 * x[k-1] + x[k-2]) - c1 * y[k-1] - c2 * y[k-2]
+template< typename T >
+struct Stage_Biquad
+{
+	T c0, c1, c2, k1;
+	T x_1, x_2;
+	T y_1, y_2;
+
+	Stage_Biquad(T _c0, T _c1, T _c2, T _k1) : c0(_c0), c1(_c1), c2(_c2), k1(_k1), x_1(0), x_2(0), y_1(0), y_2(0)	{ }
+
+	T operator()(T x)
+	{
+		T y = c0 * (x + k1 * x_1 + x_2) - c1 * y_1 - c2 * y_2;
+
+		x_2 = x_1;
+		x_1 = x;
+
+		y_2 = y_1;
+		y_1 = y;
+
+		return y;
+	}
+};
+
+// Absolute value
+struct Stage_Abs
+{
+	template< typename T >
+	T operator()(T x)	{	return (x < 0) ? -x : x;	}
+};
+
+// Feed the output of s1 to s2
+template< typename S1, typename S2 >
+struct Stage_Chain
+{
+	S1 s1;
+	S2 s2;
+
+	Stage_Chain(const S1 & _s1, const S2 & _s2) : s1(_s1), s2(_s2)	{ }
+
+	template< typename T >
+	T operator()(T x)	{	return s2(s1(x));	}
+};
+
+template< typename S1, typename S2 >
+inline Stage_Chain<S1,S2> Stages(const S1 & s1, const S2 & s2)
+{
+	return Stage_Chain<S1,S2>(s1, s2);
+}
+
+// The band pass used by Filter (high pass then low pass), as a stage
+typedef Stage_Chain< Stage_Biquad<float>, Stage_Biquad<float> > Stage_BandPass;
+Stage_BandPass Stage_Filter(float fmin, float fmax, float dt);
+
+// Run the samples in [src_first, src_last] through stage, writing the output to dst (which may be src_first)
+template< typename T, typename S >
+void Process(const T * src_first, const T * src_last, T * dst, S stage)
+{
+	for (; src_first <= src_last; src_first++, dst++)
+		*dst = stage(*src_first);
+}
+
+/*******************************************************************************
+
+	decimator_t - Anti-aliased decimation by an integer factor.
+
+	A windowed-sinc low pass FIR is evaluated only on the samples that are kept
+	(polyphase decimation), so the cost is taps / factor per input sample.
+	Input must be continuous: call Reset on gaps.
+
+*******************************************************************************/
+
+class decimator_t
+{
+public:
+
+	decimator_t() : factor(1), pos(0), phase(0)	{ }
+
+	// Design the filter for decimating by factor (1 = no decimation)
+	void Init(int _factor);
+
+	// Clear the filter history
+	void Reset();
+
+	int GetFactor() const	{	return factor;	}
+
+	// Delay (in input samples) introduced by the filter
+	int GetDelay() const	{	return int(taps.size() / 2);	}
+
+	// Input samples received since the last output sample
+	int GetPhase() const	{	return phase;	}
+
+	// Number of output samples that processing num more input samples will produce
+	int NumOutputs(int num) const	{	return (phase + num) / factor;	}
+
+	// Filter and decimate num samples from src into dst (room for num / factor + 1 samples). Return the number of output samples
+	int Process(const float *src, int num, float *dst);
+
+private:
+
+	int factor;
+	std::vector<float> taps;		// reversed filter coefficients
+	std::vector<float> history;	// last taps.size() input samples, stored twice to read them contiguously
+	int pos, phase;
+};
+
 #endif
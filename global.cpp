@@ -35,6 +35,7 @@
 #include "state.h"
 #include "version.h"
 #include "sound.h"
+#include "pick_table.h"
 
 #include "libslink.h"
 
@@ -354,6 +355,7 @@ void Exit()
 
 	AllSounds_Stop();
 	state.EndAll();
+	pick_table.Shutdown();
 //	Save_Config();
 	exit(EXIT_SUCCESS);
 }
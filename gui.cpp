@@ -47,6 +47,7 @@
 #include "config.h"
 #include "map.h"
 #include "heli.h"
+#include "pick_queue.h"
 #include "binder.h"
 #include "loading_bar.h"
 #include "rtloc.h"
@@ -335,7 +336,7 @@ void PreLoad_Helicorders()
 		if (!f)
 			Fatal_Error("Couldn't open station file \"" + filename + "\"");
 
-		const std::streamsize w1 = 5, w2 = 7, w3 = 7, w4 = 6, w5 = 4, w6 = 12, w7 = 12, w8 = 12, w9 = 15, w10 = 3, w11 = 3, w12 = 3, w13 = 3;
+		const std::streamsize w1 = 5, w2 = 7, w3 = 7, w4 = 6, w5 = 4, w6 = 12, w7 = 12, w8 = 12, w9 = 15, w10 = 3, w11 = 3, w12 = 3, w13 = 3, w14 = 6;
 
 		cout << endl;
 		cout << "==================================================================================================" << endl;
@@ -355,7 +356,8 @@ void PreLoad_Helicorders()
 				setw(w10)	<<	"Net"			<<	" | "	<<
 				setw(w11)	<<	"ChZ"			<<	" | "	<<
 				setw(w12)	<<	"ChN"			<<	" | "	<<
-				setw(w13)	<<	"ChE"			<<	endl;
+				setw(w13)	<<	"ChE"			<<	" | "	<<
+				setw(w14)	<<	"Picker"		<<	endl;
 		cout << "==================================================================================================" << endl;
 
 		for(;;)
@@ -363,12 +365,14 @@ void PreLoad_Helicorders()
 			string name, type, str_clip, str_logger, str_sensor;
 			float lon, lat, dep, clip, logger, sensor;
 			string ipaddress, net, channel_z, channel_n, channel_e;
+			string rest, str_picker;
+			pickertype_t picker_type = PICKER_FP5;
 
 			SkipComments(f);
 
 			f >> name >> type >> str_clip >> str_logger >> str_sensor >> ipaddress >> net >> channel_z >> channel_n >> channel_e;
 
-			const string FORMAT = "Parsing station \"" + name + "\" in file \"" + filename + "\".\nUse this format: name type clip logger sensor IPaddress net channelZ channelN channelE\n";
+			const string FORMAT = "Parsing station \"" + name + "\" in file \"" + filename + "\".\nUse this format: name type clip logger sensor IPaddress net channelZ channelN channelE [picker]\n";
 
 			if (f.fail())
 			{
@@ -378,6 +382,13 @@ void PreLoad_Helicorders()
 				Fatal_Error(FORMAT);
 			}
 
+			// Optional picker (default FP5), possibly followed by a comment
+			getline(f, rest);
+			istringstream rest_ss(rest);
+			rest_ss >> str_picker;
+			if (!str_picker.empty() && str_picker[0] != '#' && !StringToPickerType(str_picker, &picker_type))
+				Fatal_Error(FORMAT + "Invalid picker \"" + str_picker + "\". Must be FP5 or STALTA.");
+
 			if (type != "ACC" && type != "VEL")
 				Fatal_Error(FORMAT + "Invalid type \"" + type + "\". Must be ACC or VEL.");
 
@@ -413,9 +424,10 @@ void PreLoad_Helicorders()
 					setw(w10)	<<	net			<<	" | "	<<
 					setw(w11)	<<	channel_z	<<	" | "	<<
 					setw(w12)	<<	channel_n	<<	" | "	<<
-					setw(w13)	<<	channel_e	<<	endl;
+					setw(w13)	<<	channel_e	<<	" | "	<<
+					setw(w14)	<<	PickerTypeName(picker_type)	<<	endl;
 
-			network.insert( station_t(name, lon, lat, dep, type == "ACC", clip, logger / sensor, ipaddress, net, channel_z, channel_n, channel_e) );
+			network.insert( station_t(name, lon, lat, dep, type == "ACC", clip, logger / sensor, ipaddress, net, channel_z, channel_n, channel_e, picker_type) );
 		}
 
 		cout << "==================================================================================================" << endl;
@@ -672,10 +684,14 @@ void PreLoad_Helicorders()
 	sort(stations.begin(), stations.end(), cmp_stations_t());
 	sort(helis.begin(),    helis.end(),    cmp_stations_t());
 
+	// Station indices, used by the binder to index per-station data
+	for (size_t i = 0; i < stations.size(); i++)
+		stations[i]->index = int(i);
+
 	// Binder (quake_id)
 	// this must run after the simulated time start instant is defined (i.e. after SACs loading)
 
-	binder.Init();
+	binder.Init(stations);
 	binder.magheli.Init("", NUM_SAMPLES, stations[0], true);
 
 	LoadingBar_End();
@@ -694,6 +710,9 @@ void Restart_Helis()
 	}
 	binder.magheli.Stop();
 
+	// Forget the picks not yet processed by the binder
+	pick_queue.Clear();
+
 	// Start
 	for (vector<station_t *>::iterator s = stations.begin(); s != stations.end() ; s++)
 	{
@@ -738,6 +757,9 @@ void ResetAll()
 
 	binder.Reset();
 
+	// Batched picking of all channels (if enabled)
+	picker_engine.Start();
+
 	Restart_Helis();
 
 	if ((realtime || param_alarm_during_simulation) && !broker.Hostname().empty())
@@ -765,10 +787,16 @@ void End_Heli()
 		return;
 
 	binder.magheli.Stop();
+	binder.Stop();
 	broker.Stop();
+	picker_engine.Stop();
 
 	network.clear();
 
+	// Release the picks still held by the binder and the queue (the marker of magheli went with its Stop)
+	binder.Reset();
+	pick_queue.Clear();
+
 	helicorders_loaded = false;
 }
 
@@ -1575,12 +1603,12 @@ void heli_t :: Draw(const win_t & win, float x, float y, float w, float h, float
 				DrawQuad(NULL, ix0,min_iy, max(ix1-ix0,dx),max_iy-min_iy,fontcolor);
 
 			// highlight picks linked to an event
-			if (p->quake_id != pick_t::NO_QUAKE)
+			if (p->Rec().quake_id != pick_t::NO_QUAKE)
 			{
 				// Linked quake
 #if 0
 				ArialFont().Print(
-					"q" + ToString(p->quake_id) /*+ "[" +
+					"q" + ToString(p->Rec().quake_id) /*+ "[" +
 					MAGLABEL[MAG_S]       + " " + MagToString(p->quake_mag_s      ) + "," +
 					MAGLABEL[MAG_P_SHORT] + " " + MagToString(p->quake_mag_p_short) + "," +
 					MAGLABEL[MAG_P_LONG]  + " " + MagToString(p->quake_mag_p_long ) + "]"*/,
@@ -1592,7 +1620,7 @@ void heli_t :: Draw(const win_t & win, float x, float y, float w, float h, float
 				{
 					colors_t p_colors(0,0,0,alpha*.1f);
 
-					if (p->quake_mag[MAG_P_SHORT] != -1)
+					if (p->Rec().quake_mag[MAG_P_SHORT] != -1)
 						p_colors = colors_t(1,1,0,alpha*.4f);
 
 					ix0 = min_ix + float(p->t - time0) / tpixel * dx;
@@ -1610,7 +1638,7 @@ void heli_t :: Draw(const win_t & win, float x, float y, float w, float h, float
 				{
 					colors_t p_colors(0,0,0,alpha*.1f);
 
-					if (p->quake_mag[MAG_P_LONG] != -1)
+					if (p->Rec().quake_mag[MAG_P_LONG] != -1)
 						p_colors = colors_t(1,1,0,alpha*.4f);
 
 					// do not overlap with the other P window
@@ -1629,10 +1657,10 @@ void heli_t :: Draw(const win_t & win, float x, float y, float w, float h, float
 				{
 					colors_t s_colors(0,0,0,alpha*.1f);
 
-					if (p->quake_mag[MAG_S] != -1)
+					if (p->Rec().quake_mag[MAG_S] != -1)
 						s_colors = colors_t(1,0,0,alpha*.4f);
 
-					float s_delay = station->CalcSDelay( binder.Quake(p->quake_id).origin );
+					float s_delay = station->CalcSDelay( binder.Quake(p->Rec().quake_id).origin );
 
 					ix0 = min_ix + float(p->t + s_delay - time0) / tpixel * dx;
 					ix1 = min_ix + float(p->t + s_delay + param_magnitude_s_secs - time0) / tpixel * dx;
@@ -1667,9 +1695,9 @@ void heli_t :: Draw(const win_t & win, float x, float y, float w, float h, float
 		{
 			for (picks_set_t::const_reverse_iterator p = picks.rbegin(); p != picks.rend(); p++)
 			{
-				if (p->quake_id != pick_t::NO_QUAKE)
+				if (p->Rec().quake_id != pick_t::NO_QUAKE)
 				{
-					const quake_t & q = binder.Quake(p->quake_id);
+					const quake_t & q = binder.Quake(p->Rec().quake_id);
 					if ( SecsNow() - q.secs_creation <= param_binder_quakes_life + 30 )
 					{
 						fonth = (h-2*border) * 0.4f;
@@ -1677,9 +1705,9 @@ void heli_t :: Draw(const win_t & win, float x, float y, float w, float h, float
 
 							ArialFont().Print(
 								// ToString(p->quake_rms) + " " +
-								( param_magnitude_p_secs_short ? rtmag.GetLabel(MAG_P_SHORT) + "=" + MagToString(p->quake_mag[MAG_P_SHORT]) + " " : "" ) +
-								( param_magnitude_p_secs_long  ? rtmag.GetLabel(MAG_P_LONG)  + "=" + MagToString(p->quake_mag[MAG_P_LONG] ) + " " : "" ) +
-								( param_magnitude_s_secs       ? rtmag.GetLabel(MAG_S)       + "=" + MagToString(p->quake_mag[MAG_S]      ) + " " : "" ) +
+								( param_magnitude_p_secs_short ? rtmag.GetLabel(MAG_P_SHORT) + "=" + MagToString(p->Rec().quake_mag[MAG_P_SHORT]) + " " : "" ) +
+								( param_magnitude_p_secs_long  ? rtmag.GetLabel(MAG_P_LONG)  + "=" + MagToString(p->Rec().quake_mag[MAG_P_LONG] ) + " " : "" ) +
+								( param_magnitude_s_secs       ? rtmag.GetLabel(MAG_S)       + "=" + MagToString(p->Rec().quake_mag[MAG_S]      ) + " " : "" ) +
 								"km=" + ToString(RoundToInt(station->Distance(q.origin))) + " ",
 								min_ix, max_iy, fonth,fonth,
 								FONT_Y_IS_MAX, fontcolor);
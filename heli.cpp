@@ -40,10 +40,8 @@
 
 #include "heli.h"
 
-extern "C" {
-#include "picker/FilterPicker5.h"
-}
 #include "filter.h"
+#include "pick_queue.h"
 
 #include "config.h"
 
@@ -116,13 +114,13 @@ ostream& operator<< (ostream& os, const online_mean_t& m)
 *******************************************************************************/
 
 station_t :: station_t()
-	: z(NULL), n(NULL), e(NULL)
+	: z(NULL), n(NULL), e(NULL), picker_type(PICKER_FP5), index(-1)
 {}
 
-station_t :: station_t(const string & _name, float _lon, float _lat, float _dep, bool _isAccel, float _clipvalue, float _factor, const string & _ipaddress, const string & _net, const string & _channel_z, const string & _channel_n, const string & _channel_e)
+station_t :: station_t(const string & _name, float _lon, float _lat, float _dep, bool _isAccel, float _clipvalue, float _factor, const string & _ipaddress, const string & _net, const string & _channel_z, const string & _channel_n, const string & _channel_e, pickertype_t _picker_type)
 	:	gridplace_t(_name, _lon, _lat, _dep),
 		isAccel(_isAccel), clipvalue(_clipvalue), factor(_factor), ipaddress(_ipaddress), net(_net), channel_z(_channel_z), channel_n(_channel_n), channel_e(_channel_e),
-		z(NULL), n(NULL), e(NULL)
+		z(NULL), n(NULL), e(NULL), picker_type(_picker_type), index(-1)
 {}
 
 station_t :: ~station_t()
@@ -133,17 +131,19 @@ station_t :: ~station_t()
 }
 
 /*
-	Combine up to three component buffers (according to comp) to obtain the vector module.
+	Combine up to three component buffers (according to comp) to obtain the squared vector module.
 	Replace a missing horizontal component (or the one with less samples) with the other one.
 	When using three components and both horizontals are missing, replace them with the vertical.
-	The module waveform is written to one of the input buffers, overwriting it.
-	Return pointers to the first and last sample of the output, or NULL if not enough data is available.
+	The squared module waveform is written to one of the input buffers, overwriting it, and its peak is found in the same pass.
+	Return pointers to the first and last sample of the output and to the (first) peak sample, or NULL if not enough data is available.
+	Take the sqrt of the samples that are actually needed as module.
 */
-void station_t :: CombineComponents( magcomp_t comp, float *dz, int dz_num, float *dn, int dn_num, float *de, int de_num, float **out_first, float **out_last )
+void station_t :: CombineComponents( magcomp_t comp, float *dz, int dz_num, float *dn, int dn_num, float *de, int de_num, float **out_first, float **out_last, float **out_peak )
 {
-	*out_first = *out_last = NULL;
+	*out_first = *out_last = *out_peak = NULL;
 
-	float *b_first, *b_last, *b;
+	float *b_first, *b_last;
+	int peak_i;
 	switch (comp)
 	{
 		case MAGCOMP_VERTICAL:
@@ -153,11 +153,7 @@ void station_t :: CombineComponents( magcomp_t comp, float *dz, int dz_num, floa
 
 			b_first		=	dz;
 			b_last		=	dz + dz_num - 1;
-			b			=	dz;
-			for (; b <= b_last; b++)
-			{
-				*b = abs( *b );
-			}
+			peak_i		=	SqrModulusMax(dz, dz, dz_num);
 		}
 		break;
 
@@ -184,13 +180,7 @@ void station_t :: CombineComponents( magcomp_t comp, float *dz, int dz_num, floa
 
 			b_first		=	dn;
 			b_last		=	dn + dn_num - 1;
-			b			=	dn;
-			float *b1	=	de;
-			for (; b <= b_last; b++,b1++)
-			{
-				// FIXME optimize removing sqrt
-				*b = sqrt( Sqr(*b) + Sqr(*b1) );
-			}
+			peak_i		=	SqrModulusMax(dn, dn, de, dn_num);
 		}
 		break;
 
@@ -237,14 +227,7 @@ void station_t :: CombineComponents( magcomp_t comp, float *dz, int dz_num, floa
 
 			b_first		=	dz;
 			b_last		=	dz + dz_num - 1;
-			b			=	dz;
-			float *b1	=	dn;
-			float *b2	=	de;
-			for (; b <= b_last; b++,b1++,b2++)
-			{
-				// FIXME optimize removing sqrt
-				*b = sqrt( Sqr(*b) + Sqr(*b1) + Sqr(*b2) );
-			}
+			peak_i		=	SqrModulusMax(dz, dz, dn, de, dz_num);
 		}
 		break;
 
@@ -254,9 +237,10 @@ void station_t :: CombineComponents( magcomp_t comp, float *dz, int dz_num, floa
 
 	*out_first = b_first;
 	*out_last  = b_last;
+	*out_peak  = b_first + peak_i;
 }
 
-void heli_t :: GetSamples(secs_t pick_time, float duration, float **dest, int *num)
+void heli_t :: GetSamples(secs_t pick_time, float duration, alignedbuf_t & out, float **dest, int *num)
 {
 	Lock();
 
@@ -279,12 +263,11 @@ void heli_t :: GetSamples(secs_t pick_time, float duration, float **dest, int *n
 
 	float *s_first	=	&samples[first];
 
-	float *b_first	=	&buffer[first];
-	float *b_last	=	&buffer[last];
+	float *b_first	=	out.Get(*num, 0);
 
 	*dest = b_first;
 
-	memcpy(b_first, s_first, (b_last - b_first + 1) * sizeof(*b_first));
+	memcpy(b_first, s_first, (*num) * sizeof(*b_first));
 
 	Unlock();
 }
@@ -294,7 +277,7 @@ void heli_t :: GetSamples(secs_t pick_time, float duration, float **dest, int *n
 	relative to a pick: i.e. the ratio between the maximum after the arrival (pick_time + secs_delay over secs_after seconds)
 	and the RMS before the pick (over secs_before seconds). Return -1 if not enough data is available.
 */
-float station_t :: CalcPickSNR(magcomp_t comp, secs_t pick_time, float secs_before, float secs_delay, float secs_after)
+float station_t :: CalcPickSNR(magcomp_t comp, secs_t pick_time, float secs_before, float secs_delay, float secs_after, compbufs_t & bufs)
 {
 	float *dz     = NULL, *dn     = NULL, *de = NULL;
 	int    dz_num = 0,     dn_num = 0,     de_num = 0;
@@ -307,17 +290,17 @@ float station_t :: CalcPickSNR(magcomp_t comp, secs_t pick_time, float secs_befo
 	{
 		// Z
 		if (z != NULL)
-			z->GetSamples( pick_time - secs_t(secs_before), duration, &dz, &dz_num );
+			z->GetSamples( pick_time - secs_t(secs_before), duration, bufs.z, &dz, &dz_num );
 	}
 	if (comp != MAGCOMP_VERTICAL)
 	{
 		// N
 		if (n != NULL)
-			n->GetSamples( pick_time - secs_t(secs_before), duration, &dn, &dn_num );
+			n->GetSamples( pick_time - secs_t(secs_before), duration, bufs.n, &dn, &dn_num );
 
 		// E
 		if (e != NULL)
-			e->GetSamples( pick_time - secs_t(secs_before), duration, &de, &de_num );
+			e->GetSamples( pick_time - secs_t(secs_before), duration, bufs.e, &de, &de_num );
 	}
 
 	// Remove means
@@ -325,9 +308,9 @@ float station_t :: CalcPickSNR(magcomp_t comp, secs_t pick_time, float secs_befo
 	if (dn != NULL)	Rmean(dn, dn + dn_num - 1);
 	if (de != NULL)	Rmean(de, de + de_num - 1);
 
-	// Combine the samples buffers to obtain the vector module
-	float *b_first, *b_last, *b;
-	CombineComponents(comp, dz, dz_num, dn, dn_num, de, de_num, &b_first, &b_last);
+	// Combine the samples buffers to obtain the squared vector module
+	float *b_first, *b_last, *b_peak, *b;
+	CombineComponents(comp, dz, dz_num, dn, dn_num, de, de_num, &b_first, &b_last, &b_peak);
 	if (b_first == NULL)
 		return -1;
 
@@ -343,24 +326,32 @@ float station_t :: CalcPickSNR(magcomp_t comp, secs_t pick_time, float secs_befo
 	Clamp(num_arrival, 0, num_duration - 1);
 	float *b_arrival = b_first + num_arrival;
 
-	// Calc RMS before the pick
+	// Calc RMS before the pick (the buffer already holds squared samples)
 	float rms = 0;
 	for (b = b_first; b < b_pick; b++)
-		rms += Sqr(*b);
+		rms += *b;
 	rms = sqrt( rms / (b_pick - 1 - b_first + 1) );
 
 	// Find the maximum after the arrival
 	float peak = 0;
-	for (b = b_arrival; b <= b_last; b++)
+	if (b_peak >= b_arrival)
+	{
+		peak = *b_peak;
+	}
+	else
 	{
-		if (*b > peak)
-			peak = *b;
+		for (b = b_arrival; b <= b_last; b++)
+		{
+			if (*b > peak)
+				peak = *b;
+		}
 	}
+	peak = sqrt( peak );
 
 	return peak / NonZero(rms);
 }
 
-void station_t :: CalcPeakDisplacement( float fmin, float fmax, const string & label, magcomp_t comp, secs_t pick_time, float duration, float *disp_val, secs_t *disp_time )
+void station_t :: CalcPeakDisplacement( float fmin, float fmax, const string & label, magcomp_t comp, secs_t pick_time, float duration, float *disp_val, secs_t *disp_time, compbufs_t & bufs )
 {
 	float *dz     = NULL, *dn     = NULL, *de = NULL;
 	int    dz_num = 0,     dn_num = 0,     de_num = 0;
@@ -375,22 +366,22 @@ void station_t :: CalcPeakDisplacement( float fmin, float fmax, const string & l
 	{
 		// Z
 		if (z != NULL)
-			z->CalcDisplacementSamples( fmin, fmax, pick_time, duration, &dz, &dz_num );
+			z->CalcDisplacementSamples( fmin, fmax, pick_time, duration, bufs.z, &dz, &dz_num );
 	}
 	if (comp != MAGCOMP_VERTICAL)
 	{
 		// N
 		if (n != NULL)
-			n->CalcDisplacementSamples( fmin, fmax, pick_time, duration, &dn, &dn_num );
+			n->CalcDisplacementSamples( fmin, fmax, pick_time, duration, bufs.n, &dn, &dn_num );
 
 		// E
 		if (e != NULL)
-			e->CalcDisplacementSamples( fmin, fmax, pick_time, duration, &de, &de_num );
+			e->CalcDisplacementSamples( fmin, fmax, pick_time, duration, bufs.e, &de, &de_num );
 	}
 
-	// Combine the displacement buffers to obtain the displacement vector module
-	float *b_first, *b_last, *b;
-	CombineComponents(comp, dz, dz_num, dn, dn_num, de, de_num, &b_first, &b_last);
+	// Combine the displacement buffers to obtain the squared displacement vector module, and its peak
+	float *b_first, *b_last, *b_peak, *b;
+	CombineComponents(comp, dz, dz_num, dn, dn_num, de, de_num, &b_first, &b_last, &b_peak);
 	if (b_first == NULL)
 		return;
 
@@ -417,27 +408,14 @@ void station_t :: CalcPeakDisplacement( float fmin, float fmax, const string & l
 
 			secs_t t = 0;
 			for (b = b_first; b <= b_last; b++,t+=dt)
-				f << t << " " << *b * factor << endl;
+				f << t << " " << sqrt(*b) * factor << endl;
 
 			f << "END_SG2K_ASCII" << endl;
 		}
 	}
 
-	// Find the peak
-
-	float peak		=	0;
-	float *peak_b	=	b_first;
-	for (b = b_first; b <= b_last; b++)
-	{
-		if (*b > peak)
-		{
-			peak	=	*b;
-			peak_b	=	b;
-		}
-	}
-
-	*disp_val	=	peak * factor;
-	*disp_time	=	pick_time + (peak_b - b_first) * (duration / (b_last - b_first + 1));
+	*disp_val	=	sqrt(*b_peak) * factor;
+	*disp_time	=	pick_time + (b_peak - b_first) * (duration / (b_last - b_first + 1));
 }
 
 /*******************************************************************************
@@ -448,11 +426,14 @@ void station_t :: CalcPeakDisplacement( float fmin, float fmax, const string & l
 
 pick_t :: pick_t( secs_t _t, float _dt, int _polarity ) :
 		t(_t), dt(_dt), polarity(_polarity),
-		quake_id(pick_t::NO_QUAKE),
-		quake_rms(-1)
+		handle(pick_table.Acquire())
+{
+}
+
+pick_t :: pick_t( secs_t _t ) :
+		t(_t), dt(0), polarity(0),
+		handle(NO_PICK_HANDLE)
 {
-	for (int magtype = 0; magtype < MAG_SIZE; magtype++)
-		disp[magtype] = quake_mag[magtype] = -1;
 }
 
 ostream& operator<< (ostream& os, const pick_t& p)
@@ -479,44 +460,57 @@ void timespan_t :: Extend(secs_t _t0, secs_t _t1)
 	t1 = max(t1, _t1);
 }
 
-bool timespans_t :: Overlaps(secs_t t0, secs_t t1) const
+struct TimespanEndsBefore
 {
-	for (timespan_container_t::const_iterator c = timespans.begin(); c != timespans.end(); c++)
+	bool operator () ( const timespan_t & span, secs_t t ) const
 	{
-		if (c->Overlaps(t0, t1))
-			return true;
+		return span.GetT1() < t;
 	}
-	return false;
+};
+
+timespans_t::timespan_container_t::iterator timespans_t :: EndingAfter(secs_t t)
+{
+	return lower_bound(timespans.begin(), timespans.end(), t, TimespanEndsBefore());
+}
+
+timespans_t::timespan_container_t::const_iterator timespans_t :: EndingAfter(secs_t t) const
+{
+	return lower_bound(timespans.begin(), timespans.end(), t, TimespanEndsBefore());
+}
+
+bool timespans_t :: Overlaps(secs_t t0, secs_t t1) const
+{
+	timespan_container_t::const_iterator c = EndingAfter(t0);
+	return (c != timespans.end()) && c->Overlaps(t0, t1);
 }
 
 void timespans_t :: Add(secs_t t0, secs_t t1)
 {
-	bool added = false;
-	for (timespan_container_t::iterator c = timespans.begin(); c != timespans.end(); c++)
+	// In order to avoid tiny gaps beetween time spans (due to e.g. zero crossing
+	// between clipped samples), don't be too strict in checking for overlapping
+	const secs_t tolerance = 0.1;
+
+	// Merge all the spans overlapping the new one into the first of them
+	timespan_container_t::iterator first = EndingAfter(t0 - tolerance), last = first;
+	while (last != timespans.end() && last->Overlaps(t0 - tolerance, t1 + tolerance))
+		++last;
+
+	if (first == last)
 	{
-		// In order to avoid tiny gaps beetween time spans (due to e.g. zero crossing
-		// between clipped samples), don't be too strict in checking for overlapping
-		if (c->Overlaps(t0 - 0.1 , t1 + 0.1))
-		{
-			c->Extend(t0, t1);
-			added = true;
-		}
+		timespans.insert(first, timespan_t(t0, t1));
+		return;
 	}
 
-	if (!added)
-		timespans.push_back(timespan_t(t0, t1));
+	first->Extend(t0, t1);
+	for (timespan_container_t::iterator c = first + 1; c != last; ++c)
+		first->Extend(c->GetT0(), c->GetT1());
+	timespans.erase(first + 1, last);
 }
 
 void timespans_t :: PurgeBefore(secs_t tmin)
 {
-	timespan_container_t::iterator c = timespans.begin();
-	while (c != timespans.end())
-	{
-		if (c->GetT1() < tmin)
-			c = timespans.erase( c );
-		else
-			++c;
-	}
+	while (!timespans.empty() && timespans.front().GetT1() < tmin)
+		timespans.pop_front();
 }
 
 void timespans_t :: Clear()
@@ -563,10 +557,8 @@ heli_t::heli_err_t heli_t :: Init(const string & _url, int _num_samples, station
 	station		=	_station;
 
 	delete [] samples;
-	delete [] buffer;
 	samples = new float[num_samples];
-	buffer  = new float[num_samples];
-	if (samples == NULL || buffer == NULL)
+	if (samples == NULL)
 	{
 		num_samples = 0;
 		return SetError(ERR_FATAL);
@@ -636,6 +628,7 @@ heli_t::heli_err_t heli_t :: Update()
 	if ( samples_per_sec != samples_per_sec_new )
 	{
 		samples_per_sec = samples_per_sec_new;
+		InitDecimator();
 		ClearSamples();
 
 		end_time = end_time_new;
@@ -650,24 +643,13 @@ heli_t::heli_err_t heli_t :: Update()
 
 		if (param_waveform_clipping_secs > 0 && station->clipvalue > 0)
 		{
-			float *s_first_new	=	&samples_new[0];
-			float *s_last_new	=	&samples_new[num_samples_new - 1];
-
 			// Find the first clipped sample
-			float *s_clip	=	NULL;
-			for (float *s = s_first_new; s <= s_last_new; s++)
-			{
-				if ( abs(*s) >= station->clipvalue )
-				{
-					s_clip = s;
-					break;
-				}
-			}
+			int i_clip = FindFirstAbsAtLeast(samples_new, num_samples_new, station->clipvalue);
 
 			// Mark as clipped several seconds after the first clipped sample
-			if (s_clip != NULL)
+			if (i_clip >= 0)
 			{
-				secs_t t_clip = end_time_new - secs_t(num_samples_new - 1 - (s_clip - samples_new)) / (samples_per_sec_new - 1);
+				secs_t t_clip = end_time_new - secs_t(num_samples_new - 1 - i_clip) / (samples_per_sec_new - 1);
 				clipspans.Add(t_clip, t_clip + float(param_waveform_clipping_secs));
 			}
 		}
@@ -727,15 +709,30 @@ heli_t::heli_err_t heli_t :: Update()
 
 	if (!isGraph)
 	{
-		// Picking (only vertical component)
+		if (decimator.GetFactor() == 1)
+		{
+			// Picking (only vertical component)
+
+			if (station->z == this)
+				ComputePicks(samples_new, num_samples_new, start_time_new, samples_per_sec);
+
+			// Remove mean
 
-		if (station->z == this)
-			ComputePicks(samples_new, num_samples_new, start_time_new,
-				param_picker_filterWindow, param_picker_longTermWindow, param_picker_threshold1, param_picker_threshold2, param_picker_tUpEvent);
+			RmeanOverOneSecPackets(dest, samples_count, RoundToInt(samples_per_sec));
+		}
+		else
+		{
+			// Remove mean, then decimate and pick on the decimated samples (only vertical component)
 
-		// Remove mean
+			RmeanOverOneSecPackets(dest, samples_count, RoundToInt(samples_per_sec));
 
-		RmeanOverOneSecPackets(dest, samples_count, RoundToInt(samples_per_sec));
+			secs_t dest_start_time	=	start_time + secs_t(dest - samples) / samples_per_sec;
+			secs_t dec_start_time;
+			int dec_count = DecimatePacket(dest, samples_count, dest_start_time, &dec_start_time);
+
+			if (dec_count > 0 && station->z == this)
+				ComputePicks(dec_samples + dec_num_samples - dec_count, dec_count, dec_start_time, dec_samples_per_sec);
+		}
 	}
 
 	Unlock();
@@ -755,6 +752,13 @@ void heli_t :: ClearSamples()
 
 	mean_data.clear();
 
+	s = dec_samples;
+	if (s != NULL)
+		for (int num = dec_num_samples; num > 0; num--)
+			*s++ = 0;
+	decimator.Reset();
+	dec_end_time = dec_input_end_time = -1;
+
 	clipspans.Clear();
 }
 
@@ -857,6 +861,9 @@ void heli_t :: ResetMeanLatencies()
 	latency_data_mean.Reset();
 	latency_feed_mean.Reset();
 
+	picker_perf_ticks = picker_cmp_perf_ticks = 0;
+	picker_perf_samples = picker_cmp_perf_samples = 0;
+
 	Unlock();
 }
 
@@ -867,7 +874,12 @@ void heli_t :: LogMeanLatencies()
 	cout << SecsToString(SecsNow()) << ": LATENCY " << station->name <<
 			" " << latency_data_mean <<
 			" " << latency_feed_mean <<
-			endl;
+			" Pk " << PickerTypeName(station->picker_type) << " " << ((picker_perf_ticks == 0) ? 0.0 : double(picker_perf_samples) * SDL_GetPerformanceFrequency() / picker_perf_ticks) << " sps (wall)";
+
+	if (param_debug_picker_compare)
+		cout << " " << PickerTypeName(CmpPickerType()) << " " << ((picker_cmp_perf_ticks == 0) ? 0.0 : double(picker_cmp_perf_samples) * SDL_GetPerformanceFrequency() / picker_cmp_perf_ticks) << " sps (wall)";
+
+	cout << endl;
 
 	Unlock();
 }
@@ -891,49 +903,96 @@ secs_t heli_t :: EndTime()
 
 void heli_t :: FreePicker()
 {
-	free_PickList((PickData **)picker_picks, picker_num_picks);
-	picker_picks = NULL;
-	picker_num_picks = 0;
+	delete picker;
+	picker = NULL;
+
+	delete picker_cmp;
+	picker_cmp = NULL;
+
+	cmp_recent.clear();
+	cmp_recent_other.clear();
 
-	free_FilterPicker5_Memory((FilterPicker5_Memory**)&picker_mem);
-	picker_mem = NULL;
+	picker_engine.Reset(this);
 }
 
-void heli_t :: ClearPicks()
+// The picker run alongside the station one when comparing them
+pickertype_t heli_t :: CmpPickerType() const
 {
-	picks.clear();
-	new_picks.clear();
+	return (station->picker_type == PICKER_FP5) ? PICKER_STALTA : PICKER_FP5;
 }
 
-void heli_t :: GetNewPicks(picks_set_t & result)
+/*
+	Match the picks of the two pickers (found by the station picker, or by the other one if is_cmp) and log
+	the time difference of each pair (PICKDIFF). Picks left unmatched for a while are logged as missed by the other picker.
+*/
+void heli_t :: ComparePicks(const vector<picker_pick_t> & found, bool is_cmp)
 {
-	Lock();
+	const secs_t MATCH_SECS = 2, KEEP_SECS = 10;
 
-	result = new_picks;
+	vector<picker_pick_t> & mine	=	is_cmp ? cmp_recent_other : cmp_recent;
+	vector<picker_pick_t> & others	=	is_cmp ? cmp_recent : cmp_recent_other;
 
-	picks.insert(new_picks.begin(),new_picks.end());
-	new_picks.clear();
+	const char *name		=	PickerTypeName(station->picker_type);
+	const char *name_cmp	=	PickerTypeName(CmpPickerType());
 
-	Unlock();
-}
+	for (vector<picker_pick_t>::const_iterator p = found.begin(); p != found.end(); p++)
+	{
+		vector<picker_pick_t>::iterator best = others.end();
+		for (vector<picker_pick_t>::iterator o = others.begin(); o != others.end(); o++)
+			if ( fabs(o->t - p->t) <= MATCH_SECS && (best == others.end() || fabs(o->t - p->t) < fabs(best->t - p->t)) )
+				best = o;
 
-/**	Update Early Warning parameters associated to this pick (quake, displacements, magnitudes)
+		if (best == others.end())
+		{
+			mine.push_back(*p);
+			continue;
+		}
 
-	This method will also log a LINK message when the pick is first linked to a quake
+		secs_t t		=	is_cmp ? best->t : p->t;
+		secs_t t_cmp	=	is_cmp ? p->t : best->t;
 
-	@param pick		updated pick to copy over corresponding heli pick
-*/
-void heli_t :: UpdatePick(const pick_t & pick)
-{
-	Lock();
+		cout << SecsToString(SecsNow()) << ": PICKDIFF " << station->name << " " << SecsToString(t) << " " << name << "-" << name_cmp << " " << (t - t_cmp) << endl;
 
-	picks_set_t::iterator p = picks.find(pick);	// this is set::find and uses pick_t::operator<
+		others.erase(best);
+	}
 
-	if ( p != picks.end() )
+	// Purge old unmatched picks
+	vector<picker_pick_t> *lists[2] = { &cmp_recent, &cmp_recent_other };
+	for (int i = 0; i < 2; i++)
 	{
-		// FIXME: circumvent the fact we aren't allowed to change set elements
-		*const_cast<pick_t *>(&(*p)) = pick;
+		vector<picker_pick_t> & l = *lists[i];
+		vector<picker_pick_t>::iterator o = l.begin();
+		while (o != l.end())
+		{
+			if (o->t < end_time - KEEP_SECS)
+			{
+				cout << SecsToString(SecsNow()) << ": PICKDIFF " << station->name << " " << SecsToString(o->t) << " " << (i ? name_cmp : name) << " only" << endl;
+				o = l.erase(o);
+			}
+			else
+				++o;
+		}
 	}
+}
+
+void heli_t :: ClearPicks()
+{
+	picks.clear();
+}
+
+// Add the picks found by the batched picker engine (see ComputePicks)
+void heli_t :: AddPickerResults(const vector<picker_pick_t> & engine_picks, Uint64 perf_ticks, unsigned long perf_samples)
+{
+	Lock();
+
+	for (vector<picker_pick_t>::const_iterator p = engine_picks.begin(); p != engine_picks.end(); p++)
+		AddPick( pick_t(p->t, p->uncertainty, p->polarity) );
+
+	if (param_debug_picker_compare)
+		ComparePicks(engine_picks, false);
+
+	picker_perf_ticks	+=	perf_ticks;
+	picker_perf_samples	+=	perf_samples;
 
 	Unlock();
 }
@@ -956,7 +1015,11 @@ void heli_t :: PurgeOldPicks()
 
 bool heli_t :: AddPick( const pick_t & p )
 {
-	bool new_pick_found = new_picks.insert( p ).second;
+	bool new_pick_found = picks.insert( p ).second;
+
+	// Hand the new picks on the vertical component over to the binder
+	if ( new_pick_found && !isGraph && station->z == this )
+		pick_queue.Push(this, p);
 
 	PurgeOldPicks();
 
@@ -965,78 +1028,72 @@ bool heli_t :: AddPick( const pick_t & p )
 
 /**	Compute picks in the new sample packet and add them to the pick list
 
-	@param filterWindow		in seconds, determines how far back in time the previous samples are examined.
-							The filter window will be adjusted upwards to be an integer N power of 2 times the sample interval (deltaTime).
-							Then numRecursive = N + 1 "filter bands" are created.
-							For each filter band n = 0,N  the data samples are processed through a simple recursive filter backwards from the current sample,
-							and picking statistics and characteristic function are generated.
-							Picks are generated based on the maximum of the characteristic function values over all filter bands relative to the threshold values threshold1 and threshold2.
-
-	@param longTermWindow	determines:
-							a) a stabilisation delay time after the beginning of data; before this delay time picks will not be generated.
-							b) the decay constant of a simple recursive filter to accumulate/smooth all picking statistics and characteristic functions for all filter bands.
-
-	@param threshold1		sets the threshold to trigger a pick event (potential pick).
-							This threshold is reached when the (clipped) characteristic function for any filter band exceeds threshold1.
+	The picker is the one chosen for the station in stations.txt (see picker.h).
+	If it is FilterPicker5 and the batched picker engine is running, the packet is handed over to the engine
+	and the picks are added later on (AddPickerResults). In this case the return value is always false.
 
-	@param threshold2		sets the threshold to declare a pick (pick will be accepted when tUpEvent reached).
-							This threshold is reached when the integral of the (clipped) characteristic function for any filter band over the window tUpEvent exceeds threshold2 * tUpEvent
-							(i.e. the average (clipped) characteristic function over tUpEvent is greater than threshold2)..
-
-	@param tUpEvent			determines the maximum time the integral of the (clipped) characteristic function is accumulated
-							after threshold1 is reached (pick event triggered) to check for this integral exceeding threshold2 * tUpEvent (pick declared).
+	With param_debug_picker_compare, the other picker is run on the same packet too (see ComparePicks).
 */
 bool heli_t :: ComputePicks(
 	const float  *samples_new,
 	const int    num_samples_new,
 	const secs_t start_time_new,
-
-	const double filterWindow,
-	const double longTermWindow,
-	const double threshold1,
-	const double threshold2,
-	const double tUpEvent
+	const float  samples_per_sec_new
 )
 {
 	bool new_picks_found = false;
 
 	Lock();
 
-	if (samples_per_sec != 0)
+	if (samples_per_sec_new != 0)
 	{
-		double dt = 1.0 / samples_per_sec;
+		picker_found.clear();
 
-		// We use picker_picks as just a buffer to hold the resulting picks of the last packet.
-		// To avoid it growing arbitrarily large, free it from time to time.
-		if (picker_num_picks >= 12)	// better use a threshold smaller than SIZE_INCREMENT (16)
+		bool submitted =	(station->picker_type == PICKER_FP5) &&
+							picker_engine.Submit(this, samples_new, num_samples_new, start_time_new,
+								picker_params_t(1.0 / samples_per_sec_new, param_picker_filterWindow, param_picker_longTermWindow, param_picker_threshold1, param_picker_threshold2, param_picker_tUpEvent));
+
+		if (!submitted)
 		{
-			free_PickList((PickData **)picker_picks, picker_num_picks);
-			picker_picks = NULL;
-			picker_num_picks = 0;
-		}
+			if (picker == NULL)
+				picker = NewPicker(station->picker_type);
+
+			long allocs_before = picker->NumHeapAllocs();
+
+			Uint64 perf_start = SDL_GetPerformanceCounter();
+
+			picker->Process(samples_new, num_samples_new, start_time_new, samples_per_sec_new, picker_found);
 
-		int picker_num_picks_before = picker_num_picks;
+			picker_perf_ticks	+=	SDL_GetPerformanceCounter() - perf_start;
+			picker_perf_samples	+=	num_samples_new;
 
-		Pick_FP5(	dt,	samples_new,	num_samples_new,
-					filterWindow,		longTermWindow,		threshold1,		threshold2,		tUpEvent,
-					(FilterPicker5_Memory **)&picker_mem,	TRUE_INT,
-					(PickData ***)&picker_picks,
-					&picker_num_picks,
-					url.c_str()
-		);
+			// The picker hot path should not touch the heap
+			if (param_debug_picker_allocs && picker->NumHeapAllocs() != allocs_before)
+				cout << SecsToString(SecsNow()) << ": PICKALLOC " << station->name << " " << (picker->NumHeapAllocs() - allocs_before) << " heap allocations while picking " << num_samples_new << " samples" << endl;
 
-		for (int i = picker_num_picks_before; i < picker_num_picks; i++)
+			for (vector<picker_pick_t>::const_iterator p = picker_found.begin(); p != picker_found.end(); p++)
+			{
+				if ( AddPick( pick_t(p->t, p->uncertainty, p->polarity) ) )
+					new_picks_found = true;
+			}
+		}
+
+		if (param_debug_picker_compare)
 		{
-			PickData *pick_fp5 = ((PickData **)picker_picks)[i];
+			if (picker_cmp == NULL)
+				picker_cmp = NewPicker(CmpPickerType());
+
+			picker_cmp_found.clear();
 
-			pick_t p(
-				start_time_new + ((pick_fp5->indices[0] + pick_fp5->indices[1]) / 2 ) * dt,
-				float( (pick_fp5->indices[1] - pick_fp5->indices[0]) / 2 * dt ),
-				pick_fp5->polarity
-			);
+			Uint64 perf_start = SDL_GetPerformanceCounter();
 
-			if ( AddPick( p ) )
-				new_picks_found = true;
+			picker_cmp->Process(samples_new, num_samples_new, start_time_new, samples_per_sec_new, picker_cmp_found);
+
+			picker_cmp_perf_ticks	+=	SDL_GetPerformanceCounter() - perf_start;
+			picker_cmp_perf_samples	+=	num_samples_new;
+
+			ComparePicks(picker_found, false);
+			ComparePicks(picker_cmp_found, true);
 		}
 	}
 
@@ -1107,6 +1164,113 @@ void heli_t :: RmeanOverOneSecPackets(float *dest, int samples_count, int sps)
 	}
 }
 
+// Choose the decimation factor for the current sample rate and allocate the decimated samples buffer
+void heli_t :: InitDecimator()
+{
+	int factor = 1;
+	if (!isGraph && param_waveform_decimate_sps > 0)
+		factor = int(samples_per_sec / param_waveform_decimate_sps);
+	if (factor < 2)
+		factor = 1;
+
+	decimator.Init(factor);
+
+	delete [] dec_samples;
+	dec_samples			=	NULL;
+	dec_num_samples		=	0;
+	dec_samples_per_sec	=	samples_per_sec / factor;
+
+	if (factor > 1)
+	{
+		dec_num_samples	=	num_samples / factor;
+		dec_samples		=	new float[dec_num_samples];
+	}
+}
+
+// Feed num continuous samples starting at src_start_time to the decimator, and append the output to the decimated samples buffer.
+// Return the number of decimated samples added (at the end of the buffer) and the time of the first one.
+int heli_t :: DecimatePacket(const float *src, int num, secs_t src_start_time, secs_t *dec_start_time)
+{
+	if (num <= 0 || dec_num_samples <= 0)
+		return 0;
+
+	secs_t src_end_time = src_start_time + secs_t(num) / samples_per_sec;
+
+	// Late packets can't be fed to the decimator, that needs increasing times
+	if (dec_input_end_time != -1 && src_end_time <= dec_input_end_time)
+		return 0;
+
+	// Restart the filter (and the picker working on its output) on gaps
+	bool isGap = (dec_input_end_time == -1) || (abs(src_start_time - dec_input_end_time) > 0.05);
+	if (isGap)
+	{
+		decimator.Reset();
+		FreePicker();
+	}
+	dec_input_end_time = src_end_time;
+
+	int dec_count = decimator.NumOutputs(num);
+	if (dec_count <= 0)
+		return 0;
+
+	// Output samples are taken every factor input samples, delayed by the filter
+	int src_first_out = decimator.GetFactor() - 1 - decimator.GetPhase();
+	*dec_start_time = src_start_time + secs_t(src_first_out - decimator.GetDelay()) / samples_per_sec;
+
+	secs_t dec_end_time_new = *dec_start_time + secs_t(dec_count) / dec_samples_per_sec;
+
+	// Scroll out old samples to make room for the new ones (on gaps, scroll by the elapsed time)
+	int samples_scroll = dec_count;
+	if (isGap)
+		samples_scroll = (dec_end_time == -1) ? dec_num_samples : max(dec_count, RoundToInt( min((dec_end_time_new - dec_end_time) * dec_samples_per_sec, (secs_t)dec_num_samples) ));
+	samples_scroll = min(samples_scroll, dec_num_samples);
+
+	if ((dec_num_samples - samples_scroll) > 0)
+		memmove(dec_samples, dec_samples + samples_scroll, (dec_num_samples - samples_scroll) * sizeof(dec_samples[0]));
+
+	float *s = dec_samples + (dec_num_samples - samples_scroll);
+	int s_num = samples_scroll;
+	while (s_num--)
+		*s++ = 0;
+
+	dec_end_time = dec_end_time_new;
+
+	// Decimate the packet
+
+	if (dec_count <= dec_num_samples)
+		decimator.Process(src, num, dec_samples + dec_num_samples - dec_count);
+	else
+	{
+		// Packet longer than the whole buffer: keep its end only
+		vector<float> dec_all(dec_count);
+		decimator.Process(src, num, &dec_all[0]);
+		memcpy(dec_samples, &dec_all[dec_count - dec_num_samples], dec_num_samples * sizeof(dec_samples[0]));
+		*dec_start_time += secs_t(dec_count - dec_num_samples) / dec_samples_per_sec;
+		dec_count = dec_num_samples;
+	}
+
+	return dec_count;
+}
+
+// Samples used for processing (picking, displacement): the decimated ones if decimating, the full rate ones otherwise
+void heli_t :: GetProcessingSamples(float **buf, int *num, float *sps, secs_t *t_end)
+{
+	if (decimator.GetFactor() > 1)
+	{
+		*buf	=	dec_samples;
+		*num	=	dec_num_samples;
+		*sps	=	dec_samples_per_sec;
+		*t_end	=	dec_end_time;
+	}
+	else
+	{
+		*buf	=	samples;
+		*num	=	num_samples;
+		*sps	=	samples_per_sec;
+		*t_end	=	end_time;
+	}
+}
+
 bool heli_t :: HasClipping(secs_t t0, secs_t t1)
 {
 	Lock();
@@ -1117,21 +1281,28 @@ bool heli_t :: HasClipping(secs_t t0, secs_t t1)
 	return hasClipping;
 }
 
-void heli_t :: CalcDisplacementSamples( float fmin, float fmax, secs_t pick_time, float duration, float **dest, int *num )
+void heli_t :: CalcDisplacementSamples( float fmin, float fmax, secs_t pick_time, float duration, alignedbuf_t & out, float **dest, int *num )
 {
 	Lock();
 
 	// Calc displacement over a larger window than requested (it should give a more accurate integral)
 	float secs_before = float(param_magnitude_secs_before_window);
 
-	secs_t start_time = end_time - secs_t(num_samples) / NonZero(samples_per_sec);
+	// Use the decimated samples, if available
+	float *src;
+	int src_num;
+	float src_sps;
+	secs_t src_end_time;
+	GetProcessingSamples(&src, &src_num, &src_sps, &src_end_time);
 
-	*num = RoundToInt( samples_per_sec * (duration+secs_before) );
+	secs_t start_time = src_end_time - secs_t(src_num) / NonZero(src_sps);
 
-	int first	=	RoundToInt( (float(pick_time - start_time) - secs_before) * samples_per_sec );
+	*num = RoundToInt( src_sps * (duration+secs_before) );
+
+	int first	=	RoundToInt( (float(pick_time - start_time) - secs_before) * src_sps );
 	int last	=	first + *num - 1;
 
-	if ( end_time == -1 || first < 0 || last < 0 || first >= num_samples || last >= num_samples ||
+	if ( src_end_time == -1 || first < 0 || last < 0 || first >= src_num || last >= src_num ||
 	     HasClipping(pick_time - secs_before, pick_time + duration)	)
 	{
 		*dest = NULL;
@@ -1141,29 +1312,32 @@ void heli_t :: CalcDisplacementSamples( float fmin, float fmax, secs_t pick_time
 		return;
 	}
 
-	float dt = 1.0f / samples_per_sec;
+	float dt = 1.0f / src_sps;
 
-	float *s_first/*, *s_last*/;
-	float *b_first, *b_last;
+	// Samples before the requested window are only needed to settle the integrals and filter.
+	// Place them so that the requested window starts on an aligned address
+
+	int samples_before = RoundToInt(secs_before * src_sps);
 
-	s_first	=	&samples[first];
-//	s_last	=	&samples[last];
+	float *s_first, *s_last;
+	float *b_first;
 
-	b_first	=	&buffer[first];
-	b_last	=	&buffer[last];
+	s_first	=	&src[first];
+	s_last	=	&src[last];
+
+	b_first	=	out.Get(*num, samples_before);
 
 	*dest = b_first;
 
-	memcpy(b_first, s_first, (b_last - b_first + 1) * sizeof(*b_first));
+	// Copy, integrate (twice for accelerometers) and filter in a single pass over the samples
 
-	Integrate(b_first, b_last, dt);
 	if (station->isAccel)
-		Integrate(b_first, b_last, dt);
-	Filter(b_first, b_last, fmin, fmax, dt);
+		Process(s_first, s_last, b_first, Stages(Stage_Integrate<float>(dt), Stages(Stage_Integrate<float>(dt), Stage_Filter(fmin, fmax, dt))));
+	else
+		Process(s_first, s_last, b_first, Stages(Stage_Integrate<float>(dt), Stage_Filter(fmin, fmax, dt)));
 
 	// Skip secs_before seconds to return the time window that was actually requested
 
-	int samples_before = RoundToInt(secs_before * samples_per_sec);
 	*dest += samples_before;
 	*num  -= samples_before;
 
@@ -1606,6 +1780,7 @@ void timeseries_t :: Stop()
 	heli_t :: Stop();
 
 	data.clear();
+	ClearPicks();	// the marker
 }
 
 void timeseries_t :: Start()
@@ -1671,8 +1846,6 @@ void timeseries_t :: SetMarker(secs_t time)
 
 	ClearPicks();
 	AddPick( pick_t(time,0.1f,0) );
-	picks_set_t temp;
-	GetNewPicks(temp);
 
 	Unlock();
 }
@@ -49,6 +49,10 @@
 #include "place.h"
 #include "origin.h"
 #include "rtmag.h"
+#include "vecmod.h"
+#include "filter.h"
+#include "picker_engine.h"
+#include "pick_table.h"
 
 /*******************************************************************************
 
@@ -97,14 +101,38 @@ public:
 	secs_t t;
 	float dt;
 	int polarity;
-	int quake_id;
-	float disp[MAG_SIZE];
-	float quake_mag[MAG_SIZE];
-	float quake_rms;
 
 	pick_t( secs_t _t, float _dt, int _polarity );
+	// A key for searching picks by time: it has no Early Warning record (Rec must not be called), so it does not touch the pick table
+	explicit pick_t( secs_t _t );
 	pick_t();	// prevent the compiler from generating a default constructor
 
+	// Copies share the Early Warning parameters (see pick_table.h)
+	pick_t(const pick_t & rhs) : t(rhs.t), dt(rhs.dt), polarity(rhs.polarity), handle(rhs.handle)
+	{
+		pick_table.AddRef(handle);
+	}
+	pick_t & operator = (const pick_t & rhs)
+	{
+		pick_table.AddRef(rhs.handle);
+		pick_table.DecRef(handle);
+		t			=	rhs.t;
+		dt			=	rhs.dt;
+		polarity	=	rhs.polarity;
+		handle		=	rhs.handle;
+		return *this;
+	}
+	~pick_t()
+	{
+		pick_table.DecRef(handle);
+	}
+
+	// Early Warning parameters (quake, displacements, magnitudes), written by the binder and read by the display
+	pick_rec_t & Rec() const
+	{
+		return pick_table.Get(handle);
+	}
+
 	// a == b <-> !(a < b) && !(b < a)
 	bool operator < (const pick_t & rhs) const
 	{
@@ -118,6 +146,10 @@ public:
 	}
 
 	friend ostream& operator<< (ostream& os, const pick_t& p);
+
+private:
+
+	pick_handle_t handle;
 };
 
 typedef set<pick_t> picks_set_t;
@@ -127,6 +159,10 @@ typedef set<pick_t> picks_set_t;
 	timespans_t - A collection of time spans on the helicorder.
                   Used to record time ranges containing clipped samples.
 
+	The time spans are kept sorted and merged (disjoint), so that both their
+	starts and ends are increasing: overlap queries are binary searches, and
+	old spans are purged from the front.
+
 *******************************************************************************/
 
 class timespan_t
@@ -155,9 +191,13 @@ public:
 class timespans_t
 {
 private:
-	typedef list<timespan_t> timespan_container_t;
+	typedef deque<timespan_t> timespan_container_t;
 	timespan_container_t timespans;
 
+	// First time span ending at or after t (or end)
+	timespan_container_t::iterator EndingAfter(secs_t t);
+	timespan_container_t::const_iterator EndingAfter(secs_t t) const;
+
 public:
 
 	typedef timespan_container_t::iterator iterator;
@@ -248,7 +288,7 @@ private:
 	heli_err_t	error;
 	secs_t		error_secs;
 
-	float *samples, *buffer;
+	float *samples;
 	int num_samples;
 
 	secs_t end_time;
@@ -266,6 +306,19 @@ private:
 
 	deque<mean_data_t> mean_data;
 
+	// Decimated copy of the (mean removed) samples, fed to the picker and the displacement calculations
+	// when param_waveform_decimate_sps is set. The full rate samples are kept for display.
+	decimator_t decimator;
+	float *dec_samples;
+	int dec_num_samples;
+	secs_t dec_end_time;		// time after the last decimated sample
+	secs_t dec_input_end_time;	// time after the last sample fed to the decimator
+	float dec_samples_per_sec;
+
+	void InitDecimator();
+	int DecimatePacket(const float *src, int num, secs_t src_start_time, secs_t *dec_start_time);
+	void GetProcessingSamples(float **buf, int *num, float *sps, secs_t *t_end);
+
 	// fill with 0
 	void ClearSamples();
 
@@ -318,13 +371,23 @@ private:
 
 	timespans_t clipspans;	// time spans containing clipped samples
 
-	picks_set_t picks, new_picks;
+	picks_set_t picks;
+
+	picker_t *picker;			// created on the first packet, unless the batched picker engine is used
+	picker_t *picker_cmp;		// the other picker, run on the same packets to compare them (param_debug_picker_compare)
+	vector<picker_pick_t> picker_found, picker_cmp_found;
 
-	void *picker_mem;
-	void *picker_picks;
-	int  picker_num_picks;
+	// Recent picks of the two pickers not yet matched by ComparePicks
+	vector<picker_pick_t> cmp_recent, cmp_recent_other;
+
+	// Picker throughput (samples processed per second of wall-clock time spent picking, so it also counts
+	// the preemption and lock waits of the picking thread), logged with the latencies
+	Uint64 picker_perf_ticks, picker_cmp_perf_ticks;
+	unsigned long picker_perf_samples, picker_cmp_perf_samples;
 
 	void FreePicker();
+	pickertype_t CmpPickerType() const;
+	void ComparePicks(const vector<picker_pick_t> & found, bool is_cmp);
 
 protected:
 
@@ -367,12 +430,16 @@ public:
 		url = "";
 
 		samples = NULL;
-		buffer = NULL;
 		num_samples = 0;
 
-		picker_mem = NULL;
-		picker_picks = NULL;
-		picker_num_picks = 0;
+		dec_samples = NULL;
+		dec_num_samples = 0;
+
+		picker = NULL;
+		picker_cmp = NULL;
+
+		picker_perf_ticks = picker_cmp_perf_ticks = 0;
+		picker_perf_samples = picker_cmp_perf_samples = 0;
 
 		Stop();
 	}
@@ -381,8 +448,11 @@ public:
 	{
 		Stop();
 
+		delete picker;
+		delete picker_cmp;
+
 		delete [] samples;
-		delete [] buffer;
+		delete [] dec_samples;
 	}
 
 	virtual heli_err_t Init(const string & url, int num_samples, station_t *_station, bool _isGraph = false);
@@ -399,19 +469,13 @@ public:
 		const float  *samples_new,
 		const int    num_samples_new,
 		const secs_t start_time_new,
-
-		const double filterWindow,		// in seconds, determines how far back in time the previous samples are examined.  The filter window will be adjusted upwards to be an integer N power of 2 times the sample interval (deltaTime).  Then numRecursive = N + 1 "filter bands" are created.  For each filter band n = 0,N  the data samples are processed through a simple recursive filter backwards from the current sample, and picking statistics and characteristic function are generated.  Picks are generated based on the maximum of the characteristic function values over all filter bands relative to the threshold values threshold1 and threshold2.
-		const double longTermWindow,	// determines: a) a stabilisation delay time after the beginning of data; before this delay time picks will not be generated. b) the decay constant of a simple recursive filter to accumulate/smooth all picking statistics and characteristic functions for all filter bands.
-		const double threshold1,		// sets the threshold to trigger a pick event (potential pick).  This threshold is reached when the (clipped) characteristic function for any filter band exceeds threshold1.
-		const double threshold2,		// sets the threshold to declare a pick (pick will be accepted when tUpEvent reached).  This threshold is reached when the integral of the (clipped) characteristic function for any filter band over the window tUpEvent exceeds threshold2 * tUpEvent (i.e. the average (clipped) characteristic function over tUpEvent is greater than threshold2)..
-		const double tUpEvent			// determines the maximum time the integral of the (clipped) characteristic function is accumulated after threshold1 is reached (pick event triggered) to check for this integral exceeding threshold2 * tUpEvent (pick declared).
+		const float  samples_per_sec_new
 	);
 
-	void GetNewPicks(picks_set_t & result);
-	void UpdatePick(const pick_t & pick);
+	void AddPickerResults(const vector<picker_pick_t> & engine_picks, Uint64 perf_ticks, unsigned long perf_samples);
 
-	void GetSamples(secs_t pick_time, float duration, float **dest, int *num);
-	void CalcDisplacementSamples(float fmin, float fmax, secs_t pick_time, float duration, float **dest, int *num);
+	void GetSamples(secs_t pick_time, float duration, alignedbuf_t & out, float **dest, int *num);
+	void CalcDisplacementSamples(float fmin, float fmax, secs_t pick_time, float duration, alignedbuf_t & out, float **dest, int *num);
 
 	bool IsLaggingOrFuture();
 	secs_t EndTime();
@@ -557,6 +621,13 @@ public:
 	void SetMarker(secs_t time);
 };
 
+// Scratch buffers for the 3 components of a station. Each thread computing
+// SNRs or displacements needs its own set (see binder_t)
+struct compbufs_t
+{
+	alignedbuf_t z, n, e;
+};
+
 /*******************************************************************************
 
 	station_t - A station is a place_t, an IP address and 3 data streams (heli_t)
@@ -575,13 +646,17 @@ public:
 	string channel_z, channel_n, channel_e;
 	heli_t *z, *n, *e;
 
+	pickertype_t picker_type;	// picker run on the vertical component
+
+	int index;					// position in the stations vector, once loaded (-1 before)
+
 	station_t();
-	station_t(const string & _name, float _lon, float _lat, float _dep, bool _isAccel, float _clipvalue, float _factor, const string & _ipaddress, const string & _net, const string & _channel_z, const string & _channel_n, const string & _channel_e);
+	station_t(const string & _name, float _lon, float _lat, float _dep, bool _isAccel, float _clipvalue, float _factor, const string & _ipaddress, const string & _net, const string & _channel_z, const string & _channel_n, const string & _channel_e, pickertype_t _picker_type);
 	~station_t();
 
-	void CombineComponents(magcomp_t comp, float *dz, int dz_num, float *dn, int dn_num, float *de, int de_num, float **out_first, float **out_last);
-	float CalcPickSNR(magcomp_t comp, secs_t pick_time, float secs_before, float secs_delay, float secs_after);
-	void CalcPeakDisplacement(float fmin, float fmax, const string & label, magcomp_t comp, secs_t pick_time, float duration, float *disp_val, secs_t *disp_time);
+	void CombineComponents(magcomp_t comp, float *dz, int dz_num, float *dn, int dn_num, float *de, int de_num, float **out_first, float **out_last, float **out_peak);
+	float CalcPickSNR(magcomp_t comp, secs_t pick_time, float secs_before, float secs_delay, float secs_after, compbufs_t & bufs);
+	void CalcPeakDisplacement(float fmin, float fmax, const string & label, magcomp_t comp, secs_t pick_time, float duration, float *disp_val, secs_t *disp_time, compbufs_t & bufs);
 };
 
 struct StationName : public binary_function< station_t, string, bool >
@@ -590,6 +590,10 @@ int main(int argc, char *argv[])
 
 	Init_Net();
 
+	// Shared records of the picks
+
+	pick_table.Init();
+
 
 
 	// Set the initial state
@@ -84,6 +84,33 @@ pgx_t :: pgx_t()
 {
 }
 
+pgx_t :: pgx_t(const pgx_t & other)
+:	expr(other.expr)
+{
+	if (!expr.empty())
+		SetParser();
+}
+
+pgx_t & pgx_t :: operator=(const pgx_t & other)
+{
+	if (this != &other)
+	{
+		expr = other.expr;
+		if (!expr.empty())
+			SetParser();
+	}
+	return *this;
+}
+
+void pgx_t :: SetParser()
+{
+	parser.DefineVar("Mag",		&pgxMag);
+	parser.DefineVar("R_epi",	&pgxR_epi);
+	parser.DefineVar("Dep",		&pgxDep);
+
+	parser.SetExpr(expr);
+}
+
 void pgx_t :: Init( const string & filename )
 {
 	// Load formula
@@ -131,11 +158,8 @@ void pgx_t :: Init( const string & filename )
 
 	cout << "==================================================================================================" << endl;
 
-	parser.DefineVar("Mag",		&pgxMag);
-	parser.DefineVar("R_epi",	&pgxR_epi);
-	parser.DefineVar("Dep",		&pgxDep);
-
-	parser.SetExpr( formula_pgx + (formula_err.empty() ? "" : ("," + formula_err)) );
+	expr = formula_pgx + (formula_err.empty() ? "" : ("," + formula_err));
+	SetParser();
 
 	// Test the formulas
 
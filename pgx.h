@@ -36,7 +36,8 @@
 
 using namespace mu;
 
-// *** Important: do not use pgx_t objects from threads other than the main one
+// *** Important: a pgx_t object must not be used by more than one thread at a time.
+//     Copies get their own parser, so give each thread its own copy
 class pgx_t
 {
 private:
@@ -45,9 +46,16 @@ private:
 
 	value_type pgxMag, pgxR_epi, pgxDep;
 
+	string expr;	// formulas, separated by a comma
+
+	// Bind the variables and the formulas to the parser
+	void SetParser();
+
 public:
 
 	pgx_t();
+	pgx_t(const pgx_t & other);
+	pgx_t & operator=(const pgx_t & other);
 
 	void Init(const string & filename);
 
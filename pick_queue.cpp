@@ -0,0 +1,74 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	Lock-free queue of new picks (see pick_queue.h)
+
+*******************************************************************************/
+
+#include "SDL_atomic.h"
+
+#include "pick_queue.h"
+
+pick_queue_t pick_queue;
+
+void pick_queue_t :: Free(node_t *n)
+{
+	while (n != NULL)
+	{
+		node_t *next = n->next;
+		delete n;
+		n = next;
+	}
+}
+
+void pick_queue_t :: Push(heli_t *heli, const pick_t & pick)
+{
+	node_t *n = new node_t(heli, pick);
+
+	void *old_head;
+	do
+	{
+		old_head	=	SDL_AtomicGetPtr(&head);
+		n->next		=	(node_t *)old_head;
+	}
+	while ( !SDL_AtomicCASPtr(&head, old_head, n) );
+}
+
+bool pick_queue_t :: PopAll(binder_picks_set_t & result)
+{
+	// Idle case: a single atomic read
+	if (SDL_AtomicGetPtr(&head) == NULL)
+		return false;
+
+	node_t *list = (node_t *)SDL_AtomicSetPtr(&head, NULL);
+
+	for (node_t *n = list; n != NULL; n = n->next)
+		result.insert(n->bp);
+
+	Free(list);
+
+	return true;
+}
+
+void pick_queue_t :: Clear()
+{
+	Free( (node_t *)SDL_AtomicSetPtr(&head, NULL) );
+}
@@ -0,0 +1,77 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	pick_queue_t - New picks, from the channel threads to the binder
+
+	Lock-free, multiple producers (the channels, or the picker engine thread)
+	and a single consumer (the binder). Producers push onto a linked stack
+	with compare-and-swap, and the consumer detaches the whole stack with a
+	single atomic exchange. Since nodes are only ever removed all at once,
+	the stack is not exposed to the ABA problem.
+
+	Checking an empty queue is just an atomic read, so the binder does not
+	need to visit every channel on idle ticks.
+
+*******************************************************************************/
+
+#ifndef PICK_QUEUE_H_DEF
+#define PICK_QUEUE_H_DEF
+
+#include "quake.h"
+
+class pick_queue_t
+{
+private:
+
+	struct node_t
+	{
+		binder_pick_t bp;
+		node_t *next;
+
+		node_t(heli_t *heli, const pick_t & pick) : bp(heli, pick), next(NULL)	{ }
+	};
+
+	void *head;		// node_t *, most recent first
+
+	// non copyable
+	pick_queue_t(const pick_queue_t &);
+	pick_queue_t & operator=(const pick_queue_t &);
+
+	static void Free(node_t *n);
+
+public:
+
+	pick_queue_t() : head(NULL)	{ }
+	~pick_queue_t()				{ Clear(); }
+
+	// Producers (any thread)
+	void Push(heli_t *heli, const pick_t & pick);
+
+	// Consumer: insert all the queued picks into result. Return false if there were none
+	bool PopAll(binder_picks_set_t & result);
+
+	// Drop the queued picks (e.g. when the channels are restarted)
+	void Clear();
+};
+
+extern pick_queue_t pick_queue;
+
+#endif
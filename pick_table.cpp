@@ -0,0 +1,127 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	Shared records of the picks (see pick_table.h)
+
+*******************************************************************************/
+
+#include "pick_table.h"
+
+#include "global.h"
+#include "heli.h"
+
+pick_table_t pick_table;
+
+pick_table_t :: pick_table_t()
+:	num_blocks(0), free_head(NO_PICK_HANDLE), shut_down(false), mutex(NULL)
+{
+}
+
+pick_table_t :: ~pick_table_t()
+{
+	// The records are only freed by Shutdown: on other exit paths, picks held by other globals may be released after this table is gone
+	if (mutex != NULL)
+	{
+		SDL_DestroyMutex(mutex);
+		mutex = NULL;
+	}
+}
+
+void pick_table_t :: Init()
+{
+	if (mutex == NULL)
+	{
+		mutex = SDL_CreateMutex();
+		if (mutex == NULL)
+			Fatal_Error("Can't create pick table mutex");
+	}
+}
+
+void pick_table_t :: Shutdown()
+{
+	shut_down	=	true;
+
+	for (int b = 0; b < num_blocks; b++)
+	{
+		delete [] blocks[b];
+		blocks[b] = NULL;
+	}
+	num_blocks	=	0;
+	free_head	=	NO_PICK_HANDLE;
+
+	if (mutex != NULL)
+	{
+		SDL_DestroyMutex(mutex);
+		mutex = NULL;
+	}
+}
+
+pick_handle_t pick_table_t :: Acquire()
+{
+	Lock();
+
+	if (free_head == NO_PICK_HANDLE)
+	{
+		if (num_blocks == MAX_BLOCKS)
+		{
+			Unlock();
+			Fatal_Error("Too many picks (more than " + ToString(MAX_BLOCKS * BLOCK_SIZE) + ")");
+		}
+
+		blocks[num_blocks] = new pick_rec_t[BLOCK_SIZE];
+
+		// Hand out the lowest handles first
+		for (int i = BLOCK_SIZE - 1; i >= 0; i--)
+		{
+			blocks[num_blocks][i].next_free = free_head;
+			free_head = (num_blocks << BLOCK_BITS) + i;
+		}
+
+		++num_blocks;
+	}
+
+	pick_handle_t h = free_head;
+	free_head = Get(h).next_free;
+
+	Unlock();
+
+	pick_rec_t & r = Get(h);
+
+	SDL_AtomicSet(&r.refs, 1);
+
+	r.quake_id	=	pick_t::NO_QUAKE;
+	for (int i = 0; i < MAG_SIZE; i++)
+	{
+		r.disp[i]		=	-1;
+		r.quake_mag[i]	=	-1;
+	}
+	r.quake_rms	=	-1;
+
+	return h;
+}
+
+void pick_table_t :: Release(pick_handle_t h)
+{
+	Lock();
+	Get(h).next_free = free_head;
+	free_head = h;
+	Unlock();
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	pick_table_t - Early Warning parameters of the picks
+
+	Each pick owns a record in this table, referenced by an integer handle.
+	All the copies of a pick (in the channel, the pick queue, the binder and
+	its quakes) share the same record, so the quake id, displacements and
+	magnitudes computed by the binder are seen at once by the display.
+
+	Records are reference counted by pick_t and recycled when the last copy
+	of a pick goes away. They live in fixed-size blocks that never move, so
+	that a handle can be dereferenced without locking: only acquiring and
+	releasing records take the table mutex.
+
+	The table is set up by Init (at startup) and torn down by Shutdown (on
+	exit), once every pick is gone (see End_Heli). Copies of a pick missed
+	there and released afterwards (by the destructors of the globals) are
+	ignored, instead of touching the freed records.
+
+*******************************************************************************/
+
+#ifndef PICK_TABLE_H_DEF
+#define PICK_TABLE_H_DEF
+
+#include "SDL_thread.h"
+#include "SDL_atomic.h"
+
+#include "rtmag.h"
+
+typedef int pick_handle_t;
+
+const pick_handle_t NO_PICK_HANDLE = -1;	// a pick with no record (a search key), ignored by AddRef and DecRef
+
+struct pick_rec_t
+{
+	SDL_atomic_t refs;
+	pick_handle_t next_free;
+
+	int quake_id;
+	float disp[MAG_SIZE];
+	float quake_mag[MAG_SIZE];
+	float quake_rms;
+};
+
+class pick_table_t
+{
+private:
+
+	enum { BLOCK_BITS = 10, BLOCK_SIZE = 1 << BLOCK_BITS, MAX_BLOCKS = 1024 };
+
+	pick_rec_t *blocks[MAX_BLOCKS];
+	int num_blocks;
+
+	pick_handle_t free_head;	// list of the released records, linked by next_free (NO_PICK_HANDLE = empty)
+
+	bool shut_down;				// records freed, AddRef and DecRef do nothing
+
+	SDL_mutex *mutex;
+
+	void Lock()		{ if (mutex) SDL_LockMutex(mutex);		}
+	void Unlock()	{ if (mutex) SDL_UnlockMutex(mutex);	}
+
+	void Release(pick_handle_t h);
+
+	// non copyable
+	pick_table_t(const pick_table_t &);
+	pick_table_t & operator=(const pick_table_t &);
+
+public:
+
+	pick_table_t();
+	~pick_table_t();
+
+	void Init();
+	// Free all the records: no pick may be used afterwards
+	void Shutdown();
+
+	// A new record (reference count 1) with no quake and undefined displacements and magnitudes
+	pick_handle_t Acquire();
+
+	void AddRef(pick_handle_t h)	{ if (h != NO_PICK_HANDLE && !shut_down) SDL_AtomicIncRef(&Get(h).refs); }
+	void DecRef(pick_handle_t h)	{ if (h != NO_PICK_HANDLE && !shut_down && SDL_AtomicDecRef(&Get(h).refs)) Release(h); }
+
+	pick_rec_t & Get(pick_handle_t h) const
+	{
+		return blocks[h >> BLOCK_BITS][h & (BLOCK_SIZE - 1)];
+	}
+};
+
+extern pick_table_t pick_table;
+
+#endif
@@ -0,0 +1,280 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	Pickers (see picker.h)
+
+*******************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+
+#include "picker.h"
+
+extern "C" {
+#include "picker/FilterPicker5.h"
+}
+
+#include "config.h"
+
+using namespace std;
+
+const char *PickerTypeName(pickertype_t type)
+{
+	switch (type)
+	{
+		case PICKER_STALTA:	return "STALTA";
+		case PICKER_FP5:
+		default:			return "FP5";
+	}
+}
+
+bool StringToPickerType(const string & s, pickertype_t *type)
+{
+	if (s == "FP5")
+	{
+		*type = PICKER_FP5;
+		return true;
+	}
+	if (s == "STALTA")
+	{
+		*type = PICKER_STALTA;
+		return true;
+	}
+	return false;
+}
+
+picker_t *NewPicker(pickertype_t type)
+{
+	switch (type)
+	{
+		case PICKER_STALTA:
+			return new picker_stalta_t(	param_picker_stalta_sta_secs, param_picker_stalta_lta_secs,
+										param_picker_stalta_on, param_picker_stalta_off, param_picker_stalta_aic_secs	);
+
+		case PICKER_FP5:
+		default:
+			return new picker_fp5_t(	param_picker_filterWindow, param_picker_longTermWindow,
+										param_picker_threshold1, param_picker_threshold2, param_picker_tUpEvent	);
+	}
+}
+
+/*******************************************************************************
+
+	picker_fp5_t
+
+*******************************************************************************/
+
+// Picks in a packet before the pool needs to grow. A new pick can't be declared before tUpEvent has elapsed
+// since the previous one, so packets (<= 1s) hardly ever hold more than a couple of picks
+static const int FP5_PICK_POOL_SIZE = 8;
+
+picker_fp5_t :: picker_fp5_t(double _filterWindow, double _longTermWindow, double _threshold1, double _threshold2, double _tUpEvent)
+:	filterWindow(_filterWindow), longTermWindow(_longTermWindow), threshold1(_threshold1), threshold2(_threshold2), tUpEvent(_tUpEvent),
+	mem(NULL), pick_pool(init_PickPool(FP5_PICK_POOL_SIZE))
+{
+}
+
+picker_fp5_t :: ~picker_fp5_t()
+{
+	free_PickPool((PickPool *)pick_pool);
+	free_FilterPicker5_Memory((FilterPicker5_Memory **)&mem);
+}
+
+long picker_fp5_t :: NumHeapAllocs() const
+{
+	return ((PickPool *)pick_pool)->num_heap_allocs;
+}
+
+void picker_fp5_t :: Process(const float *samples, int num, secs_t start_time, float samples_per_sec, vector<picker_pick_t> & picks)
+{
+	double dt = 1.0 / samples_per_sec;
+
+	PickPool *pool = (PickPool *)pick_pool;
+
+	// The picker memory is allocated on the first packet, the picks come from the pool
+	Pick_FP5(	dt,	samples,	num,
+				filterWindow,		longTermWindow,		threshold1,		threshold2,		tUpEvent,
+				(FilterPicker5_Memory **)&mem,	TRUE_INT,
+				NULL,
+				NULL,
+				pool,
+				""
+	);
+
+	for (int i = 0; i < pool->num_picks; i++)
+	{
+		PickData *pick_fp5 = pool->pick_list[i];
+
+		picker_pick_t p;
+		p.t				=	start_time + ((pick_fp5->indices[0] + pick_fp5->indices[1]) / 2 ) * dt;
+		p.uncertainty	=	float( (pick_fp5->indices[1] - pick_fp5->indices[0]) / 2 * dt );
+		p.polarity		=	pick_fp5->polarity;
+
+		picks.push_back(p);
+	}
+}
+
+/*******************************************************************************
+
+	picker_stalta_t
+
+*******************************************************************************/
+
+// Corner frequency of the high-pass filter that removes the offset before squaring
+static const double STALTA_HIGHPASS_HZ = 0.1;
+
+picker_stalta_t :: picker_stalta_t(double _sta_secs, double _lta_secs, double _ratio_on, double _ratio_off, double _aic_secs)
+:	sta_secs(_sta_secs), lta_secs(_lta_secs), ratio_on(_ratio_on), ratio_off(_ratio_off), aic_secs(_aic_secs),
+	dt(0)
+{
+}
+
+void picker_stalta_t :: Init(float samples_per_sec, float first_sample)
+{
+	dt			=	1.0 / samples_per_sec;
+
+	sta_const	=	min(1.0, dt / sta_secs);
+	lta_const	=	min(1.0, dt / lta_secs);
+	hp_const	=	1.0 / (1.0 + 2 * FLOAT_PI * STALTA_HIGHPASS_HZ * dt);
+	num_lta		=	int(lta_secs / dt + 0.5);
+
+	sta = lta	=	0;
+	x_1			=	first_sample;	// avoid a step on the first sample
+	y_1			=	0;
+	num_total	=	0;
+	triggered	=	false;
+
+	aic_buf.assign(max(0, int(aic_secs / dt + 0.5)), 0.0f);
+	aic_sum.resize(aic_buf.size() + 1);
+	aic_sum2.resize(aic_buf.size() + 1);
+	aic_pos		=	0;
+	aic_num		=	0;
+}
+
+/*
+	Return the onset, in samples before the last one, as the minimum of
+	AIC(k) = k * log(var(w[0..k])) + (n-k-1) * log(var(w[k+1..n-1]))
+	over the last n high-passed samples w
+*/
+int picker_stalta_t :: AICOnset(int n)
+{
+	const int size = int(aic_buf.size());
+
+	aic_sum[0] = aic_sum2[0] = 0;
+	for (int j = 0; j < n; j++)
+	{
+		double w = aic_buf[(aic_pos - n + j + size) % size];
+		aic_sum[j+1]	=	aic_sum[j]  + w;
+		aic_sum2[j+1]	=	aic_sum2[j] + w * w;
+	}
+
+	int best_k = n - 1;
+	double best_aic = 0;
+	bool found = false;
+
+	for (int k = 1; k < n - 1; k++)
+	{
+		double num_l = k + 1, num_r = n - k - 1;
+
+		double mean_l	=	aic_sum[k+1] / num_l;
+		double var_l	=	aic_sum2[k+1] / num_l - mean_l * mean_l;
+
+		double mean_r	=	(aic_sum[n] - aic_sum[k+1]) / num_r;
+		double var_r	=	(aic_sum2[n] - aic_sum2[k+1]) / num_r - mean_r * mean_r;
+
+		if (var_l <= 0 || var_r <= 0)
+			continue;
+
+		double aic = k * log(var_l) + (n - k - 1) * log(var_r);
+		if (!found || aic < best_aic)
+		{
+			best_aic	=	aic;
+			best_k		=	k;
+			found		=	true;
+		}
+	}
+
+	return n - 1 - best_k;
+}
+
+void picker_stalta_t :: Process(const float *samples, int num, secs_t start_time, float samples_per_sec, vector<picker_pick_t> & picks)
+{
+	if (num <= 0)
+		return;
+
+	if (dt == 0)
+		Init(samples_per_sec, samples[0]);
+
+	const int aic_size = int(aic_buf.size());
+
+	for (int i = 0; i < num; i++)
+	{
+		// Characteristic function: squared high-passed signal
+		double x = samples[i];
+		double y = hp_const * (y_1 + x - x_1);
+		x_1 = x;
+		y_1 = y;
+
+		double cf = y * y;
+		sta += (cf - sta) * sta_const;
+		lta += (cf - lta) * lta_const;
+
+		if (aic_size)
+		{
+			aic_buf[aic_pos] = float(y);
+			aic_pos = (aic_pos + 1) % aic_size;
+			if (aic_num < aic_size)
+				aic_num++;
+		}
+
+		// Wait for the LTA to stabilize
+		if (num_total < num_lta)
+		{
+			num_total++;
+			continue;
+		}
+
+		double ratio = (lta > 0) ? sta / lta : 0;
+
+		if (!triggered)
+		{
+			if (ratio >= ratio_on)
+			{
+				triggered = true;
+
+				int onset = i;
+				if (aic_size)
+					onset = i - AICOnset(aic_num);
+
+				picker_pick_t p;
+				p.t				=	start_time + onset * dt;
+				p.uncertainty	=	aic_size ? float(max(1, i - onset) * dt) : float(sta_secs);
+				p.polarity		=	POLARITY_UNKNOWN;
+
+				picks.push_back(p);
+			}
+		}
+		else if (ratio <= ratio_off)
+		{
+			triggered = false;
+		}
+	}
+}
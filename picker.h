@@ -0,0 +1,179 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	Pickers
+
+	picker_t is the interface of a picker running on the packets of one channel.
+	The picker to use is selected per station in stations.txt:
+
+	picker_fp5_t	-	FilterPicker5 (default)
+	picker_stalta_t	-	Recursive STA/LTA trigger with optional AIC onset refinement.
+						Much cheaper, meant for dense strong-motion networks.
+
+*******************************************************************************/
+
+#ifndef PICKER_H_DEF
+#define PICKER_H_DEF
+
+#include <vector>
+#include <string>
+
+#include "global.h"
+
+enum pickertype_t { PICKER_FP5, PICKER_STALTA };
+
+// Name used in stations.txt and in the logs. StringToPickerType returns false on unknown names
+const char *PickerTypeName(pickertype_t type);
+bool StringToPickerType(const std::string & s, pickertype_t *type);
+
+// A pick, as the arguments of the pick_t constructor
+struct picker_pick_t
+{
+	secs_t t;
+	float uncertainty;
+	int polarity;
+};
+
+/*******************************************************************************
+
+	picker_t - Abstract picker
+
+*******************************************************************************/
+
+class picker_t
+{
+public:
+
+	virtual ~picker_t()	{ }
+
+	virtual pickertype_t Type() const = 0;
+
+	// Process the next packet (contiguous with the previous one) and append the picks found to picks
+	virtual void Process(const float *samples, int num, secs_t start_time, float samples_per_sec, std::vector<picker_pick_t> & picks) = 0;
+
+	// Heap allocations made by Process after the first packet. Should stay 0 (see param_debug_picker_allocs)
+	virtual long NumHeapAllocs() const = 0;
+};
+
+// Create a picker of the given type, with the parameters from the config file
+picker_t *NewPicker(pickertype_t type);
+
+/*******************************************************************************
+
+	picker_fp5_t - FilterPicker5
+
+*******************************************************************************/
+
+class picker_fp5_t : public picker_t
+{
+private:
+
+	double filterWindow, longTermWindow, threshold1, threshold2, tUpEvent;
+
+	void *mem;			// FilterPicker5_Memory *
+	void *pick_pool;	// PickPool *, holding the picks of the last packet
+
+	// non copyable
+	picker_fp5_t(const picker_fp5_t &);
+	picker_fp5_t & operator=(const picker_fp5_t &);
+
+public:
+
+	/*
+	@param filterWindow		in seconds, determines how far back in time the previous samples are examined.
+							The filter window will be adjusted upwards to be an integer N power of 2 times the sample interval (deltaTime).
+							Then numRecursive = N + 1 "filter bands" are created.
+							For each filter band n = 0,N  the data samples are processed through a simple recursive filter backwards from the current sample,
+							and picking statistics and characteristic function are generated.
+							Picks are generated based on the maximum of the characteristic function values over all filter bands relative to the threshold values threshold1 and threshold2.
+
+	@param longTermWindow	determines:
+							a) a stabilisation delay time after the beginning of data; before this delay time picks will not be generated.
+							b) the decay constant of a simple recursive filter to accumulate/smooth all picking statistics and characteristic functions for all filter bands.
+
+	@param threshold1		sets the threshold to trigger a pick event (potential pick).
+							This threshold is reached when the (clipped) characteristic function for any filter band exceeds threshold1.
+
+	@param threshold2		sets the threshold to declare a pick (pick will be accepted when tUpEvent reached).
+							This threshold is reached when the integral of the (clipped) characteristic function for any filter band over the window tUpEvent exceeds threshold2 * tUpEvent
+							(i.e. the average (clipped) characteristic function over tUpEvent is greater than threshold2)..
+
+	@param tUpEvent			determines the maximum time the integral of the (clipped) characteristic function is accumulated
+							after threshold1 is reached (pick event triggered) to check for this integral exceeding threshold2 * tUpEvent (pick declared).
+	*/
+	picker_fp5_t(double _filterWindow, double _longTermWindow, double _threshold1, double _threshold2, double _tUpEvent);
+	~picker_fp5_t();
+
+	pickertype_t Type() const	{ return PICKER_FP5; }
+
+	void Process(const float *samples, int num, secs_t start_time, float samples_per_sec, std::vector<picker_pick_t> & picks);
+
+	long NumHeapAllocs() const;
+};
+
+/*******************************************************************************
+
+	picker_stalta_t - Recursive STA/LTA trigger on the squared, high-passed signal.
+
+	A pick is declared when STA/LTA rises past the "on" threshold (after the
+	LTA window has elapsed), and the trigger is re-armed when it drops below
+	the "off" threshold. With AIC refinement, the onset is moved to the minimum
+	of the Akaike Information Criterion over the window preceding the trigger,
+	and the pick uncertainty is the time from onset to trigger.
+
+*******************************************************************************/
+
+class picker_stalta_t : public picker_t
+{
+private:
+
+	double sta_secs, lta_secs, ratio_on, ratio_off, aic_secs;
+
+	double dt;
+	double sta_const, lta_const, hp_const;
+	int num_lta;
+
+	double sta, lta;
+	double x_1, y_1;	// previous input and high-passed sample
+	int num_total;		// samples since start (up to num_lta)
+	bool triggered;
+
+	// Last high-passed samples for AIC
+	std::vector<float> aic_buf;
+	int aic_pos, aic_num;
+	std::vector<double> aic_sum, aic_sum2;
+
+	void Init(float samples_per_sec, float first_sample);
+	int AICOnset(int num);
+
+public:
+
+	picker_stalta_t(double _sta_secs, double _lta_secs, double _ratio_on, double _ratio_off, double _aic_secs);
+
+	pickertype_t Type() const	{ return PICKER_STALTA; }
+
+	void Process(const float *samples, int num, secs_t start_time, float samples_per_sec, std::vector<picker_pick_t> & picks);
+
+	// All the buffers are allocated on the first packet (Init)
+	long NumHeapAllocs() const	{ return 0; }
+};
+
+#endif
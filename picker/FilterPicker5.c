@@ -86,6 +86,7 @@ const float* sample, // array of num_samples data samples
 
         PickData*** ppick_list, // returned pointer to array of num_picks PickData structures/objects containing picks
         int* pnum_picks, // the number of picks in array *ppick_list
+        PickPool* pick_pool, // if not NULL, the picks of this packet are stored in pick_pool (no heap allocations) and ppick_list, pnum_picks are not used
 //luca
 //        char* channel_id // a string identifier for the data channel
 const char* channel_id // a string identifier for the data channel
@@ -97,12 +98,12 @@ const char* channel_id // a string identifier for the data channel
     int indexUpEventTrigger = -1;
     int indexUncertaintyPick = -1;
     int i, k, l, m, n;
+    int numRecursive;
     float* sampleNew = NULL;
     double integralCharFunctClippedWindow;
     double maxCharFunctValue;
     double charFunct = 0.0;
     double charFunctClipped = 0.0;
-    double charFunctClippedTest = 0.0;
     double charFunctTest;
     double currentSample;
     double currentDiffSample;
@@ -144,6 +145,11 @@ const char* channel_id // a string identifier for the data channel
     // _DOC_ set clipped limit of maximum char funct value to 5 * threshold1 to avoid long recovery time after strong events
     maxCharFunctValue = 5.0 * threshold1;
 
+    numRecursive = mem->numRecursive;
+
+    if (pick_pool != NULL)
+        reset_PickPool(pick_pool);
+
 
     // _DOC_ =============================
     // _DOC_ loop over all samples
@@ -166,45 +172,74 @@ const char* channel_id // a string identifier for the data channel
         // _DOC_ filters are applied to first difference of signal values
         currentDiffSample = currentSample - mem->lastSample;
         // _DOC_ loop over numRecursive filter bands
-        for (k = mem->numRecursive - 1; k >= 0; k--) {
-            // _DOC_  apply two single-pole HP filters
-            // _DOC_  http://en.wikipedia.org/wiki/High-pass_filter    y[i] := α * (y[i-1] + x[i] - x[i-1])
-            currentFilteredSample = mem->highPassConst[k] * (mem->filteredSample[k][0] + currentDiffSample);
-            currentDiffSample2 = currentFilteredSample - mem->filteredSample[k][0];
-            mem->filteredSample[k][0] = currentFilteredSample;
-            currentFilteredSample = mem->highPassConst[k] * (mem->filteredSample[k][1] + currentDiffSample2);
-            mem->filteredSample[k][1] = currentFilteredSample;
-            // _DOC_  apply one single-pole LP filter
-            // _DOC_  http://en.wikipedia.org/wiki/Low-pass_filter    y[i] := y[i-1] + α * (x[i] - y[i-1])
-            currentFilteredSample = mem->filteredSample[k][2] + mem->lowPassConst[k] * (currentFilteredSample - mem->filteredSample[k][2]);
-            mem->lastFilteredSample[k] = mem->filteredSample[k][2];
-            mem->filteredSample[k][2] = currentFilteredSample;
-            dy = currentFilteredSample;
-            /* TEST */ //
-            mem->test[k] = dy;
-            //
-            mem->xRec[k] = dy * dy;
-            charFunctClippedTest = 0.0; // AJL 20091214
-            if (mem->mean_stdDev_xRec[k] <= DOUBLE_MIN_VALUE) {
-                if (mem->enableTriggering && error1_not_printed) {
+        // The band state is stored as structure of arrays: the filtering and the per band
+        // characteristic function (A) and the uncertainty / polarity update (C) have no
+        // dependencies between bands, so they run as separate loops the compiler can vectorize.
+        // Only the maximum over bands (B) is done serially, in the original band order.
+        {
+            double* hp0 = mem->filteredSample[0];
+            double* hp1 = mem->filteredSample[1];
+            double* lp = mem->filteredSample[2];
+            double* cfTest = mem->charFunctTest;
+            double* cfClippedTest = mem->charFunctClippedTest;
+            int* iuCurr = mem->indexUncertainty + mem->upEventBufPtr * numRecursive;
+            const int* iuLast = mem->indexUncertainty + upEventBufPtrLast * numRecursive;
+            double* pdsCurr = mem->polarityDerivativeSum + mem->upEventBufPtr * numRecursive;
+            const double* pdsLast = mem->polarityDerivativeSum + upEventBufPtrLast * numRecursive;
+            double* psadCurr = mem->polaritySumAbsDerivative + mem->upEventBufPtr * numRecursive;
+            const double* psadLast = mem->polaritySumAbsDerivative + upEventBufPtrLast * numRecursive;
+
+            // (A) filter bands and characteristic function
+            for (k = 0; k < numRecursive; k++) {
+                double mean = mem->mean_xRec[k];
+                double stdDev = mem->mean_stdDev_xRec[k];
+                double xRec, cf, cfClipped;
+                // _DOC_  apply two single-pole HP filters
+                // _DOC_  http://en.wikipedia.org/wiki/High-pass_filter    y[i] := α * (y[i-1] + x[i] - x[i-1])
+                currentFilteredSample = mem->highPassConst[k] * (hp0[k] + currentDiffSample);
+                currentDiffSample2 = currentFilteredSample - hp0[k];
+                hp0[k] = currentFilteredSample;
+                currentFilteredSample = mem->highPassConst[k] * (hp1[k] + currentDiffSample2);
+                hp1[k] = currentFilteredSample;
+                // _DOC_  apply one single-pole LP filter
+                // _DOC_  http://en.wikipedia.org/wiki/Low-pass_filter    y[i] := y[i-1] + α * (x[i] - y[i-1])
+                currentFilteredSample = lp[k] + mem->lowPassConst[k] * (currentFilteredSample - lp[k]);
+                mem->lastFilteredSample[k] = lp[k];
+                lp[k] = currentFilteredSample;
+                dy = currentFilteredSample;
+                /* TEST */ //
+                mem->test[k] = dy;
+                //
+                xRec = dy * dy;
+                cf = (xRec - mean) / stdDev;
+                // _DOC_ limit maximum char funct value to avoid long recovery time after strong events
+                cfClipped = cf > maxCharFunctValue ? maxCharFunctValue : cf;
+                // save corrected mem->xRec[k]
+                xRec = cf > maxCharFunctValue ? maxCharFunctValue * stdDev + mean : xRec;
+                if (stdDev <= DOUBLE_MIN_VALUE) { // dead trace: no characteristic function for this band
+                    cfClipped = 0.0;
+                    xRec = dy * dy;
+                }
+                mem->xRec[k] = xRec;
+                cfTest[k] = cf;
+                cfClippedTest[k] = cfClipped; // AJL 20091214
+            }
+
+            // (B) characteristic function is maximum over numRecursive filter bands
+            for (k = numRecursive - 1; k >= 0; k--) {
+                if (mem->mean_stdDev_xRec[k] <= DOUBLE_MIN_VALUE) {
+                    if (mem->enableTriggering && error1_not_printed) {
 //luca
 //                    sprintf(message_str, "WARNING: %s: mem->mean_stdDev_xRec[k] <= Float.MIN_VALUE (this should not happen! - dead trace?)\n", channel_id);
 //                    info(message_str);
-                    error1_not_printed = FALSE_INT;
-                }
-            } else {
-                charFunctTest = (mem->xRec[k] - mem->mean_xRec[k]) / mem->mean_stdDev_xRec[k];
-                charFunctClippedTest = charFunctTest; // AJL 20091214
-                // _DOC_ limit maximum char funct value to avoid long recovery time after strong events
-                if (charFunctClippedTest > maxCharFunctValue) {
-                    charFunctClippedTest = maxCharFunctValue;
-                    // save corrected mem->xRec[k]
-                    mem->xRec[k] = maxCharFunctValue * mem->mean_stdDev_xRec[k] + mem->mean_xRec[k];
+                        error1_not_printed = FALSE_INT;
+                    }
+                    continue;
                 }
-                // _DOC_ characteristic function is maximum over numRecursive filter bands
+                charFunctTest = cfTest[k];
                 if (charFunctTest >= charFunct) {
                     charFunct = charFunctTest;
-                    charFunctClipped = charFunctClippedTest;
+                    charFunctClipped = cfClippedTest[k];
                     mem->charFunctNumRecursiveIndex[mem->upEventBufPtr] = k;
                 }
                 // _DOC_ trigger index is highest frequency with CF >= threshold1 over numRecursive filter bands
@@ -212,35 +247,27 @@ const char* channel_id // a string identifier for the data channel
                     mem->charFunctNumRecursiveIndex[mem->upEventBufPtr] = k;
                 }
             }
-            // AJL 20091214
+
+            // (C) AJL 20091214
             // _DOC_ =============================
             // _DOC_ update uncertainty and polarity fields
             // _DOC_ uncertaintyThreshold is at minimum char function or char funct increases past uncertaintyThreshold
-            mem->charFunctUncertainty[k] = charFunctClippedTest; // no smoothing
-            // AJL 20091214 mem->charFunctLast = charFunctClipped;
-            upCharFunctUncertainty =
-                    ((mem->charFunctUncertaintyLast[k] < mem->uncertaintyThreshold[k]) && (mem->charFunctUncertainty[k] >= mem->uncertaintyThreshold[k]));
-            mem->charFunctUncertaintyLast[k] = mem->charFunctUncertainty[k];
-            // _DOC_ each time characteristic function rises past uncertaintyThreshold store sample index and initiate polarity algoirithm
-            if (upCharFunctUncertainty) {
-                mem->indexUncertainty[k][mem->upEventBufPtr] = n - 1;
-            } else {
-                mem->indexUncertainty[k][mem->upEventBufPtr] = mem->indexUncertainty[k][upEventBufPtrLast];
-            }
-            // END - AJL 20091214
-            if (upCharFunctUncertainty) {
+            for (k = 0; k < numRecursive; k++) {
+                mem->charFunctUncertainty[k] = cfClippedTest[k]; // no smoothing
+                // AJL 20091214 mem->charFunctLast = charFunctClipped;
+                upCharFunctUncertainty =
+                        ((mem->charFunctUncertaintyLast[k] < mem->uncertaintyThreshold[k]) && (mem->charFunctUncertainty[k] >= mem->uncertaintyThreshold[k]));
+                mem->charFunctUncertaintyLast[k] = mem->charFunctUncertainty[k];
+                // _DOC_ each time characteristic function rises past uncertaintyThreshold store sample index and initiate polarity algoirithm
                 // _DOC_ initialize polarity algorithm, uses derivative of signal
-                mem->polarityDerivativeSum[k][mem->upEventBufPtr] = 0.0;
-                mem->polaritySumAbsDerivative[k][mem->upEventBufPtr] = 0.0;
-            } else {
-                mem->polarityDerivativeSum[k][mem->upEventBufPtr] = mem->polarityDerivativeSum[k][upEventBufPtrLast];
-                mem->polaritySumAbsDerivative[k][mem->upEventBufPtr] = mem->polaritySumAbsDerivative[k][upEventBufPtrLast];
+                iuCurr[k] = upCharFunctUncertainty ? n - 1 : iuLast[k];
+                // END - AJL 20091214
+                // _DOC_   accumulate derivative and sum of abs of derivative for polarity estimate
+                // _DOC_   accumulate since last indexUncertainty
+                polarityderivativeIncrement = lp[k] - mem->lastFilteredSample[k];
+                pdsCurr[k] = (upCharFunctUncertainty ? 0.0 : pdsLast[k]) + polarityderivativeIncrement;
+                psadCurr[k] = (upCharFunctUncertainty ? 0.0 : psadLast[k]) + fabs(polarityderivativeIncrement);
             }
-            // _DOC_   accumulate derivative and sum of abs of derivative for polarity estimate
-            // _DOC_   accumulate since last indexUncertainty
-            polarityderivativeIncrement = mem->filteredSample[k][2] - mem->lastFilteredSample[k];
-            mem->polarityDerivativeSum[k][mem->upEventBufPtr] += polarityderivativeIncrement;
-            mem->polaritySumAbsDerivative[k][mem->upEventBufPtr] += fabs(polarityderivativeIncrement);
         }
 
 
@@ -285,7 +312,7 @@ const char* channel_id // a string identifier for the data channel
                                 mem->triggerNumRecursiveIndex = mem->charFunctNumRecursiveIndex[m];
                                 // _DOC_ set index for pick uncertainty begin and end
                                 indexUpEventTrigger = n - k;
-                                indexUncertaintyPick = mem->indexUncertainty[mem->triggerNumRecursiveIndex][m]; // AJL 20091214
+                                indexUncertaintyPick = mem->indexUncertainty[m * numRecursive + mem->triggerNumRecursiveIndex]; // AJL 20091214
                                 // _DOC_ evaluate polarity based on accumulated derivative
                                 // _DOC_    (=POS if derivative_sum > 0, = NEG if derivative_sum < 0,
                                 // _DOC_     and if ratio larger abs derivative_sum / abs_derivative_sum > 0.667,
@@ -297,8 +324,8 @@ const char* channel_id // a string identifier for the data channel
                                 // 20121019 AJL - following modified to add pickPolarityWeight
                                 mem->pickPolarity = POLARITY_UNKNOWN;
                                 mem->pickPolarityWeight = 0.0;
-                                polDerivSum = mem->polarityDerivativeSum[mem->triggerNumRecursiveIndex][iPolarity];
-                                polSumAbsDeriv = mem->polaritySumAbsDerivative[mem->triggerNumRecursiveIndex][iPolarity];
+                                polDerivSum = mem->polarityDerivativeSum[iPolarity * numRecursive + mem->triggerNumRecursiveIndex];
+                                polSumAbsDeriv = mem->polaritySumAbsDerivative[iPolarity * numRecursive + mem->triggerNumRecursiveIndex];
                                 polDerivRatio = polDerivSum / polSumAbsDeriv;
                                 if (polDerivSum > 0.0 && polDerivRatio > CRITICAL_POLARITY_RATIO) {
                                     mem->pickPolarity = POLARITY_POS;
@@ -392,11 +419,15 @@ const char* channel_id // a string identifier for the data channel
                     // delay trigger index
                     indexEndPick += ishift;
                 }
-                pickData = init_PickData();
+                if (pick_pool != NULL)
+                    pickData = addPickToPickPool(pick_pool);
+                else
+                    pickData = init_PickData();
                 set_PickData(pickData, (double) indexBeginPick, (double) indexEndPick,
                         mem->pickPolarity, mem->pickPolarityWeight, charFunctValueTrigger, // AJL 20091216
                         CHAR_FUNCT_AMP_UNITS, triggerPeriod);
-                addPickToPickList(pickData, ppick_list, pnum_picks);
+                if (pick_pool == NULL)
+                    addPickToPickList(pickData, ppick_list, pnum_picks);
 
             }
         }
@@ -410,13 +441,11 @@ const char* channel_id // a string identifier for the data channel
 
     if (useMemory) {
         // corect memory index values for sample length
-        for (i = 0; i < mem->nTUpEvent; i++) {
-            // AJL 20091214
-            for (k = 0; k < mem->numRecursive; k++) {
-                mem->indexUncertainty[k][i] -= num_samples;
-            }
-            // END - AJL 20091214
+        // AJL 20091214
+        for (i = 0; i < mem->nTUpEvent * numRecursive; i++) {
+            mem->indexUncertainty[i] -= num_samples;
         }
+        // END - AJL 20091214
         if (mem->allowNewPickIndex != INT_UNSET) {
             mem->allowNewPickIndex -= num_samples;
         }
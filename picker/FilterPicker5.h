@@ -27,6 +27,7 @@ const float* sample, 			// array of num_samples data samples
 
 	PickData*** ppick_list,		// returned pointer to array of num_picks PickData structures/objects containing picks
 	int* pnum_picks,			// the number of picks in array *ppick_list
+	PickPool* pick_pool,		// if not NULL, the picks of this packet are stored in pick_pool (no heap allocations) and ppick_list, pnum_picks are not used
 // luca
 // 	char* channel_id		// a string identifier for the data channel
 const char* channel_id		// a string identifier for the data channel
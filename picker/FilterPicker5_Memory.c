@@ -30,6 +30,9 @@
 #include "PickData.h"
 #include "FilterPicker5_Memory.h"
 
+// number of per band arrays in FilterPicker5_Memory->bandBlock
+#define NUM_BAND_ARRAYS 18
+
 
 /** picker memory class ***/
 // _DOC_ =============================
@@ -79,22 +82,29 @@ const float* sample, int length,
         numPrevious = nTemp; // numPrevious is now a power of 2
         //System.out.println("TP DEBUG numPrevious, numRecursive " + numPrevious + ", " + numRecursive);
     }
-    filterPicker5_Memory->xRec = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->test = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->filteredSample = calloc(filterPicker5_Memory->numRecursive, sizeof (double*));
-    for (k = 0; k < filterPicker5_Memory->numRecursive; k++) {
-        filterPicker5_Memory->filteredSample[k] = calloc(3, sizeof (double));
+    // per band arrays, all in one contiguous block
+    filterPicker5_Memory->bandBlock = calloc(NUM_BAND_ARRAYS * filterPicker5_Memory->numRecursive, sizeof (double));
+    {
+        double* band = filterPicker5_Memory->bandBlock;
+        int nR = filterPicker5_Memory->numRecursive;
+        filterPicker5_Memory->xRec = band; band += nR;
+        filterPicker5_Memory->test = band; band += nR;
         for (j = 0; j < 3; j++) {
-            filterPicker5_Memory->filteredSample[k][j] = 0.0;
+            filterPicker5_Memory->filteredSample[j] = band; band += nR;
         }
+        filterPicker5_Memory->lastFilteredSample = band; band += nR;
+        filterPicker5_Memory->mean_xRec = band; band += nR;
+        filterPicker5_Memory->mean_stdDev_xRec = band; band += nR;
+        filterPicker5_Memory->mean_var_xRec = band; band += nR;
+        filterPicker5_Memory->period = band; band += nR;
+        filterPicker5_Memory->lowPassConst = band; band += nR;
+        filterPicker5_Memory->highPassConst = band; band += nR;
+        filterPicker5_Memory->charFunctTest = band; band += nR;
+        filterPicker5_Memory->charFunctClippedTest = band; band += nR;
+        filterPicker5_Memory->charFunctUncertainty = band; band += nR;
+        filterPicker5_Memory->charFunctUncertaintyLast = band; band += nR;
+        filterPicker5_Memory->uncertaintyThreshold = band; band += nR;
     }
-    filterPicker5_Memory->lastFilteredSample = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->mean_xRec = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->mean_stdDev_xRec = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->mean_var_xRec = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->period = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->lowPassConst = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->highPassConst = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
     window = deltaTime / (2.0 * PI);
     for (k = 0; k < filterPicker5_Memory->numRecursive; k++) {
         filterPicker5_Memory->mean_xRec[k] = 0.0;
@@ -108,9 +118,6 @@ const float* sample, int length,
     filterPicker5_Memory->lastSample = DOUBLE_MAX_VALUE;
     filterPicker5_Memory->lastDiffSample = 0.0;
     // AJL 20091214
-    filterPicker5_Memory->charFunctUncertainty = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->charFunctUncertaintyLast = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
-    filterPicker5_Memory->uncertaintyThreshold = calloc(filterPicker5_Memory->numRecursive, sizeof (double));
     for (k = 0; k < filterPicker5_Memory->numRecursive; k++) {
         filterPicker5_Memory->uncertaintyThreshold[k] = threshold1 / 2.0;
     }
@@ -122,19 +129,10 @@ const float* sample, int length,
     if (filterPicker5_Memory->nTUpEvent < 1) {
         filterPicker5_Memory->nTUpEvent = 1;
     }
-    filterPicker5_Memory->indexUncertainty = calloc(filterPicker5_Memory->numRecursive, sizeof (int*)); // AJL 20091214
-    filterPicker5_Memory->polarityDerivativeSum = calloc(filterPicker5_Memory->numRecursive, sizeof (double*));
-    filterPicker5_Memory->polaritySumAbsDerivative = calloc(filterPicker5_Memory->numRecursive, sizeof (double*));
-    for (k = 0; k < filterPicker5_Memory->numRecursive; k++) {
-        filterPicker5_Memory->indexUncertainty[k] = calloc(filterPicker5_Memory->nTUpEvent, sizeof (int)); // AJL 20091214
-        filterPicker5_Memory->polarityDerivativeSum[k] = calloc(filterPicker5_Memory->nTUpEvent, sizeof (double));
-        filterPicker5_Memory->polaritySumAbsDerivative[k] = calloc(filterPicker5_Memory->nTUpEvent, sizeof (double));
-        for (j = 0; j < filterPicker5_Memory->nTUpEvent; j++) {
-            filterPicker5_Memory->indexUncertainty[k][j] = 0; // END - AJL 20091214
-            filterPicker5_Memory->polarityDerivativeSum[k][j] = 0.0;
-            filterPicker5_Memory->polaritySumAbsDerivative[k][j] = 0.0;
-        }
-    }
+    // slot major: [j * numRecursive + k] is up event buffer slot j of band k (zeroed by calloc)
+    filterPicker5_Memory->indexUncertainty = calloc(filterPicker5_Memory->nTUpEvent * filterPicker5_Memory->numRecursive, sizeof (int)); // AJL 20091214
+    filterPicker5_Memory->polarityDerivativeSum = calloc(filterPicker5_Memory->nTUpEvent * filterPicker5_Memory->numRecursive, sizeof (double));
+    filterPicker5_Memory->polaritySumAbsDerivative = calloc(filterPicker5_Memory->nTUpEvent * filterPicker5_Memory->numRecursive, sizeof (double));
 
     // _DOC_ criticalIntegralCharFunct is tUpEvent * threshold2
     filterPicker5_Memory->criticalIntegralCharFunct = (double) (filterPicker5_Memory->nTUpEvent) * threshold2; // one less than number of samples examined
@@ -162,9 +160,9 @@ const float* sample, int length,
         sample_mean += sample[i];
     }
     sample_mean /= (double) nmean;
-    for (k = 0; k < filterPicker5_Memory->numRecursive; k++) {
-        for (j = 0; j < 3; j++) {
-            filterPicker5_Memory->filteredSample[k][j] = 0.0;
+    for (j = 0; j < 3; j++) {
+        for (k = 0; k < filterPicker5_Memory->numRecursive; k++) {
+            filterPicker5_Memory->filteredSample[j][k] = 0.0;
         }
     }
     filterPicker5_Memory->lastSample = sample_mean;
@@ -178,27 +176,11 @@ const float* sample, int length,
 
 void free_FilterPicker5_Memory(FilterPicker5_Memory** pfilterPicker5_Memory) {
     
-    int k;
     if (*pfilterPicker5_Memory == NULL)
         return;
 
-    free((*pfilterPicker5_Memory)->xRec);
-    free((*pfilterPicker5_Memory)->test);
-    for (k = 0; k < (*pfilterPicker5_Memory)->numRecursive; k++)
-        free((*pfilterPicker5_Memory)->filteredSample[k]);
-    free((*pfilterPicker5_Memory)->filteredSample);
-    free((*pfilterPicker5_Memory)->lastFilteredSample);
-    free((*pfilterPicker5_Memory)->mean_xRec);
-    free((*pfilterPicker5_Memory)->mean_stdDev_xRec);
-    free((*pfilterPicker5_Memory)->mean_var_xRec);
-    free((*pfilterPicker5_Memory)->period);
-    free((*pfilterPicker5_Memory)->lowPassConst);
-    free((*pfilterPicker5_Memory)->highPassConst);
-
-    for (k = 0; k < (*pfilterPicker5_Memory)->numRecursive; k++) {
-        free((*pfilterPicker5_Memory)->polarityDerivativeSum[k]);
-        free((*pfilterPicker5_Memory)->polaritySumAbsDerivative[k]);
-    }
+    free((*pfilterPicker5_Memory)->bandBlock);
+
     free((*pfilterPicker5_Memory)->polarityDerivativeSum);
     free((*pfilterPicker5_Memory)->polaritySumAbsDerivative);
     free((*pfilterPicker5_Memory)->integralCharFunctClipped);
@@ -206,13 +188,7 @@ void free_FilterPicker5_Memory(FilterPicker5_Memory** pfilterPicker5_Memory) {
     free((*pfilterPicker5_Memory)->charFunctValue);
     free((*pfilterPicker5_Memory)->charFunctNumRecursiveIndex);
 
-    for (k = 0; k < (*pfilterPicker5_Memory)->numRecursive; k++) {
-        free((*pfilterPicker5_Memory)->indexUncertainty[k]);
-    }
     free((*pfilterPicker5_Memory)->indexUncertainty);
-    free((*pfilterPicker5_Memory)->charFunctUncertainty);
-    free((*pfilterPicker5_Memory)->charFunctUncertaintyLast);
-    free((*pfilterPicker5_Memory)->uncertaintyThreshold);
 
 
     free(*pfilterPicker5_Memory);
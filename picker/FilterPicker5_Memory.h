@@ -22,9 +22,14 @@ typedef struct
 
 	int numRecursive ;   // number of powers of 2 to process
 
+	// Per filter band state, as a structure of arrays: each of the following arrays has numRecursive
+	// elements (one per band) and they all live in the single contiguous block bandBlock,
+	// so that the loops over the bands read consecutive memory and can be vectorized.
+	double* bandBlock;
+
 	double* xRec;
 	double* test;
-	double** filteredSample;
+	double* filteredSample[3];	// filteredSample[j][k] is stage j of band k
 	double* lastFilteredSample;
 	double* mean_xRec;
 	double* mean_stdDev_xRec;
@@ -32,9 +37,8 @@ typedef struct
         double* period;
         double* lowPassConst;
         double* highPassConst;
-	double* decayFactor;
-	double* decayConst;
-	int* indexDelay;
+	double* charFunctTest;			// per-sample scratch
+	double* charFunctClippedTest;	// per-sample scratch
 
 	double window;
 	int nDelay;
@@ -42,23 +46,24 @@ typedef struct
 	double lastSample;
         double lastDiffSample;
 
-	double* charFunctUncertainty;
-        double* charFunctUncertaintyLast;
+	double* charFunctUncertainty;	// in bandBlock
+        double* charFunctUncertaintyLast;	// in bandBlock
 	//double charFunctLast;
 	double charFunctLast1Smooth;
 	double charFunctLast2Smooth;
-	double* uncertaintyThreshold;  // AJL 20091214
+	double* uncertaintyThreshold;  // AJL 20091214, in bandBlock
 	double maxUncertaintyThreshold;
 	double minUncertaintyThreshold;
         double maxAllowNewPickThreshold;
         int allowNewPickIndex;
 	//double maxAllowNewTriggerThreshold;
 
-        double** polarityDerivativeSum;
-        double** polaritySumAbsDerivative;
+	// Per up event buffer slot and per band, slot major: element [j * numRecursive + k] is slot j of band k
+        double* polarityDerivativeSum;
+        double* polaritySumAbsDerivative;
 
         double amplitudeUncertainty;
-        int** indexUncertainty;  // AJL 20091214
+        int* indexUncertainty;  // AJL 20091214
 	int indexUncertaintyTrigger;
 	int countPolarity;
 
@@ -220,3 +220,84 @@ void free_PickList(PickData** pick_list, int num_picks)
 	free(pick_list);
 }
 
+
+
+
+
+/** pick pool */
+
+PickPool* init_PickPool(int capacity) {
+
+	PickPool* pickPool = calloc(1, sizeof(PickPool));
+
+	pickPool->capacity = capacity > 0 ? capacity : 1;
+	pickPool->picks = calloc(pickPool->capacity, sizeof(PickData));
+	pickPool->pick_list = calloc(pickPool->capacity, sizeof(PickData*));
+	pickPool->num_picks = 0;
+	pickPool->num_heap_allocs = 0;
+
+	return(pickPool);
+
+}
+
+
+/** forget the picks of the previous packet */
+
+void reset_PickPool(PickPool* pickPool) {
+
+	pickPool->num_picks = 0;
+
+}
+
+
+/** return a new initialized PickData from the pool, appended to its pick list. The pool grows (on the heap) only if full */
+
+PickData* addPickToPickPool(PickPool* pickPool) {
+
+	PickData* pickData;
+	int n;
+
+	if (pickPool->num_picks == pickPool->capacity) {
+		PickData* newPicks = calloc(pickPool->capacity * 2, sizeof(PickData));
+		PickData** newPickList = calloc(pickPool->capacity * 2, sizeof(PickData*));
+		for (n = 0; n < pickPool->num_picks; n++) {
+			newPicks[n] = pickPool->picks[n];
+			newPickList[n] = newPicks + n;
+		}
+		free(pickPool->picks);
+		free(pickPool->pick_list);
+		pickPool->picks = newPicks;
+		pickPool->pick_list = newPickList;
+		pickPool->capacity *= 2;
+		pickPool->num_heap_allocs += 2;
+	}
+
+	pickData = pickPool->picks + pickPool->num_picks;
+
+	pickData->polarity = POLARITY_UNKNOWN;
+	pickData->polarityWeight = 0.0;
+	pickData->indices[0] = pickData->indices[1] = -1;
+	pickData->amplitude = 0.0;
+	pickData->amplitudeUnits = NO_AMP_UNITS;
+	pickData->period = 0.0;
+
+	pickPool->pick_list[pickPool->num_picks] = pickData;
+	pickPool->num_picks++;
+
+	return(pickData);
+
+}
+
+
+/** clean up pick pool memory */
+
+void free_PickPool(PickPool* pickPool)
+{
+	if (pickPool == NULL)
+		return;
+
+	free(pickPool->picks);
+	free(pickPool->pick_list);
+	free(pickPool);
+}
+
@@ -42,4 +42,25 @@ void addPickToPickList(PickData* pickData, PickData*** ppick_list, int* pnum_pic
 
 void free_PickList(PickData** pick_list, int num_picks);
 
+
+/** pool of PickData reused for every packet, so that picking makes no heap allocations */
+
+typedef struct
+{
+	PickData* picks;		// storage for capacity picks
+	PickData** pick_list;	// pointers to the num_picks picks of the current packet
+	int capacity;
+	int num_picks;
+	long num_heap_allocs;	// heap allocations made after init (growing a full pool)
+}
+PickPool;
+
+PickPool* init_PickPool(int capacity);
+
+void reset_PickPool(PickPool* pickPool);
+
+PickData* addPickToPickPool(PickPool* pickPool);
+
+void free_PickPool(PickPool* pickPool);
+
 #endif
@@ -0,0 +1,915 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	Batched picker engine (see picker_engine.h)
+
+*******************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include "SDL.h"
+
+#include "picker_engine.h"
+
+#include "heli.h"
+
+extern "C" {
+#include "picker/FilterPicker5.h"
+}
+
+#include "config.h"
+
+using namespace std;
+
+picker_engine_t picker_engine;
+
+// Same as in FilterPicker5.c
+#define CRITICAL_POLARITY_RATIO 0.667
+
+/*******************************************************************************
+
+	picker_group_t
+
+*******************************************************************************/
+
+picker_group_t :: picker_group_t(const picker_params_t & _params)
+:	params(_params), capacity(0), up_event_buf_ptr(0)
+{
+	// Same as init_filterPicker5_Memory
+
+	const double deltaTime = params.dt;
+
+	longDecayFactor = deltaTime / params.longTermWindow;
+	longDecayConst = 1.0 - longDecayFactor;
+	indexEnableTriggering = 1 + (int) (params.longTermWindow / deltaTime);	// nLongTermWindow
+
+	numRecursive = 1;
+	int nTemp = 1;
+	int numPrevious = (int) (params.filterWindow / deltaTime);
+	while (nTemp < numPrevious)
+	{
+		numRecursive++;
+		nTemp *= 2;
+	}
+
+	period.resize(numRecursive);
+	lowPassConst.resize(numRecursive);
+	highPassConst.resize(numRecursive);
+	double window = deltaTime / (2.0 * PI);
+	for (int k = 0; k < numRecursive; k++)
+	{
+		period[k] = window * 2.0 * PI;
+		lowPassConst[k] = deltaTime / (window + deltaTime);
+		highPassConst[k] = window / (window + deltaTime);
+		window *= 2.0;
+	}
+
+	maxUncertaintyThreshold = params.threshold1 / 2.0;
+	minUncertaintyThreshold = 0.5;
+	maxAllowNewPickThreshold = 2.0;
+
+	nTUpEvent = (int) (0.5 + params.tUpEvent / deltaTime) + 1;
+	if (nTUpEvent < 1)
+		nTUpEvent = 1;
+
+	criticalIntegralCharFunct = (double) (nTUpEvent) * params.threshold2;
+	maxCharFunctValue = 5.0 * params.threshold1;
+
+	// Arena layout
+
+	d_last_sample		=	NUM_BAND_ROWS * numRecursive;
+	d_plain_rows		=	d_last_sample + 1;
+
+	ds_integral			=	2 * numRecursive;
+	ds_cf_clipped_value	=	ds_integral + 1;
+	ds_cf_value			=	ds_integral + 2;
+	d_slot_rows			=	ds_integral + 3;
+
+	i_slot_rows			=	numRecursive + 1;
+}
+
+// Resize the rows, keeping the lanes
+void picker_group_t :: Grow(int new_capacity)
+{
+	const int d_rows	=	d_plain_rows + nTUpEvent * d_slot_rows;
+	const int i_rows	=	I_PLAIN_ROWS + nTUpEvent * i_slot_rows;
+	const int num		=	NumLanes();
+
+	d_arena_tmp.assign(size_t(d_rows) * new_capacity, 0.0);
+	for (int r = 0; r < d_rows; r++)
+		copy(&d_arena[0] + size_t(r) * capacity, &d_arena[0] + size_t(r) * capacity + num, &d_arena_tmp[size_t(r) * new_capacity]);
+
+	i_arena_tmp.assign(size_t(i_rows) * new_capacity, 0);
+	for (int r = 0; r < i_rows; r++)
+		copy(&i_arena[0] + size_t(r) * capacity, &i_arena[0] + size_t(r) * capacity + num, &i_arena_tmp[size_t(r) * new_capacity]);
+
+	d_arena.swap(d_arena_tmp);
+	i_arena.swap(i_arena_tmp);
+	capacity = new_capacity;
+
+	diff.resize(capacity);
+	charFunct.resize(capacity);
+	charFunctClipped.resize(capacity);
+}
+
+void picker_group_t :: AddLane(picker_channel_t *chan, const float *first_samples, int first_num)
+{
+	int lane = NumLanes();
+	if (lane == capacity)
+		Grow(max(8, capacity * 2));
+
+	lane_chan.push_back(chan);
+	chan->group	=	this;
+	chan->lane	=	lane;
+
+	// Same as init_filterPicker5_Memory
+
+	const int d_rows	=	d_plain_rows + nTUpEvent * d_slot_rows;
+	const int i_rows	=	I_PLAIN_ROWS + nTUpEvent * i_slot_rows;
+
+	for (int r = 0; r < d_rows; r++)
+		DRow(r)[lane] = 0.0;
+	for (int r = 0; r < i_rows; r++)
+		IRow(r)[lane] = 0;
+
+	for (int k = 0; k < numRecursive; k++)
+		DBand(UNCERTAINTY_THRESHOLD, k)[lane] = params.threshold1 / 2.0;
+
+	// initialize previous samples to mean sample value
+	int nmean = indexEnableTriggering < first_num ? indexEnableTriggering : first_num;
+	double sample_mean = 0.0;
+	for (int i = 0; i < nmean; i++)
+		sample_mean += first_samples[i];
+	sample_mean /= (double) nmean;
+	DRow(d_last_sample)[lane] = sample_mean;
+
+	IRow(I_ALLOW_NEW_PICK_INDEX)[lane]	=	INT_UNSET;
+	IRow(I_N_TOTAL)[lane]				=	-1;
+	IRow(I_ENABLE_TRIGGERING)[lane]		=	FALSE_INT;
+	IRow(I_UP_EVENT_BUF_PTR)[lane]		=	up_event_buf_ptr;	// the buffers are all zeros, any index will do
+}
+
+// Move the last lane over the removed one
+void picker_group_t :: RemoveLane(int lane)
+{
+	int last = NumLanes() - 1;
+
+	lane_chan[lane]->group	=	NULL;
+	lane_chan[lane]->lane	=	-1;
+
+	if (lane != last)
+	{
+		const int d_rows	=	d_plain_rows + nTUpEvent * d_slot_rows;
+		const int i_rows	=	I_PLAIN_ROWS + nTUpEvent * i_slot_rows;
+
+		for (int r = 0; r < d_rows; r++)
+			DRow(r)[lane] = DRow(r)[last];
+		for (int r = 0; r < i_rows; r++)
+			IRow(r)[lane] = IRow(r)[last];
+
+		lane_chan[lane] = lane_chan[last];
+		lane_chan[lane]->lane = lane;
+	}
+
+	lane_chan.pop_back();
+}
+
+struct cmp_lanes_by_run_t
+{
+	const vector<picker_channel_t *> & lane_chan;
+	cmp_lanes_by_run_t(const vector<picker_channel_t *> & _lane_chan) : lane_chan(_lane_chan) { }
+	bool operator()(int a, int b) const { return lane_chan[a]->run_num > lane_chan[b]->run_num; }
+};
+
+// Sort the lanes by decreasing run length and rotate their up event buffers to the shared buffer index
+void picker_group_t :: Realign()
+{
+	const int num = NumLanes();
+
+	order.resize(num);
+	for (int i = 0; i < num; i++)
+		order[i] = i;
+	stable_sort(order.begin(), order.end(), cmp_lanes_by_run_t(lane_chan));
+
+	const int *lane_ptr = IRow(I_UP_EVENT_BUF_PTR);
+
+	bool aligned = true;
+	for (int i = 0; i < num; i++)
+		if (order[i] != i || lane_ptr[i] != up_event_buf_ptr)
+			aligned = false;
+	if (aligned)
+		return;
+
+	const size_t cap	=	capacity;
+	d_arena_tmp.resize(d_arena.size());
+	i_arena_tmp.resize(i_arena.size());
+
+	for (int r = 0; r < d_plain_rows; r++)
+		for (int i = 0; i < num; i++)
+			d_arena_tmp[r * cap + i] = d_arena[r * cap + order[i]];
+
+	for (int r = 0; r < I_PLAIN_ROWS; r++)
+		for (int i = 0; i < num; i++)
+			i_arena_tmp[r * cap + i] = i_arena[r * cap + order[i]];
+
+	// Slot j of a lane is slot j + (up_event_buf_ptr - lane_ptr) once aligned
+	for (int i = 0; i < num; i++)
+	{
+		int lane	=	order[i];
+		int shift	=	(up_event_buf_ptr - lane_ptr[lane] + nTUpEvent) % nTUpEvent;
+
+		for (int j = 0; j < nTUpEvent; j++)
+		{
+			int j_src = (j - shift + nTUpEvent) % nTUpEvent;
+
+			for (int q = 0; q < d_slot_rows; q++)
+				d_arena_tmp[(d_plain_rows + j * d_slot_rows + q) * cap + i] = d_arena[(d_plain_rows + j_src * d_slot_rows + q) * cap + lane];
+
+			for (int q = 0; q < i_slot_rows; q++)
+				i_arena_tmp[(I_PLAIN_ROWS + j * i_slot_rows + q) * cap + i] = i_arena[(I_PLAIN_ROWS + j_src * i_slot_rows + q) * cap + lane];
+		}
+	}
+
+	d_arena.swap(d_arena_tmp);
+	i_arena.swap(i_arena_tmp);
+
+	int *ptr = IRow(I_UP_EVENT_BUF_PTR);
+	for (int i = 0; i < num; i++)
+		ptr[i] = up_event_buf_ptr;
+
+	vector<picker_channel_t *> old_lane_chan(lane_chan);
+	for (int i = 0; i < num; i++)
+	{
+		lane_chan[i] = old_lane_chan[order[i]];
+		lane_chan[i]->lane = i;
+	}
+}
+
+void picker_group_t :: Process()
+{
+	const int num = NumLanes();
+	if (num == 0)
+		return;
+
+	Uint64 perf_start = SDL_GetPerformanceCounter();
+
+	Realign();
+
+	const int num_steps = lane_chan[0]->run_num;
+	if (num_steps == 0)
+		return;
+
+	// Interleave the samples of the lanes
+
+	samples.resize(size_t(num_steps) * num);
+	for (int l = 0; l < num; l++)
+	{
+		const vector<picker_run_packet_t> & run = lane_chan[l]->run;
+		for (vector<picker_run_packet_t>::const_iterator p = run.begin(); p != run.end(); p++)
+			for (int i = 0; i < p->num; i++)
+				samples[size_t(p->offset + i) * num + l] = p->samples[i];
+	}
+
+	// Run the picker, on fewer lanes as they run out of samples
+
+	const int up_event_buf_ptr_start = up_event_buf_ptr;
+
+	int num_active = num;
+	for (int n = 0; n < num_steps; n++)
+	{
+		while (lane_chan[num_active - 1]->run_num <= n)
+			num_active--;
+
+		Step(n, num_active);
+	}
+
+	// corect memory index values for run length
+
+	for (int l = 0; l < num; l++)
+	{
+		int run_num = lane_chan[l]->run_num;
+
+		IRow(I_UP_EVENT_BUF_PTR)[l] = (up_event_buf_ptr_start + run_num) % nTUpEvent;
+
+		for (int j = 0; j < nTUpEvent; j++)
+			for (int k = 0; k < numRecursive; k++)
+				ISlot(j, k)[l] -= run_num;
+
+		if (IRow(I_ALLOW_NEW_PICK_INDEX)[l] != INT_UNSET)
+			IRow(I_ALLOW_NEW_PICK_INDEX)[l] -= run_num;
+	}
+
+	up_event_buf_ptr = (up_event_buf_ptr_start + num_steps) % nTUpEvent;
+
+	// Split the processing time (wall-clock, see heli_t::picker_perf_ticks) among the lanes
+
+	Uint64 perf_ticks = SDL_GetPerformanceCounter() - perf_start;
+
+	unsigned long num_samples = 0;
+	for (int l = 0; l < num; l++)
+		num_samples += lane_chan[l]->run_num;
+
+	for (int l = 0; l < num; l++)
+	{
+		lane_chan[l]->perf_ticks	+=	Uint64(double(perf_ticks) * lane_chan[l]->run_num / num_samples);
+		lane_chan[l]->perf_samples	+=	lane_chan[l]->run_num;
+	}
+}
+
+// One sample for the first num_active lanes. This mirrors the sample loop of Pick_FP5
+void picker_group_t :: Step(int n, int num_active)
+{
+	const float *x	=	&samples[size_t(n) * NumLanes()];
+	const int cap	=	capacity;
+
+	int last = up_event_buf_ptr;
+	up_event_buf_ptr = (up_event_buf_ptr + 1) % nTUpEvent;
+	int up = up_event_buf_ptr;
+
+	double *lastSample = DRow(d_last_sample);
+
+	// filters are applied to first difference of signal values
+	for (int l = 0; l < num_active; l++)
+		diff[l] = x[l] - lastSample[l];
+
+	// (A) filter bands and characteristic function, across lanes
+
+	for (int k = 0; k < numRecursive; k++)
+	{
+		const double hpc = highPassConst[k], lpc = lowPassConst[k], maxcf = maxCharFunctValue;
+
+		double *hp0			=	DBand(HP0, k);
+		double *hp1			=	DBand(HP1, k);
+		double *lp			=	DBand(LP, k);
+		double *lastLp		=	DBand(LAST_LP, k);
+		double *xRec		=	DBand(X_REC, k);
+		double *mean		=	DBand(MEAN_X_REC, k);
+		double *stdDev		=	DBand(STDDEV_X_REC, k);
+		double *cfTest		=	DBand(CF_TEST, k);
+		double *cfClipped	=	DBand(CF_CLIPPED_TEST, k);
+
+		for (int l = 0; l < num_active; l++)
+		{
+			// two single-pole HP filters
+			double f = hpc * (hp0[l] + diff[l]);
+			double d2 = f - hp0[l];
+			hp0[l] = f;
+			f = hpc * (hp1[l] + d2);
+			hp1[l] = f;
+			// one single-pole LP filter
+			f = lp[l] + lpc * (f - lp[l]);
+			lastLp[l] = lp[l];
+			lp[l] = f;
+
+			double x2 = f * f;
+			double cf = (x2 - mean[l]) / stdDev[l];
+			double cfc = cf > maxcf ? maxcf : cf;
+			double xr = cf > maxcf ? maxcf * stdDev[l] + mean[l] : x2;
+			if (stdDev[l] <= DOUBLE_MIN_VALUE)
+			{
+				cfc = 0.0;
+				xr = x2;
+			}
+			xRec[l] = xr;
+			cfTest[l] = cf;
+			cfClipped[l] = cfc;
+		}
+	}
+
+	// (B) characteristic function is maximum over numRecursive filter bands, per lane
+
+	{
+		const double *stdDev	=	DBand(STDDEV_X_REC, 0);
+		const double *cfTest	=	DBand(CF_TEST, 0);
+		const double *cfClipped	=	DBand(CF_CLIPPED_TEST, 0);
+		int *cfIndex			=	ISlot(up, numRecursive);
+
+		for (int l = 0; l < num_active; l++)
+		{
+			double cf = 0.0, cfc = 0.0;
+			for (int k = numRecursive - 1; k >= 0; k--)
+			{
+				if (stdDev[k * cap + l] <= DOUBLE_MIN_VALUE)
+					continue;
+				double cft = cfTest[k * cap + l];
+				if (cft >= cf)
+				{
+					cf = cft;
+					cfc = cfClipped[k * cap + l];
+					cfIndex[l] = k;
+				}
+				// trigger index is highest frequency with CF >= threshold1 over numRecursive filter bands
+				if (cft >= params.threshold1)
+					cfIndex[l] = k;
+			}
+			charFunct[l] = cf;
+			charFunctClipped[l] = cfc;
+		}
+	}
+
+	// (C) uncertainty and polarity fields, across lanes
+
+	for (int k = 0; k < numRecursive; k++)
+	{
+		const double *cfClipped	=	DBand(CF_CLIPPED_TEST, k);
+		const double *lp		=	DBand(LP, k);
+		const double *lastLp	=	DBand(LAST_LP, k);
+		double *cfUnc			=	DBand(CF_UNCERTAINTY, k);
+		double *cfUncLast		=	DBand(CF_UNCERTAINTY_LAST, k);
+		const double *uncThr	=	DBand(UNCERTAINTY_THRESHOLD, k);
+
+		int *iuCurr				=	ISlot(up, k);
+		const int *iuLast		=	ISlot(last, k);
+		double *pdsCurr			=	DSlot(up, k);
+		const double *pdsLast	=	DSlot(last, k);
+		double *psadCurr		=	DSlot(up, numRecursive + k);
+		const double *psadLast	=	DSlot(last, numRecursive + k);
+
+		for (int l = 0; l < num_active; l++)
+		{
+			cfUnc[l] = cfClipped[l];
+			bool upCharFunctUncertainty = (cfUncLast[l] < uncThr[l]) && (cfUnc[l] >= uncThr[l]);
+			cfUncLast[l] = cfUnc[l];
+
+			iuCurr[l] = upCharFunctUncertainty ? n - 1 : iuLast[l];
+
+			double inc = lp[l] - lastLp[l];
+			pdsCurr[l] = (upCharFunctUncertainty ? 0.0 : pdsLast[l]) + inc;
+			psadCurr[l] = (upCharFunctUncertainty ? 0.0 : psadLast[l]) + fabs(inc);
+		}
+	}
+
+	// (D) trigger and pick logic, per lane
+
+	for (int l = 0; l < num_active; l++)
+		UpdateTriggering(n, l, up, last);
+
+	// (E) long-term statistics, across lanes
+
+	for (int k = 0; k < numRecursive; k++)
+	{
+		const double *xRec		=	DBand(X_REC, k);
+		const double *cfUnc		=	DBand(CF_UNCERTAINTY, k);
+		double *mean			=	DBand(MEAN_X_REC, k);
+		double *stdDev			=	DBand(STDDEV_X_REC, k);
+		double *var				=	DBand(VAR_X_REC, k);
+		double *uncThr			=	DBand(UNCERTAINTY_THRESHOLD, k);
+
+		for (int l = 0; l < num_active; l++)
+		{
+			mean[l] = mean[l] * longDecayConst + xRec[l] * longDecayFactor;
+			double dev = xRec[l] - mean[l];
+			var[l] = var[l] * longDecayConst + dev * dev * longDecayFactor;
+			stdDev[l] = sqrt(var[l]);
+			double thr = uncThr[l] * longDecayConst + cfUnc[l] * longDecayFactor;
+			if (thr > maxUncertaintyThreshold)
+				thr = maxUncertaintyThreshold;
+			else if (thr < minUncertaintyThreshold)
+				thr = minUncertaintyThreshold;
+			uncThr[l] = thr;
+		}
+	}
+
+	for (int l = 0; l < num_active; l++)
+		lastSample[l] = x[l];
+}
+
+void picker_group_t :: UpdateTriggering(int n, int l, int up, int last)
+{
+	int *enableTriggering	=	IRow(I_ENABLE_TRIGGERING);
+	int *nTotal				=	IRow(I_N_TOTAL);
+	int *allowNewPickIndex	=	IRow(I_ALLOW_NEW_PICK_INDEX);
+
+	// only apply trigger and pick logic if past stabilisation time (longTermWindow)
+	if ( !(enableTriggering[l] || nTotal[l]++ > indexEnableTriggering) )
+		return;
+
+	enableTriggering[l] = TRUE_INT;
+
+	bool acceptedPick = false;
+	int indexUpEventTrigger = -1, indexUncertaintyPick = -1, triggerNumRecursiveIndex = -1;
+	int pickPolarity = POLARITY_UNKNOWN;
+
+	// update charFunctClipped values, subtract oldest value, and save provisional current sample charFunct value
+	DSlot(up, ds_integral)[l] = DSlot(last, ds_integral)[l] - DSlot(up, ds_cf_clipped_value)[l] + charFunctClipped[l];
+	DSlot(up, ds_cf_clipped_value)[l] = charFunctClipped[l];
+	DSlot(up, ds_cf_value)[l] = charFunct[l];
+
+	// if new picks allowd, check if integralCharFunct over last tUpEvent window is greater than threshold
+	if (allowNewPickIndex[l] != INT_UNSET && DSlot(up, ds_integral)[l] >= criticalIntegralCharFunct)
+	{
+		// find last point in tUpEvent window where charFunct rose past threshold1 and integralCharFunct greater than threshold back to this point
+		int m = up;
+		double integralCharFunctClippedWindow = DSlot(m, ds_cf_clipped_value)[l];
+		int k = 0;
+		while (k++ < nTUpEvent - 1 && n - k > allowNewPickIndex[l])
+		{
+			m--;
+			if (m < 0)
+				m += nTUpEvent;
+			integralCharFunctClippedWindow += DSlot(m, ds_cf_clipped_value)[l];
+			if (DSlot(m, ds_cf_value)[l] >= params.threshold1)
+			{
+				int ml = m - 1;
+				if (ml < 0)
+					ml += nTUpEvent;
+				if (DSlot(ml, ds_cf_value)[l] < params.threshold1)
+				{
+					// integralCharFunct is integralCharFunct from current point back to point m
+					if (integralCharFunctClippedWindow >= criticalIntegralCharFunct)
+					{
+						acceptedPick = true;
+						triggerNumRecursiveIndex = ISlot(m, numRecursive)[l];
+						// set index for pick uncertainty begin and end
+						indexUpEventTrigger = n - k;
+						indexUncertaintyPick = ISlot(m, triggerNumRecursiveIndex)[l];
+						// evaluate polarity based on accumulated derivative, at 1 point past trigger point
+						int iPolarity = m + 1;
+						if (iPolarity >= nTUpEvent)
+							iPolarity -= nTUpEvent;
+						double polDerivSum = DSlot(iPolarity, triggerNumRecursiveIndex)[l];
+						double polSumAbsDeriv = DSlot(iPolarity, numRecursive + triggerNumRecursiveIndex)[l];
+						double polDerivRatio = polDerivSum / polSumAbsDeriv;
+						if (polDerivSum > 0.0 && polDerivRatio > CRITICAL_POLARITY_RATIO)
+							pickPolarity = POLARITY_POS;
+						else if (polDerivSum < 0.0 && -polDerivRatio > CRITICAL_POLARITY_RATIO)
+							pickPolarity = POLARITY_NEG;
+						allowNewPickIndex[l] = INT_UNSET;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	// if no pick, check if charFunctUncertainty has dropped below threshold maxAllowNewPickThreshold to allow new picks
+	if (!acceptedPick && allowNewPickIndex[l] == INT_UNSET)
+	{
+		int k = 0;
+		for (; k < numRecursive; k++)
+			if (DBand(CF_UNCERTAINTY, k)[l] > maxAllowNewPickThreshold)
+				break;
+		if (k == numRecursive)
+			allowNewPickIndex[l] = n;
+	}
+
+	if (acceptedPick)
+	{
+		// pick begin is pick time - (trigger time - uncertainty threshold)
+		int indexBeginPick = indexUncertaintyPick - (indexUpEventTrigger - indexUncertaintyPick);
+		int indexEndPick = indexUpEventTrigger;
+		double triggerPeriod = period[triggerNumRecursiveIndex];
+		// check that uncertainty range is >= triggerPeriod / 20.0
+		double uncertainty = params.dt * ((double) (indexEndPick - indexBeginPick));
+		if (uncertainty < triggerPeriod / 20.0)
+		{
+			int ishift = (int) (0.5 * (triggerPeriod / 20.0 - uncertainty) / params.dt);
+			indexBeginPick -= ishift;
+			indexEndPick += ishift;
+		}
+		AddPick(l, n, indexBeginPick, indexEndPick, pickPolarity);
+	}
+}
+
+// Indices are relative to the run, convert them to the packet holding sample n (as Pick_FP5 does)
+void picker_group_t :: AddPick(int lane, int n, int indexBeginPick, int indexEndPick, int polarity)
+{
+	picker_channel_t *chan = lane_chan[lane];
+
+	vector<picker_run_packet_t>::const_iterator p = chan->run.begin();
+	while (p + 1 != chan->run.end() && (p + 1)->offset <= n)
+		p++;
+
+	double index0 = indexBeginPick - p->offset;
+	double index1 = indexEndPick   - p->offset;
+
+	picker_pick_t pick;
+	pick.t				=	p->start_time + ((index0 + index1) / 2 ) * params.dt;
+	pick.uncertainty	=	float( (index1 - index0) / 2 * params.dt );
+	pick.polarity		=	polarity;
+
+	chan->picks.push_back(pick);
+}
+
+/*******************************************************************************
+
+	picker_engine_t
+
+*******************************************************************************/
+
+picker_engine_t :: picker_engine_t()
+{
+	thread = NULL;
+	mutex = NULL;
+	process_mutex = NULL;
+	exitThread = false;
+}
+
+picker_engine_t :: ~picker_engine_t()
+{
+	Stop();
+
+	if (mutex != NULL)
+	{
+		SDL_DestroyMutex(mutex);
+		mutex = NULL;
+	}
+	if (process_mutex != NULL)
+	{
+		SDL_DestroyMutex(process_mutex);
+		process_mutex = NULL;
+	}
+}
+
+void picker_engine_t :: Start()
+{
+	Stop();
+
+	if (param_picker_batch_secs > 0)
+		CreateThread();
+}
+
+void picker_engine_t :: Stop()
+{
+	DestroyThread();
+
+	LockProcess();
+	Lock();
+	Clear();
+	Unlock();
+	UnlockProcess();
+}
+
+void picker_engine_t :: Clear()
+{
+	queue.clear();
+	queue_samples.clear();
+	batch.clear();
+	batch_samples.clear();
+
+	channels.clear();
+
+	for (vector<picker_group_t *>::iterator g = groups.begin(); g != groups.end(); g++)
+		delete *g;
+	groups.clear();
+}
+
+int picker_engine_t :: Update_ThreadFunc(void *engine_ptr)
+{
+	picker_engine_t *engine = (picker_engine_t *)engine_ptr;
+	engine->Update();
+	return 0;
+}
+
+void picker_engine_t :: CreateThread()
+{
+	if (mutex == NULL)
+	{
+		mutex = SDL_CreateMutex();
+		if (mutex == NULL)
+			Fatal_Error("Can't create picker engine mutex");
+	}
+
+	if (process_mutex == NULL)
+	{
+		process_mutex = SDL_CreateMutex();
+		if (process_mutex == NULL)
+			Fatal_Error("Can't create picker engine mutex");
+	}
+
+	thread = SDL_CreateThread( Update_ThreadFunc, "picker", this );
+	if (thread == NULL)
+		Fatal_Error("Can't create picker engine thread");
+}
+
+void picker_engine_t :: DestroyThread()
+{
+	if (thread != NULL)
+	{
+		exitThread = true;
+		SDL_WaitThread(thread,NULL);
+		exitThread = false;
+
+		thread = NULL;
+	}
+}
+
+void picker_engine_t :: Update()
+{
+	const Uint32 quantum_ms = Uint32(param_picker_batch_secs * 1000 + 0.5);
+
+	while (!exitThread)
+	{
+		Uint32 ticks = SDL_GetTicks();
+
+		ProcessBatch();
+
+		Uint32 elapsed = SDL_GetTicks() - ticks;
+		SDL_Delay( (elapsed < quantum_ms) ? (quantum_ms - elapsed) : 1 );
+	}
+}
+
+bool picker_engine_t :: Submit(heli_t *heli, const float *samples, int num, secs_t start_time, const picker_params_t & params)
+{
+	if (thread == NULL)
+		return false;
+
+	if (num <= 0)
+		return true;
+
+	Lock();
+
+	packet_t p;
+	p.heli			=	heli;
+	p.first			=	int(queue_samples.size());
+	p.num			=	num;
+	p.start_time	=	start_time;
+	p.params		=	params;
+
+	queue.push_back(p);
+	queue_samples.insert(queue_samples.end(), samples, samples + num);
+
+	Unlock();
+
+	return true;
+}
+
+void picker_engine_t :: Reset(heli_t *heli)
+{
+	if (thread == NULL)
+		return;
+
+	Lock();
+
+	packet_t p;
+	p.heli			=	heli;
+	p.first			=	0;
+	p.num			=	-1;
+	p.start_time	=	0;
+
+	queue.push_back(p);
+
+	Unlock();
+}
+
+void picker_engine_t :: Attach(picker_channel_t & chan, const packet_t & p)
+{
+	picker_group_t *group = NULL;
+	for (vector<picker_group_t *>::iterator g = groups.begin(); g != groups.end(); g++)
+	{
+		if ((*g)->Params() == p.params)
+		{
+			group = *g;
+			break;
+		}
+	}
+
+	if (group == NULL)
+	{
+		group = new picker_group_t(p.params);
+		groups.push_back(group);
+	}
+
+	group->AddLane(&chan, &batch_samples[p.first], p.num);
+}
+
+void picker_engine_t :: Detach(picker_channel_t & chan)
+{
+	if (chan.group != NULL)
+		chan.group->RemoveLane(chan.lane);
+}
+
+// Collect the packets to process in the current round, up to the next picker reset. Return true if ops are left for the next rounds
+bool picker_engine_t :: CollectRun(picker_channel_t & chan)
+{
+	chan.run.clear();
+	chan.run_num = 0;
+
+	// Resets before the first packet
+	while (chan.op_next < chan.ops.size() && batch[chan.ops[chan.op_next]].num < 0)
+	{
+		Detach(chan);
+		chan.op_next++;
+	}
+
+	while (chan.op_next < chan.ops.size())
+	{
+		const packet_t & p = batch[chan.ops[chan.op_next]];
+
+		if (p.num < 0)
+			break;
+
+		// Parameters changed: start over with a new picker (in the next round if packets were already collected)
+		if (chan.group != NULL && !(chan.group->Params() == p.params))
+		{
+			if (!chan.run.empty())
+				break;
+			Detach(chan);
+		}
+
+		if (chan.group == NULL)
+			Attach(chan, p);
+
+		picker_run_packet_t r;
+		r.samples		=	&batch_samples[p.first];
+		r.num			=	p.num;
+		r.offset		=	chan.run_num;
+		r.start_time	=	p.start_time;
+		chan.run.push_back(r);
+
+		chan.run_num += p.num;
+		chan.op_next++;
+	}
+
+	return chan.op_next < chan.ops.size();
+}
+
+void picker_engine_t :: ProcessBatch()
+{
+	Lock();
+	batch.swap(queue);
+	batch_samples.swap(queue_samples);
+	queue.clear();
+	queue_samples.clear();
+	Unlock();
+
+	if (batch.empty())
+		return;
+
+	LockProcess();
+
+	for (int i = 0; i < int(batch.size()); i++)
+	{
+		picker_channel_t & chan = channels[batch[i].heli];
+		chan.heli = batch[i].heli;
+		chan.ops.push_back(i);
+	}
+
+	// Rounds of processing. There's more than one only if a channel picker is reset within the batch
+
+	bool pending = true;
+	while (pending)
+	{
+		pending = false;
+
+		for (channels_t::iterator c = channels.begin(); c != channels.end(); c++)
+		{
+			if (CollectRun(c->second))
+				pending = true;
+		}
+
+		for (vector<picker_group_t *>::iterator g = groups.begin(); g != groups.end(); g++)
+			(*g)->Process();
+	}
+
+	// Deliver the results
+
+	for (channels_t::iterator c = channels.begin(); c != channels.end(); c++)
+	{
+		picker_channel_t & chan = c->second;
+		if (chan.ops.empty())
+			continue;
+
+		chan.heli->AddPickerResults(chan.picks, chan.perf_ticks, chan.perf_samples);
+
+		chan.ops.clear();
+		chan.op_next = 0;
+		chan.run.clear();
+		chan.run_num = 0;
+		chan.picks.clear();
+		chan.perf_ticks = 0;
+		chan.perf_samples = 0;
+	}
+
+	// Drop the unused groups
+
+	vector<picker_group_t *>::iterator dst = groups.begin();
+	for (vector<picker_group_t *>::iterator g = groups.begin(); g != groups.end(); g++)
+	{
+		if ((*g)->NumLanes() == 0)
+			delete *g;
+		else
+			*dst++ = *g;
+	}
+	groups.erase(dst, groups.end());
+
+	UnlockProcess();
+}
@@ -0,0 +1,261 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	Batched picker engine
+
+	The channels hand their packets over to the engine (heli_t::ComputePicks)
+	and a dedicated thread processes everything that arrived during a
+	scheduling quantum as a single batch.
+
+	Channels with the same sample rate and picker parameters form a group.
+	The FilterPicker5 state of all the channels (lanes) of a group is kept
+	in one packed arena made of rows, where each row holds the same
+	variable for every lane. The per band loops of the picker thus run
+	across lanes over contiguous memory, and vectorize.
+
+	Before processing, the lanes are sorted by decreasing number of samples
+	to process, so that at any time the active lanes are a prefix of each
+	row, and the up event ring buffers of all lanes are rotated to share the
+	same buffer index.
+
+	The algorithm is the one of Pick_FP5 (picker/FilterPicker5.c) and gives
+	the same picks as the per-channel picker. Picks are delivered to the
+	channels at the end of each batch.
+
+*******************************************************************************/
+
+#ifndef PICKER_ENGINE_H_DEF
+#define PICKER_ENGINE_H_DEF
+
+#include <vector>
+#include <map>
+#include "SDL_thread.h"
+
+#include "global.h"
+#include "picker.h"
+
+class heli_t;
+
+// Sample interval and FilterPicker5 parameters (see heli_t::ComputePicks). Channels with the same ones share a group
+class picker_params_t
+{
+public:
+	double dt, filterWindow, longTermWindow, threshold1, threshold2, tUpEvent;
+
+	picker_params_t()
+	:	dt(0), filterWindow(0), longTermWindow(0), threshold1(0), threshold2(0), tUpEvent(0)
+	{
+	}
+
+	picker_params_t(double _dt, double _filterWindow, double _longTermWindow, double _threshold1, double _threshold2, double _tUpEvent)
+	:	dt(_dt), filterWindow(_filterWindow), longTermWindow(_longTermWindow), threshold1(_threshold1), threshold2(_threshold2), tUpEvent(_tUpEvent)
+	{
+	}
+
+	bool operator == (const picker_params_t & rhs) const
+	{
+		return	dt == rhs.dt && filterWindow == rhs.filterWindow && longTermWindow == rhs.longTermWindow &&
+				threshold1 == rhs.threshold1 && threshold2 == rhs.threshold2 && tUpEvent == rhs.tUpEvent;
+	}
+};
+
+// A packet of samples to process in the current round
+struct picker_run_packet_t
+{
+	const float *samples;
+	int num;
+	int offset;			// index of the first sample in the run
+	secs_t start_time;
+};
+
+class picker_group_t;
+
+// A channel known to the engine
+struct picker_channel_t
+{
+	heli_t *heli;
+
+	picker_group_t *group;	// NULL if detached (no picker state)
+	int lane;
+
+	// Ops (packets or resets) of the current batch
+	std::vector<int> ops;
+	size_t op_next;
+
+	// Packets to process in the current round
+	std::vector<picker_run_packet_t> run;
+	int run_num;
+
+	// Results of the current batch
+	std::vector<picker_pick_t> picks;
+	Uint64 perf_ticks;
+	unsigned long perf_samples;
+
+	picker_channel_t()
+	:	heli(NULL), group(NULL), lane(-1), op_next(0), run_num(0), perf_ticks(0), perf_samples(0)
+	{
+	}
+};
+
+/*******************************************************************************
+
+	picker_group_t - FilterPicker5 state of several channels (lanes) sharing
+	                 the same parameters
+
+*******************************************************************************/
+
+class picker_group_t
+{
+private:
+
+	picker_params_t params;
+
+	// Constants (see init_filterPicker5_Memory)
+	int numRecursive, nTUpEvent;
+	double longDecayFactor, longDecayConst;
+	int indexEnableTriggering;
+	double maxUncertaintyThreshold, minUncertaintyThreshold, maxAllowNewPickThreshold;
+	double criticalIntegralCharFunct, maxCharFunctValue;
+	std::vector<double> period, lowPassConst, highPassConst;
+
+	// Double rows: one row per band for each of these, then lastSample, then nTUpEvent slots of d_slot_rows rows
+	enum {	HP0, HP1, LP, LAST_LP, X_REC, MEAN_X_REC, STDDEV_X_REC, VAR_X_REC,
+			CF_TEST, CF_CLIPPED_TEST, CF_UNCERTAINTY, CF_UNCERTAINTY_LAST, UNCERTAINTY_THRESHOLD,
+			NUM_BAND_ROWS };
+	int d_last_sample;
+	int d_plain_rows, d_slot_rows;
+	// Rows inside a slot: polarityDerivativeSum and polaritySumAbsDerivative for each band, then these
+	int ds_integral, ds_cf_clipped_value, ds_cf_value;
+
+	// Int rows: these, then nTUpEvent slots of i_slot_rows rows (indexUncertainty for each band, then charFunctNumRecursiveIndex)
+	enum {	I_ALLOW_NEW_PICK_INDEX, I_N_TOTAL, I_ENABLE_TRIGGERING, I_UP_EVENT_BUF_PTR,
+			I_PLAIN_ROWS };
+	int i_slot_rows;
+
+	// The packed arena
+	std::vector<double> d_arena, d_arena_tmp;
+	std::vector<int> i_arena, i_arena_tmp;
+	int capacity;		// row length
+
+	int up_event_buf_ptr;	// shared by the lanes during a round
+
+	std::vector<picker_channel_t *> lane_chan;
+
+	// Round buffers
+	std::vector<float> samples;		// interleaved, a row of num lanes per sample
+	std::vector<int> order;
+	std::vector<double> diff, charFunct, charFunctClipped;
+
+	double *DRow(int row)				{ return &d_arena[size_t(row) * capacity]; }
+	double *DBand(int what, int k)		{ return DRow(what * numRecursive + k); }
+	double *DSlot(int slot, int row)	{ return DRow(d_plain_rows + slot * d_slot_rows + row); }
+	int *IRow(int row)					{ return &i_arena[size_t(row) * capacity]; }
+	int *ISlot(int slot, int row)		{ return IRow(I_PLAIN_ROWS + slot * i_slot_rows + row); }
+
+	void Grow(int new_capacity);
+	void Realign();
+	void Step(int n, int num_active);
+	void AddPick(int lane, int n, int indexBeginPick, int indexEndPick, int polarity);
+	void UpdateTriggering(int n, int lane, int up, int last);
+
+public:
+
+	picker_group_t(const picker_params_t & _params);
+
+	const picker_params_t & Params() const	{ return params; }
+	int NumLanes() const					{ return int(lane_chan.size()); }
+
+	void AddLane(picker_channel_t *chan, const float *first_samples, int first_num);
+	void RemoveLane(int lane);
+
+	// Process the run of each lane (chan->run)
+	void Process();
+};
+
+/*******************************************************************************
+
+	picker_engine_t
+
+*******************************************************************************/
+
+class picker_engine_t
+{
+private:
+
+	// A packet submitted by a channel (or a picker reset if num is -1)
+	struct packet_t
+	{
+		heli_t *heli;
+		int first, num;		// in the samples pool
+		secs_t start_time;
+		picker_params_t params;
+	};
+
+	SDL_Thread	*thread;
+	SDL_mutex	*mutex;				// queue
+	SDL_mutex	*process_mutex;		// channels and groups
+	bool exitThread;
+
+	static int Update_ThreadFunc(void *engine_ptr);
+	void CreateThread();
+	void DestroyThread();
+	void Update();
+
+	void Lock()				{ if (mutex) SDL_LockMutex(mutex);				}
+	void Unlock()			{ if (mutex) SDL_UnlockMutex(mutex);			}
+	void LockProcess()		{ if (process_mutex) SDL_LockMutex(process_mutex);		}
+	void UnlockProcess()	{ if (process_mutex) SDL_UnlockMutex(process_mutex);	}
+
+	// Submitted since the last batch
+	std::vector<packet_t> queue;
+	std::vector<float> queue_samples;
+
+	// Current batch
+	std::vector<packet_t> batch;
+	std::vector<float> batch_samples;
+
+	typedef std::map<heli_t *, picker_channel_t> channels_t;
+	channels_t channels;
+	std::vector<picker_group_t *> groups;
+
+	void ProcessBatch();
+	bool CollectRun(picker_channel_t & chan);
+	void Attach(picker_channel_t & chan, const packet_t & p);
+	void Detach(picker_channel_t & chan);
+	void Clear();
+
+public:
+
+	picker_engine_t();
+	~picker_engine_t();
+
+	void Start();
+	// Also forgets all the channels, so it must be called before destroying them (see End_Heli)
+	void Stop();
+
+	// Called by the channels (with their lock held). Submit returns false if the engine is not running
+	bool Submit(heli_t *heli, const float *samples, int num, secs_t start_time, const picker_params_t & params);
+	void Reset(heli_t *heli);
+};
+
+extern picker_engine_t picker_engine;
+
+#endif
@@ -53,12 +53,39 @@ public:
 
 		return (pick < rhs.pick);
 	}
-
-	bool CheckApparentVel( const binder_pick_t & bp ) const;
 };
 
 typedef set<binder_pick_t> binder_picks_set_t;
 
+// A set of stations (by station_t::index), for constant time duplicate station checks
+class station_bits_t
+{
+private:
+
+	vector<unsigned int> words;
+
+public:
+
+	void Set(int index)
+	{
+		size_t w = size_t(index) >> 5;
+		if (w >= words.size())
+			words.resize(w + 1, 0);
+		words[w] |= 1u << (index & 31);
+	}
+
+	bool Test(int index) const
+	{
+		size_t w = size_t(index) >> 5;
+		return (w < words.size()) && ((words[w] >> (index & 31)) & 1u);
+	}
+
+	void Clear()
+	{
+		words.clear();
+	}
+};
+
 class quake_estimate_t
 {
 public:
@@ -75,9 +102,13 @@ class quake_t
 public:
 
 	secs_t secs_creation, secs_located, secs_alarm_sent;
+	secs_t secs_loc_requested;	// last location request (see binder_t::RequestQuakeLoc)
+	int loc_generation;			// number of location requests, the result of the latest one is used
+	bool loc_pending;			// new picks are waiting for the search in flight to finish
 	int alarm_seq;
 	int id;
 	binder_picks_set_t picks;
+	station_bits_t stations;	// stations of the picks
 	origin_t origin;
 	float mag_s, mag_p;
 	float mag, mag_min, mag_max;
@@ -87,14 +118,21 @@ public:
 
 	vector<quake_estimate_t> estimates;
 
+	// P arrivals predicted by the origin, calculated with it (see binder_t::CalcQuakeArrivals)
+	vector<float> arrivals;					// travel time to each station (by station_t::index), -1 if unknown. Empty if not located
+	bool arrivals_changed;					// not indexed by the binder yet
+	vector<secs_t> arrival_keys;			// keys in binder_t::arrival_index, by station (0 if not indexed)
+
 	quake_t(int _id)
 		:	secs_creation(SecsNow()), secs_located(0), secs_alarm_sent(0),
+			secs_loc_requested(0), loc_generation(0), loc_pending(false),
 			alarm_seq(0),
 			id(_id),
 			origin(0,0,0),
 			mag_s(-1), mag_p(-1),
 			mag(-1), mag_min(-1), mag_max(-1),
-			mail_log(""), mail_sent(false)
+			mail_log(""), mail_sent(false),
+			arrivals_changed(false)
 	{}
 
 	void LinkPick(const binder_pick_t & new_pick);
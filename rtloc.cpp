@@ -31,12 +31,9 @@
 #include "gui.h"
 #include "config.h"
 #include "loading_bar.h"
+#include "worker_pool.h"
 
 
-float tnow; //Current time has to be a global variable
-float sigma;
-int edt_null;
-
 char *statfilename;
 char *logfilename;
 
@@ -48,6 +45,196 @@ rtloc_t :: rtloc_t() :
 	Pgrid(NULL),
 	Sgrid(NULL)
 {
+	params.ptt = NULL;
+	params.pgrid_shared = 0;
+}
+
+// 2D grids (1D velocity model) of stations at the same elevation are identical, so a single copy of the values is kept.
+// Return the index of an earlier grid identical to grids[n], or -1
+static int SameGrid2d(const GridDesc *grids, int n)
+{
+	const GridDesc *g = &grids[n];
+
+	if (g->type != GRID_TIME_2D)
+		return -1;
+
+	// 16-bit grids are compared by their codes and scale
+	bool q16 = (g->qbuffer != NULL);
+	const void *values = q16 ? (const void *)g->qbuffer : (const void *)g->buffer;
+	size_t size = size_t(g->numx) * g->numy * g->numz * (q16 ? sizeof(unsigned short) : sizeof(float));
+
+	for (int m = 0; m < n; m++)
+	{
+		const GridDesc *h = &grids[m];
+
+		if ( h->type == GRID_TIME_2D && h->numx == g->numx && h->numy == g->numy && h->numz == g->numz &&
+			 h->origy == g->origy && h->origz == g->origz && h->dy == g->dy && h->dz == g->dz &&
+			 (h->qbuffer != NULL) == q16 && (!q16 || (h->qscale == g->qscale && h->qoffset == g->qoffset)) &&
+			 memcmp(q16 ? (const void *)h->qbuffer : (const void *)h->buffer, values, size) == 0 )
+			return m;
+	}
+
+	return -1;
+}
+
+void rtloc_t :: FreeGridBuf(GridDesc *grid, grid_buf_t buf)
+{
+	switch (buf)
+	{
+		case GRIDBUF_READ:
+			DestroyGridArray(grid);
+			FreeGrid(grid);
+			break;
+
+		case GRIDBUF_MAPPED:
+			DestroyGridArray(grid);
+			UnmapGrid3dBuf(grid);
+			break;
+
+		case GRIDBUF_SHARED:
+			grid->array		=	NULL;
+			grid->buffer	=	NULL;
+			grid->qbuffer	=	NULL;
+			break;
+
+		case GRIDBUF_Q16_READ:
+			FreeGrid16(grid);
+			break;
+
+		case GRIDBUF_Q16_MAPPED:
+			UnmapGrid3dBuf16(grid);
+			break;
+	}
+}
+
+// Whether two grids have the same size, origin and spacing
+static bool SameGeometry(const GridDesc *g, const GridDesc *h)
+{
+	return	g->numx  == h->numx  && g->numy  == h->numy  && g->numz  == h->numz  &&
+			g->origx == h->origx && g->origy == h->origy && g->origz == h->origz &&
+			g->dx    == h->dx    && g->dy    == h->dy    && g->dz    == h->dz;
+}
+
+// Read and validate the header of a travel time grid (not thread safe: NLL uses globals here). The values are loaded by LoadGridBuf_JobFunc
+void rtloc_t :: OpenGrid(char *fname, GridDesc *grid, SourceDesc *psrce)
+{
+	FILE *hdr, *buf;
+
+	if ( OpenGrid3dFile(fname, &buf, &hdr, grid, "time", psrce, 0) < 0) {
+		puterr2 ("ERROR opening grid file: ", fname);
+//		exit (EXIT_ERROR_FILEIO);
+		Fatal_Error("RTLoc: can't open grid file: " + string(fname));
+	}
+	CloseGrid3dFile(&buf, &hdr);
+
+	if (grid->numx < 1 || grid->numy < 1 || grid->numz < 1)
+		Fatal_Error("RTLoc: grid file: " + string(fname) + " has an invalid size");
+	if (grid->numx == 1 && grid->type != GRID_TIME_2D)
+		Fatal_Error("RTLoc: grid file: " + string(fname) + " must be 3D (i.e. numx > 1) or 2D of type TIME2D");
+}
+
+// Load the values of a grid whose header has been read: map them from the file (or read them).
+// With locate_quantized_grids, load the 16-bit codes from the .buf16 file instead, or quantize the values.
+// Runs on a worker thread, so errors are left in the job for the main thread
+void rtloc_t :: LoadGridBuf_JobFunc(void *arg, int worker)
+{
+	grid_load_t *l = (grid_load_t *)arg;
+	GridDesc *grid = l->grid;
+
+	Uint64 perf_start = SDL_GetPerformanceCounter();
+
+	if ( param_locate_quantized_grids )
+	{
+		if ( param_locate_mmap_grids && MapGrid3dBuf16(grid, l->fname) != NULL )
+			*l->buf = GRIDBUF_Q16_MAPPED;
+		else if ( ReadGrid3dBuf16(grid, l->fname) != NULL )
+			*l->buf = GRIDBUF_Q16_READ;
+		else
+		{
+			// A .buf16 file is there but does not match the grid, e.g. it was made before the .buf was written again
+			char fn_grid[FILENAME_MAX];
+			sprintf(fn_grid, "%s.buf16", l->fname);
+
+			FILE *buf16 = fopen(fn_grid, "rb");
+			if (buf16 != NULL)
+			{
+				l->stale_buf16 = true;
+				fclose(buf16);
+			}
+		}
+	}
+
+	if ( grid->qbuffer != NULL )
+	{
+		// 16-bit codes are read without the array access
+	}
+	else if ( param_locate_mmap_grids && MapGrid3dBuf(grid, l->fname) != NULL )
+	{
+		*l->buf = GRIDBUF_MAPPED;
+	}
+	else
+	{
+		l->map_failed = (param_locate_mmap_grids != 0);
+		*l->buf = GRIDBUF_READ;
+
+		// AJL 20070110 - set up standard NLL grid storage and array access
+		if ( AllocateGrid(grid) == NULL )
+		{
+			l->error = "out of memory reading";
+		}
+		else
+		{
+			char fn_grid[FILENAME_MAX];
+			sprintf(fn_grid, "%s.buf", l->fname);
+
+			FILE *buf = fopen(fn_grid, "rb");
+			if ( buf == NULL || ReadGrid3dBuf(grid, buf) != 0 )
+				l->error = "can't read";
+			if (buf != NULL)
+				fclose(buf);
+		}
+	}
+
+	// No .buf16 file: quantize the values, then drop them
+	if ( l->error == NULL && param_locate_quantized_grids && grid->qbuffer == NULL )
+	{
+		if ( QuantizeGrid(grid) != 0 )
+		{
+			l->error = "out of memory quantizing";
+		}
+		else
+		{
+			FreeGridBuf(grid, *l->buf);
+			*l->buf = GRIDBUF_Q16_READ;
+			l->quantized = true;
+		}
+	}
+
+	if ( l->error == NULL && grid->qbuffer == NULL && CreateGridArray(grid) == NULL )
+		l->error = "out of memory reading";
+
+	l->ticks = SDL_GetPerformanceCounter() - perf_start;
+
+	// The loading bar is drawn by the main thread only
+	int num_done = SDL_AtomicAdd(l->num_done, 1) + 1;
+	if (worker == 0)
+		LoadingBar_SetNextPercent(100.0f * num_done / l->num_total);
+}
+
+// Keep a single copy of the values of grid n, if identical to an earlier 2D grid
+void rtloc_t :: ShareGrid2d(GridDesc *grids, vector<grid_buf_t> & bufs, int n)
+{
+	int m = SameGrid2d(grids, n);
+	if (m < 0)
+		return;
+
+	GridDesc *grid = &grids[n];
+
+	FreeGridBuf(grid, bufs[n]);
+	grid->buffer	=	grids[m].buffer;
+	grid->array		=	grids[m].array;
+	grid->qbuffer	=	grids[m].qbuffer;
+	bufs[n]			=	GRIDBUF_SHARED;
 }
 
 void rtloc_t :: Init(const string & ctrlfilename)
@@ -56,6 +243,7 @@ void rtloc_t :: Init(const string & ctrlfilename)
 
 	FILE *ctrlfile;
 	ctrlfile = ReadCtrlFile (ctrlfilename.c_str(), &params);
+	params.ctx = NULL;
 
 	cout << endl;
 	cout << "==================================================================================================" << endl;
@@ -80,74 +268,181 @@ void rtloc_t :: Init(const string & ctrlfilename)
 	int nsta = params.nsta;
 //	int npick = params.npick;
 
-	sigma = params.sigma;
-
 	station = ReadStation (ctrlfile, station, nsta);
 
 //	pick = ReadPick (ctrlfile, pick, npick, station, nsta);
 
 	// AJL 20070111
 	// initialize random number generator - usef by OctTree
-	SRAND_FUNC(9837);
+//luca: each search seeds its own generator (see Locate)
+//	SRAND_FUNC(9837);
 	// -AJL
 
 	/* Set null value for edt according to the approach chosen */
-	if ( params.sum ) edt_null = 0;
-	else edt_null = 1;
+	if ( params.sum ) params.edt_null = 0;
+	else params.edt_null = 1;
 
 	Pgrid = (GridDesc *) calloc (nsta, sizeof(GridDesc));
 	Sgrid = (GridDesc *) calloc (nsta, sizeof(GridDesc));
 	if (Pgrid == NULL || Sgrid == NULL)
 		Fatal_Error("RTLoc: out of memory allocating the location grids");
 
+	Pgrid_buf.assign(nsta, GRIDBUF_READ);
+	Sgrid_buf.assign(nsta, GRIDBUF_READ);
+
 	/* Let's open all the time grid files... */
-	LoadingBar_Start();
-	for (int n=0; n<nsta; n++) {
-		FILE *Phdr, *Shdr, *Pbuf, *Sbuf;
 
-		LoadingBar_SetNextPercent(100.0f * (n+1) / nsta);
+	// Headers first, on this thread, so that an invalid grid is reported before reading the values of any.
+	// 3D grids with a geometry different from the others still work, but they may not cover the whole location grid
+	// (travel times are clamped to their edges) and each search node must then be located in each grid
+	const GridDesc *geom = NULL;
+	const char *geom_fname = NULL;
+	int num_other_geom = 0;
+	for (int n=0; n<nsta; n++) {
+		OpenGrid(station[n].Pfile, &Pgrid[n], &station[n].desc);
+		OpenGrid(station[n].Sfile, &Sgrid[n], NULL);
 
-		// P
-		if ( OpenGrid3dFile(station[n].Pfile, &Pbuf, &Phdr, &Pgrid[n], "time", &station[n].desc, 0) < 0) {
-			puterr2 ("ERROR opening grid file: ", station[n].Pfile);
-//			exit (EXIT_ERROR_FILEIO);
-			Fatal_Error("RTLoc: can't open grid file: " + string(station[n].Pfile));
-		}
-		// AJL 20070110 - set up standard NLL grid storage and array access
-		if ( AllocateGrid(&Pgrid[n]) == NULL )
-			Fatal_Error("RTLoc: out of memory reading grid file: " + string(station[n].Pfile));
-		if ( CreateGridArray(&Pgrid[n]) == NULL )
-			Fatal_Error("RTLoc: out of memory reading grid file: " + string(station[n].Pfile));
-		if ( ReadGrid3dBuf(&Pgrid[n], Pbuf) != 0 )
-			Fatal_Error("RTLoc: can't read grid file: " + string(station[n].Pfile));
-		CloseGrid3dFile(&Pbuf, &Phdr);
-		if (Pgrid[n].numx <= 1)
-			Fatal_Error("RTLoc: grid file: " + string(station[n].Pfile) + " must be 3D, not 2D (i.e. numx > 1)");
-		// S
-		if ( OpenGrid3dFile(station[n].Sfile, &Sbuf, &Shdr, &Sgrid[n], "time", NULL, 0) < 0) {
-			puterr2 ("ERROR opening grid file: ", station[n].Sfile);
-//			exit (EXIT_ERROR_FILEIO);
-			Fatal_Error("RTLoc: can't open grid file: " + string(station[n].Sfile));
+		const GridDesc *grids[2]	=	{ &Pgrid[n], &Sgrid[n] };
+		const char *fnames[2]		=	{ station[n].Pfile, station[n].Sfile };
+		for (int i = 0; i < 2; i++)
+		{
+			if (grids[i]->type == GRID_TIME_2D)
+				continue;
+
+			if (geom == NULL)
+			{
+				geom		=	grids[i];
+				geom_fname	=	fnames[i];
+			}
+			else if (!SameGeometry(grids[i], geom) && num_other_geom++ == 0)
+			{
+				cout << "RTLoc: WARNING: grid file: " << fnames[i] << " has a different size, origin or spacing than: " << geom_fname << endl;
+			}
 		}
-		// AJL 20070110 - set up standard NLL grid storage and array access
-		if ( AllocateGrid(&Sgrid[n]) == NULL )
-			Fatal_Error("RTLoc: out of memory reading grid file: " + string(station[n].Sfile));
-		if ( CreateGridArray(&Sgrid[n]) == NULL )
-			Fatal_Error("RTLoc: out of memory reading grid file: " + string(station[n].Sfile));
-		if ( ReadGrid3dBuf(&Sgrid[n], Sbuf) != 0 )
-			Fatal_Error("RTLoc: can't read grid file: " + string(station[n].Sfile));
-		CloseGrid3dFile(&Sbuf, &Shdr);
-		if (Sgrid[n].numx <= 1)
-			Fatal_Error("RTLoc: grid file: " + string(station[n].Sfile) + " must be 3D, not 2D (i.e. numx > 1)");
-
-		/*TODO: we have to check all the grids to be the same or
-		think at defining a grid which contains them all */
 	}
+	if (num_other_geom)
+		cout << "RTLoc: WARNING: " << num_other_geom << " 3D travel time grids have a different size, origin or spacing than: " << geom_fname << endl;
+
+	// Then the values, a few grids at a time (bounded by locate_load_threads, not to thrash the disk)
+	vector<grid_load_t> loads(2 * nsta);
+	vector<void *> loads_args(2 * nsta);
+	SDL_atomic_t num_done;
+	SDL_AtomicSet(&num_done, 0);
+	for (int i = 0; i < 2 * nsta; i++)
+	{
+		int n = i / 2;
+		bool s = (i % 2) != 0;
+		grid_load_t & l = loads[i];
+
+		l.fname		=	s ? station[n].Sfile	: station[n].Pfile;
+		l.grid		=	s ? &Sgrid[n]			: &Pgrid[n];
+		l.buf		=	s ? &Sgrid_buf[n]		: &Pgrid_buf[n];
+		l.num_done	=	&num_done;
+		l.num_total	=	2 * nsta;
+		l.error		=	NULL;
+		l.map_failed	=	false;
+		l.quantized		=	false;
+		l.stale_buf16	=	false;
+		l.ticks		=	0;
+
+		loads_args[i] = &l;
+	}
+
+	worker_pool_t pool;
+	pool.Start(int(param_locate_load_threads) - 1, "rtloc");
+
+	LoadingBar_Start();
+	Uint64 perf_start = SDL_GetPerformanceCounter();
+	pool.Run( LoadGridBuf_JobFunc, loads_args.empty() ? NULL : &loads_args[0], int(loads_args.size()) );
+	double load_secs = double(SDL_GetPerformanceCounter() - perf_start) / SDL_GetPerformanceFrequency();
 	LoadingBar_End();
 
+	pool.Stop();
+
+	// Throughput of each grid and of all of them
+	double read_mb = 0, mapped_mb = 0, max_qerror = 0;
+	int num_q16 = 0;
+	for (size_t i = 0; i < loads.size(); i++)
+	{
+		const grid_load_t & l = loads[i];
+
+		if (l.error != NULL)
+			Fatal_Error("RTLoc: " + string(l.error) + " grid file: " + string(l.fname));
+		if (l.map_failed)
+			cout << "RTLoc: can't map grid file: " << l.fname << ", reading it" << endl;
+		if (l.stale_buf16)
+			cout << "RTLoc: WARNING: grid file: " << l.fname << ".buf16 was not made from " << l.fname << ".buf (run quantgrid again), quantizing it" << endl;
+
+		// Size of the file loaded: 16-bit codes, unless quantized here
+		bool q16	=	(l.grid->qbuffer != NULL);
+		bool mapped	=	(*l.buf == GRIDBUF_MAPPED || *l.buf == GRIDBUF_Q16_MAPPED);
+		double mb	=	double(l.grid->numx) * l.grid->numy * l.grid->numz * ((q16 && !l.quantized) ? sizeof(unsigned short) : sizeof(float)) / (1024 * 1024);
+		double secs	=	double(l.ticks) / SDL_GetPerformanceFrequency();
+
+		cout << "RTLoc: " << (mapped ? "mapped" : "read") << " grid file: " << l.fname << ((q16 && !l.quantized) ? ".buf16" : "") << ": " << mb << " MB in " << secs * 1000 << " ms";
+		if (!mapped && secs > 0)
+			cout << " (" << mb / secs << " MB/s)";
+		if (q16)
+			cout << (l.quantized ? ", quantized" : "") << ", max error " << l.grid->qerror * 1000 << " ms";
+		cout << endl;
+
+		if (mapped)
+			mapped_mb	+=	mb;
+		else
+			read_mb		+=	mb;
+
+		if (q16)
+		{
+			num_q16		+=	1;
+			max_qerror	=	max(max_qerror, l.grid->qerror);
+		}
+	}
+	cout << "RTLoc: " << loads.size() << " travel time grids loaded in " << load_secs << " s by " << pool.NumWorkers() << " threads: " <<
+		read_mb << " MB read (" << ((load_secs > 0) ? read_mb / load_secs : 0.0) << " MB/s), " << mapped_mb << " MB mapped" << endl;
+	if (num_q16)
+		cout << "RTLoc: " << num_q16 << " travel time grids stored as 16-bit fixed point, max error " << max_qerror * 1000 << " ms" << endl;
+
+	for (int n=0; n<nsta; n++) {
+		ShareGrid2d(Pgrid, Pgrid_buf, n);
+		ShareGrid2d(Sgrid, Sgrid_buf, n);
+	}
+
+	// Node-major copy of the P travel times, read by the searches instead of the station grids
+	params.ptt = NULL;
+	if (param_locate_interleaved_tt)
+	{
+		params.ptt = CreateTTTable(Pgrid, nsta);
+		if (params.ptt == NULL)
+			Fatal_Error("RTLoc: can't interleave the P travel times: the grids must have the same size, origin and spacing (or out of memory)");
+	}
+
+	// With a common geometry, each search node is located once for all the P grids
+	params.pgrid_shared = SameGridGeometry(Pgrid, nsta);
+
+	int num_2d = 0, num_shared = 0;
+	for (int n=0; n<nsta; n++)
+	{
+		num_2d		+=	(Pgrid[n].type == GRID_TIME_2D)		+ (Sgrid[n].type == GRID_TIME_2D);
+		num_shared	+=	(Pgrid_buf[n] == GRIDBUF_SHARED)	+ (Sgrid_buf[n] == GRIDBUF_SHARED);
+	}
+	if (num_2d)
+		cout << "RTLoc: " << num_2d << " 2D travel time grids, " << num_2d - num_shared << " distinct" << endl;
+
 	/* If all the grids are the same, we can use one of them
 	as a prototype for the location grid */
-	initLocGrid(&Pgrid[0], &Grid);
+	GridDesc proto = Pgrid[0];
+
+	// The location grid can also be given in the control file (it must be with 2D travel time grids)
+	if (params.locgrid.numx > 0)
+	{
+		proto.numx	=	params.locgrid.numx;	proto.origx	=	params.locgrid.origx;	proto.dx	=	params.locgrid.dx;
+		proto.numy	=	params.locgrid.numy;	proto.origy	=	params.locgrid.origy;	proto.dy	=	params.locgrid.dy;
+		proto.numz	=	params.locgrid.numz;	proto.origz	=	params.locgrid.origz;	proto.dz	=	params.locgrid.dz;
+	}
+	else if (Pgrid[0].type == GRID_TIME_2D)
+		Fatal_Error("RTLoc: 2D travel time grids need a LOCGRID line in " + ctrlfilename);
+
+	initLocGrid(&proto, &Grid);
 	DestroyGridArray(&Grid);
 	FreeGrid(&Grid);
 }
@@ -157,20 +452,16 @@ rtloc_t :: ~rtloc_t()
 	for (int n=0; n<params.nsta; n++)
 	{
 		if (Pgrid != NULL)
-		{
-			DestroyGridArray(&Pgrid[n]);
-			FreeGrid(&Pgrid[n]);
-		}
+			FreeGridBuf(&Pgrid[n], Pgrid_buf[n]);
 
 		if (Sgrid != NULL)
-		{
-			DestroyGridArray(&Sgrid[n]);
-			FreeGrid(&Sgrid[n]);
-		}
+			FreeGridBuf(&Sgrid[n], Sgrid_buf[n]);
 	}
 
 	free(Pgrid);
 	free(Sgrid);
+
+	FreeTTTable(params.ptt);
 }
 
 // FIXME remove
@@ -211,21 +502,21 @@ bool rtloc_t :: IsPointInGrid(float lon, float lat, float dep)
 {
 	float x,y;
 	LonLat_To_XY(lon, lat, &x, &y);
-	return IsPointInsideGrid(&Pgrid[0],double(x),double(y),double(dep)) ? true : false;
+	return IsPointInsideGrid(&Grid,double(x),double(y),double(dep)) ? true : false;
 }
 
 void rtloc_t :: GetGridArea(float *min_lon, float *min_lat, float *min_dep, float *max_lon, float *max_lat, float *max_dep, float *dx, float *dy, float *dz)
 {
-	XY_To_LonLat( float(Pgrid->origx),                               float(Pgrid->origy),                               min_lon, min_lat);
+	XY_To_LonLat( float(Grid.origx),                             float(Grid.origy),                             min_lon, min_lat);
 
-	XY_To_LonLat( float(Pgrid->origx + (Pgrid->numx-1) * Pgrid->dx), float(Pgrid->origy + (Pgrid->numy-1) * Pgrid->dy), max_lon, max_lat);
+	XY_To_LonLat( float(Grid.origx + (Grid.numx-1) * Grid.dx),   float(Grid.origy + (Grid.numy-1) * Grid.dy),   max_lon, max_lat);
 
-	*min_dep =    float(Pgrid->origz);
-	*max_dep =    float(Pgrid->origz + (Pgrid->numz-1) * Pgrid->dz);
+	*min_dep =    float(Grid.origz);
+	*max_dep =    float(Grid.origz + (Grid.numz-1) * Grid.dz);
 
-	*dx = float(Pgrid->dx);
-	*dy = float(Pgrid->dy);
-	*dz = float(Pgrid->dz);
+	*dx = float(Grid.dx);
+	*dy = float(Grid.dy);
+	*dz = float(Grid.dz);
 }
 
 float rtloc_t :: TravelTime(const string & stname, char wave, float lon, float lat, float dep)
@@ -248,7 +539,7 @@ float rtloc_t :: TravelTime(const string & stname, char wave, float lon, float l
 
 	float x,y;
 	LonLat_To_XY(lon,lat, &x,&y);
-	return ReadAbsInterpGrid3d(/*NULL,*/ grid, double(x), double(y), double(dep));
+	return ReadTimeGrid3d(grid, double(x), double(y), double(dep));
 }
 
 void rtloc_t :: GetStationLonLatDep(const string & stname, float *lon, float *lat, float *dep)
@@ -305,12 +596,46 @@ void rtloc_t :: DistanceWithError(const string & stname, const origin_t & o, flo
 	}
 }
 
-void rtloc_t :: Locate( quake_t & q, origin_t *o )
+bool rtloc_t :: Locate( const binder_picks_set_t & q_picks, origin_t *o, vector<float> *picks_rms, SDL_atomic_t *cancel, NodeArena *arena )
 {
 	int i, statid;
 
 	int evid = 0;
 
+	// Skip the search if it was cancelled while waiting
+	if (cancel != NULL && SDL_AtomicGet(cancel))
+		return false;
+
+	// Everything a search writes to is private to this call: the parameters (number of picks and search context),
+	// the station associations and the location grid. The travel time grids are only read
+
+	SearchContext ctx;
+	ctx.tnow			=	0;
+	ctx.resultTreeRoot	=	NULL;
+	ctx.tt_pick			=	NULL;
+	ctx.tt_sta			=	NULL;
+	ctx.cancel			=	cancel;
+	rinit_r(&ctx.rand, 9837);	// same seed for every search, so that results do not depend on the order of the searches
+
+	// The nodes of the octree and of the results tree come from an arena, reset at once at the end of the search
+	// (see OctTreeSearch), so that the next search on this thread reuses its blocks without allocating.
+	// The first block fits all the nodes of a search that evaluates max_num_nodes cells
+	const OcttreeParams & op = params.octtreeParams;
+	NodeArena tmp_arena;
+	if (arena == NULL)
+	{
+		tmp_arena.first = NULL;
+		arena = &tmp_arena;
+	}
+	if (arena->first == NULL)
+		initNodeArena(arena, size_t(op.init_num_cells_x * op.init_num_cells_y * op.init_num_cells_z + op.max_num_nodes) * (sizeof(OctNode) + sizeof(ResultTreeNode)));
+	ctx.arena			=	arena;
+
+	Control search_params = params;
+	search_params.ctx = &ctx;
+
+	GridDesc grid = Grid;
+
 	// Reset station association with the event. Start by ignoring all stations when locating.
 	// We will add triggering stations and non-triggering stations (if in stations.txt) later.
 
@@ -319,22 +644,26 @@ void rtloc_t :: Locate( quake_t & q, origin_t *o )
 	// *  0  =  not associated (no pick)
 	// *  1  =  associated (pick)
 
+	vector<struct Station> station( this->station, this->station + params.nsta );
+	vector<int> station_evid( params.nsta );
+
 	for (statid = 0; statid < params.nsta; statid++)
 	{
+		station[statid].evid = &station_evid[statid];
 		station[statid].evid[evid] = -1;	// -1 means ignore
 	}
 
 	// Convert quake picks to Pick array, and mark the stations with a pick to be used in the location
 
-	secs_t t_first_pick = q.picks.begin()->pick.t;
-	secs_t t_last_pick  = q.picks.rbegin()->pick.t;
+	secs_t t_first_pick = q_picks.begin()->pick.t;
+	secs_t t_last_pick  = q_picks.rbegin()->pick.t;
 
-	int npicks = int(q.picks.size());
-	params.npick = npicks;
+	int npicks = int(q_picks.size());
+	search_params.npick = npicks;
 	Pick *picks = new Pick[npicks];
 
-	binder_picks_set_t::iterator p;
-	for (i = 0, p = q.picks.begin(); p != q.picks.end(); p++, i++)
+	binder_picks_set_t::const_iterator p;
+	for (i = 0, p = q_picks.begin(); p != q_picks.end(); p++, i++)
 	{
 		statid = StationNameToId(p->heli->station->name);
 
@@ -411,7 +740,7 @@ void rtloc_t :: Locate( quake_t & q, origin_t *o )
 
 	// Use the maximum time of the last sample of data over all the working station as tnow for location
 
-	tnow = float(t_end_max - t_first_pick);
+	ctx.tnow = float(t_end_max - t_first_pick);
 
 	Vect3D mean;
 	Vect3D ml_hypo;
@@ -419,13 +748,16 @@ void rtloc_t :: Locate( quake_t & q, origin_t *o )
 	float ml_otime;
 	Ellipsoid3D ell;
 
-	/*double prob_max = */SearchEdt(&Grid, picks, station, nsta_working, Pgrid, Sgrid, evid, &params, (!realtime && param_debug_save_rtloc) ? 1 : 0, &mean, &ml_hypo, &cov, &ell, &ml_otime);
+	/*double prob_max = */SearchEdt(&grid, picks, &station[0], nsta_working, Pgrid, Sgrid, evid, &search_params, (!realtime && param_debug_save_rtloc) ? 1 : 0, &mean, &ml_hypo, &cov, &ell, &ml_otime);
+
+	bool cancelled = (cancel != NULL && SDL_AtomicGet(cancel));
+
 	// Calc RMS of this pick based on the most likely quake location (not used, maybe in the future..)
-	for (i = 0, p = q.picks.begin(); p != q.picks.end(); p++, i++)
+	if (!cancelled && picks_rms != NULL)
 	{
-		float rms = GetRms(&ml_hypo, Pgrid, Sgrid, picks, i, &Grid, &params);
-		// FIXME: circumvent the fact we aren't allowed to change set elements
-		const_cast<pick_t *>(&p->pick)->quake_rms = rms;
+		picks_rms->resize(npicks);
+		for (i = 0; i < npicks; i++)
+			(*picks_rms)[i] = GetRms(&ml_hypo, Pgrid, Sgrid, picks, i, &grid, &search_params);
 	}
 
 /*
@@ -459,9 +791,9 @@ void rtloc_t :: Locate( quake_t & q, origin_t *o )
 	o->lat		=	float(double_lat);
 	o->dep		=	float(double_dep);
 
-	o->mean_x	=	float(Grid.origx + mean.x * Grid.dx);
-	o->mean_y	=	float(Grid.origy + mean.y * Grid.dy);
-	o->mean_z	=	float(Grid.origz + mean.z * Grid.dz);
+	o->mean_x	=	float(grid.origx + mean.x * grid.dx);
+	o->mean_y	=	float(grid.origy + mean.y * grid.dy);
+	o->mean_z	=	float(grid.origz + mean.z * grid.dz);
 
 	if (param_locate_ignore_error)
 	{
@@ -481,9 +813,13 @@ void rtloc_t :: Locate( quake_t & q, origin_t *o )
 	o->time		=	t_first_pick + secs_t( ml_otime );
 
 	// Clean up
-	DestroyGridArray(&Grid);
-	FreeGrid(&Grid);
+	DestroyGridArray(&grid);
+	FreeGrid(&grid);
 	delete [] picks;
+	if (arena == &tmp_arena)
+		freeNodeArena(&tmp_arena);
+
+	return !cancelled;
 }
 
 
@@ -589,8 +925,8 @@ float rtloc_t :: QuakeRadiusAfterSecs(char wave, const origin_t & o, float secs)
 	double sta_x = station[sta_id].desc.x;
 	double sta_y = station[sta_id].desc.y;
 
-	double min_x = grid->origx;
-	double max_x = grid->origx + grid->numx * grid->dx;
+	double min_x = Grid.origx;
+	double max_x = Grid.origx + Grid.numx * Grid.dx;
 
 	double near_x = sta_x;
 	double far_x = ((max_x - sta_x) > (sta_x - min_x)) ? max_x : min_x;
@@ -600,7 +936,7 @@ float rtloc_t :: QuakeRadiusAfterSecs(char wave, const origin_t & o, float secs)
 
 	while ( abs(far_x-near_x) > 0.25f && (x > min_x) && (x < max_x) )
 	{
-		float ttime = ReadAbsInterpGrid3d(/*NULL,*/ grid, x, y, o.dep);
+		float ttime = ReadTimeGrid3d(grid, x, y, o.dep);
 
 		if (ttime - secs > 0)
 		{
@@ -620,7 +956,7 @@ float rtloc_t :: QuakeRadiusAfterSecs(char wave, const origin_t & o, float secs)
 
 	// propagate at constant speed outside of the grid
 
-	float ttime = ReadAbsInterpGrid3d(/*NULL,*/ grid, x, y, o.dep);
+	float ttime = ReadTimeGrid3d(grid, x, y, o.dep);
 	if (secs > ttime)
 	{
 		float vel = r / ttime;
@@ -26,6 +26,8 @@
 #ifndef RTLOC_H_DEF
 #define RTLOC_H_DEF
 
+#include "SDL_atomic.h"
+
 #include "global.h"
 
 #include "quake.h"
@@ -39,11 +41,38 @@ private:
 
 	struct Station *station;
 
-	GridDesc Grid;		// Location grid
+	GridDesc Grid;		// Location grid (template without storage: each search allocates its own)
 
 	GridDesc *Pgrid;	// P-Travel time grid for each station
 	GridDesc *Sgrid;	// S-Travel time grid for each station
 
+	// Where the values of each grid live: read into memory, mapped from the file, or shared with an identical 2D grid of another station.
+	// 16-bit grids are read from their .buf16 file (or quantized when loaded) or mapped from it
+	enum grid_buf_t { GRIDBUF_READ, GRIDBUF_MAPPED, GRIDBUF_SHARED, GRIDBUF_Q16_READ, GRIDBUF_Q16_MAPPED };
+	vector<grid_buf_t> Pgrid_buf, Sgrid_buf;
+
+	// A grid whose values are loaded on a worker thread, after its header has been read (see LoadGridBuf_JobFunc)
+	struct grid_load_t
+	{
+		char *fname;
+		GridDesc *grid;
+		grid_buf_t *buf;
+
+		SDL_atomic_t *num_done;	// grids loaded so far, for the loading bar
+		int num_total;
+
+		const char *error;		// NULL if loaded
+		bool map_failed;		// read because it could not be mapped
+		bool quantized;			// read as floats and quantized (no .buf16 file)
+		bool stale_buf16;		// the .buf16 file was not made from this grid (see quantgrid), so it was quantized
+		Uint64 ticks;			// time spent loading the values
+	};
+
+	void OpenGrid(char *fname, GridDesc *grid, SourceDesc *psrce);
+	static void LoadGridBuf_JobFunc(void *arg, int worker);
+	void ShareGrid2d(GridDesc *grids, vector<grid_buf_t> & bufs, int n);
+	static void FreeGridBuf(GridDesc *grid, grid_buf_t buf);
+
 	int StationNameToId(const string & stname);
 
 public:
@@ -52,7 +81,11 @@ public:
 	~rtloc_t();
 
 	void Init(const string & ctrlfile);
-	void Locate( quake_t & q, origin_t *o );
+	// Locate from the picks of a quake, optionally returning the RMS of each pick (in picks order).
+	// Return false if cancel was set during the search (o is then undefined).
+	// Reentrant: the state of a search is private, so quakes can be located on several threads at once.
+	// The nodes of the search come from arena, one per thread, whose blocks are kept for its next search (NULL = a temporary arena)
+	bool Locate( const binder_picks_set_t & picks, origin_t *o, vector<float> *picks_rms = NULL, SDL_atomic_t *cancel = NULL, NodeArena *arena = NULL );
 	void DistanceWithError(const string & stname, const origin_t & o, float *distance, float *error);
 
 	// x,y in km. 0 is the grid center
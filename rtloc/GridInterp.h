@@ -0,0 +1,318 @@
+/*
+ * @file GridInterp.h trilinear interpolation of travel time grids, inlined
+ *
+ * Copyright (C) 2009-2015 Luca Elia
+ * This file is part of RTLoc, as modified for PRESTo Early Warning System.
+ *
+ * RTLoc is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * RTLoc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with RTLoc; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+   Reading a travel time grid at a point is split in two steps: locating the
+   point in the grid geometry (the cell containing it and the weights of its
+   corners) and reading the corners from a buffer. Grids with the same
+   geometry (e.g. the P grids of all the stations) share the first step, so
+   a location is computed once and then read from any number of grids.
+
+   The bodies are here, instead of in GridLib.cpp, so that they are actually
+   inlined: INLINE is defined empty by the build, and a function defined in
+   another translation unit can not be inlined anyway.
+
+   The results are exactly those of ReadAbsInterpGrid3d (interpolate) or
+   ReadAbsGrid3dValue with ifloor = 1 (!interpolate), for time grids.
+   Angle grids must still be read with ReadAbsInterpGrid3d.
+
+   2D time grids (NonLinLoc TIME2D, for 1D velocity models) have a single x
+   node: y is the epicentral distance from the station (srcx, srcy) and z the
+   depth. They are read through ReadTimeGrid2d, which clamps to the grid
+   edges like the 3D reads do (ReadAbsInterpGrid2d returns -VERY_LARGE_DOUBLE
+   instead).
+
+   Grids stored as 16-bit fixed point (qbuffer, see GridQuant.cpp) are read
+   through ReadGridValue: the corner codes are interpolated and then scaled,
+   so no float copy of the grid is ever made. Since the weights sum to 1,
+   this is the interpolation of the dequantized corners.
+*/
+
+#ifndef GRIDINTERP_H
+#define GRIDINTERP_H
+
+
+/* A location in a grid geometry: the offsets of the corners of the cell containing it and the interpolation weights */
+struct GridPoint {
+	long corner[8];						/* offsets of the nodes 000,001,010,011,100,101,110,111 (in floats) */
+	double xdiff, ydiff, zdiff;
+	int mode;							/* GRIDPOINT_INTERP, GRIDPOINT_NODE (at corner 0) or GRIDPOINT_OUTSIDE */
+};
+#define GRIDPOINT_INTERP	0
+#define GRIDPOINT_NODE		1
+#define GRIDPOINT_OUTSIDE	2
+
+
+/*
+   LocateGridPoint: locates (xloc, yloc, zloc) in a grid with the given
+   geometry. The node offsets are multiplied by stride: 1 for a GridDesc
+   buffer, the number of interleaved grids for a TTTable.
+   The offsets are divided by the node spacing (not multiplied by its
+   reciprocal) so that the cell and the weights are bit for bit those of
+   ReadAbsInterpGrid3d.
+*/
+inline void LocateGridPoint (int numx, int numy, int numz, double origx, double origy, double origz,
+		double dx, double dy, double dz, long stride, double xloc, double yloc, double zloc, int interpolate,
+		struct GridPoint *ppt)
+{
+	int ix0, ix1, iy0, iy1, iz0, iz1;
+	double xoff, yoff, zoff;
+	long stridez = stride, stridey = stridez * numz, stridex = stridey * numy;
+	long x0, x1, y0, y1;
+
+	if (!interpolate) {
+		/* nearest grid node below the point */
+		ix0 = (int) ((xloc - origx) / dx);
+		iy0 = (int) ((yloc - origy) / dy);
+		iz0 = (int) ((zloc - origz) / dz);
+
+		if (ix0 < 0 || ix0 >= numx || iy0 < 0 || iy0 >= numy || iz0 < 0 || iz0 >= numz) {
+			ppt->mode = GRIDPOINT_OUTSIDE;
+			return;
+		}
+
+		ppt->corner[0] = ix0 * stridex + iy0 * stridey + iz0 * stridez;
+		ppt->mode = GRIDPOINT_NODE;
+		return;
+	}
+
+	/* calculate grid locations on edge of solid containing point */
+
+	xoff = (xloc - origx) / dx;
+	ix0 = (int) (xoff - VERY_SMALL_DOUBLE);
+	yoff = (yloc - origy) / dy;
+	iy0 = (int) (yoff - VERY_SMALL_DOUBLE);
+	zoff = (zloc - origz) / dz;
+	iz0 = (int) (zoff - VERY_SMALL_DOUBLE);
+
+	if (ix0 < 0) ix0 = 0;
+	if (iy0 < 0) iy0 = 0;
+	if (iz0 < 0) iz0 = 0;
+	if (ix0 > numx-1) ix0 = numx-1;
+	if (iy0 > numy-1) iy0 = numy-1;
+	if (iz0 > numz-1) iz0 = numz-1;
+
+	ix1 = (ix0 < numx - 1) ? ix0 + 1 : ix0;
+	iy1 = (iy0 < numy - 1) ? iy0 + 1 : iy0;
+	iz1 = (iz0 < numz - 1) ? iz0 + 1 : iz0;
+
+	ppt->xdiff = xoff - (DOUBLE) ix0;
+	ppt->ydiff = yoff - (DOUBLE) iy0;
+	ppt->zdiff = zoff - (DOUBLE) iz0;
+
+	if (ppt->xdiff <   0) ppt->xdiff =   0;
+	if (ppt->xdiff > 1.0) ppt->xdiff = 1.0;
+	if (ppt->ydiff <   0) ppt->ydiff =   0;
+	if (ppt->ydiff > 1.0) ppt->ydiff = 1.0;
+	if (ppt->zdiff <   0) ppt->zdiff =   0;
+	if (ppt->zdiff > 1.0) ppt->zdiff = 1.0;
+
+	x0 = ix0 * stridex;	x1 = ix1 * stridex;
+	y0 = iy0 * stridey;	y1 = iy1 * stridey;
+
+	ppt->corner[0] = x0 + y0 + iz0 * stridez;
+	ppt->corner[1] = x0 + y0 + iz1 * stridez;
+	ppt->corner[2] = x0 + y1 + iz0 * stridez;
+	ppt->corner[3] = x0 + y1 + iz1 * stridez;
+	ppt->corner[4] = x1 + y0 + iz0 * stridez;
+	ppt->corner[5] = x1 + y0 + iz1 * stridez;
+	ppt->corner[6] = x1 + y1 + iz0 * stridez;
+	ppt->corner[7] = x1 + y1 + iz1 * stridez;
+
+	/* location at grid node */
+	if (ppt->xdiff + ppt->ydiff + ppt->zdiff < SMALL_FLOAT)
+		ppt->mode = GRIDPOINT_NODE;
+	else
+		ppt->mode = GRIDPOINT_INTERP;
+}
+
+
+/* SetGridPoint: locates (xloc, yloc, zloc) in the geometry of pgrid */
+inline void SetGridPoint (const GridDesc *pgrid, double xloc, double yloc, double zloc, int interpolate, struct GridPoint *ppt)
+{
+	LocateGridPoint(pgrid->numx, pgrid->numy, pgrid->numz, pgrid->origx, pgrid->origy, pgrid->origz,
+			pgrid->dx, pgrid->dy, pgrid->dz, 1, xloc, yloc, zloc, interpolate, ppt);
+}
+
+
+/* ReadGridPoint: value of a time grid buffer at a point set by LocateGridPoint (same as InterpCubeLagrange) */
+inline float ReadGridPoint (const float *buffer, const struct GridPoint *ppt)
+{
+	DOUBLE vval000, vval001, vval010, vval011, vval100, vval101, vval110, vval111;
+	DOUBLE oneMinusXdiff, oneMinusYdiff, oneMinusZdiff;
+	DOUBLE xdiff, ydiff, zdiff;
+
+	if (ppt->mode == GRIDPOINT_OUTSIDE)
+		return(-VERY_LARGE_FLOAT);
+
+	if (ppt->mode == GRIDPOINT_NODE)
+		return buffer[ppt->corner[0]];
+
+	vval000 = buffer[ppt->corner[0]];
+	vval001 = buffer[ppt->corner[1]];
+	vval010 = buffer[ppt->corner[2]];
+	vval011 = buffer[ppt->corner[3]];
+	vval100 = buffer[ppt->corner[4]];
+	vval101 = buffer[ppt->corner[5]];
+	vval110 = buffer[ppt->corner[6]];
+	vval111 = buffer[ppt->corner[7]];
+
+	// INGV
+	// check for invalid / mask nodes
+	if (vval000 < 0.0 || vval010 < 0.0 || vval100 < 0.0 || vval110 < 0.0
+			  || vval001 < 0.0 || vval011 < 0.0 || vval101 < 0.0 || vval111 < 0.0)
+		return(-VERY_LARGE_DOUBLE);
+
+	xdiff = ppt->xdiff;
+	ydiff = ppt->ydiff;
+	zdiff = ppt->zdiff;
+
+	oneMinusXdiff = 1.0 - xdiff;
+	oneMinusYdiff = 1.0 - ydiff;
+	oneMinusZdiff = 1.0 - zdiff;
+
+	return (float)
+		( vval000 * (oneMinusXdiff) * (oneMinusYdiff)  * (oneMinusZdiff)
+		+ vval001 * (oneMinusXdiff) * (oneMinusYdiff)  * zdiff
+		+ vval010 * (oneMinusXdiff) * ydiff          * (oneMinusZdiff)
+		+ vval011 * (oneMinusXdiff) * ydiff          * zdiff
+		+ vval100 * xdiff         * (oneMinusYdiff)  * (oneMinusZdiff)
+		+ vval101 * xdiff         * (oneMinusYdiff)  * zdiff
+		+ vval110 * xdiff         * ydiff          * (oneMinusZdiff)
+		+ vval111 * xdiff         * ydiff          * zdiff );
+}
+
+
+/* 16-bit code of the nodes without a valid time (negative in the float grid) */
+#define QGRID_MASK			0xffff
+#define QGRID_MASK_VALUE	(-1.0f)
+
+/* DequantizeGridValue: time value of a 16-bit code of a grid */
+inline float DequantizeGridValue (const GridDesc *pgrid, unsigned short q)
+{
+	if (q == QGRID_MASK)
+		return QGRID_MASK_VALUE;
+
+	return (float) (pgrid->qoffset + pgrid->qscale * q);
+}
+
+
+/* ReadGridPointQ16: value of a 16-bit time grid at a point set by LocateGridPoint (same as ReadGridPoint on the dequantized grid) */
+inline float ReadGridPointQ16 (const GridDesc *pgrid, const struct GridPoint *ppt)
+{
+	const unsigned short *qbuffer = pgrid->qbuffer;
+	unsigned int q000, q001, q010, q011, q100, q101, q110, q111;
+	DOUBLE oneMinusXdiff, oneMinusYdiff, oneMinusZdiff;
+	DOUBLE xdiff, ydiff, zdiff;
+
+	if (ppt->mode == GRIDPOINT_OUTSIDE)
+		return(-VERY_LARGE_FLOAT);
+
+	if (ppt->mode == GRIDPOINT_NODE)
+		return DequantizeGridValue(pgrid, qbuffer[ppt->corner[0]]);
+
+	q000 = qbuffer[ppt->corner[0]];
+	q001 = qbuffer[ppt->corner[1]];
+	q010 = qbuffer[ppt->corner[2]];
+	q011 = qbuffer[ppt->corner[3]];
+	q100 = qbuffer[ppt->corner[4]];
+	q101 = qbuffer[ppt->corner[5]];
+	q110 = qbuffer[ppt->corner[6]];
+	q111 = qbuffer[ppt->corner[7]];
+
+	/* invalid / mask nodes */
+	if (q000 == QGRID_MASK || q010 == QGRID_MASK || q100 == QGRID_MASK || q110 == QGRID_MASK
+			  || q001 == QGRID_MASK || q011 == QGRID_MASK || q101 == QGRID_MASK || q111 == QGRID_MASK)
+		return(-VERY_LARGE_DOUBLE);
+
+	xdiff = ppt->xdiff;
+	ydiff = ppt->ydiff;
+	zdiff = ppt->zdiff;
+
+	oneMinusXdiff = 1.0 - xdiff;
+	oneMinusYdiff = 1.0 - ydiff;
+	oneMinusZdiff = 1.0 - zdiff;
+
+	return (float) ( pgrid->qoffset + pgrid->qscale *
+		( q000 * (oneMinusXdiff) * (oneMinusYdiff)  * (oneMinusZdiff)
+		+ q001 * (oneMinusXdiff) * (oneMinusYdiff)  * zdiff
+		+ q010 * (oneMinusXdiff) * ydiff          * (oneMinusZdiff)
+		+ q011 * (oneMinusXdiff) * ydiff          * zdiff
+		+ q100 * xdiff         * (oneMinusYdiff)  * (oneMinusZdiff)
+		+ q101 * xdiff         * (oneMinusYdiff)  * zdiff
+		+ q110 * xdiff         * ydiff          * (oneMinusZdiff)
+		+ q111 * xdiff         * ydiff          * zdiff ) );
+}
+
+
+/* ReadGridValue: value of a time grid (float or 16-bit) at a point set by SetGridPoint */
+inline float ReadGridValue (const GridDesc *pgrid, const struct GridPoint *ppt)
+{
+	if (pgrid->qbuffer != NULL)
+		return ReadGridPointQ16(pgrid, ppt);
+
+	return ReadGridPoint(pgrid->buffer, ppt);
+}
+
+
+/* ReadTimeGrid2d: value of a 2D time grid at a point, by its epicentral distance from the grid source */
+inline float ReadTimeGrid2d (const GridDesc *pgrid, double xloc, double yloc, double zloc, int interpolate)
+{
+	struct GridPoint pt;
+	double dist = sqrt((xloc - pgrid->srcx) * (xloc - pgrid->srcx) + (yloc - pgrid->srcy) * (yloc - pgrid->srcy));
+
+	LocateGridPoint(1, pgrid->numy, pgrid->numz, 0.0, pgrid->origy, pgrid->origz,
+			1.0, pgrid->dy, pgrid->dz, 1, 0.0, dist, zloc, interpolate, &pt);
+	return ReadGridValue(pgrid, &pt);
+}
+
+
+/* ReadTimeGrid3d: interpolated value of a time grid at a point (same as ReadAbsInterpGrid3d) */
+inline float ReadTimeGrid3d (const GridDesc *pgrid, double xloc, double yloc, double zloc)
+{
+	struct GridPoint pt;
+
+	if (pgrid->type == GRID_TIME_2D)
+		return ReadTimeGrid2d(pgrid, xloc, yloc, zloc, 1);
+
+	SetGridPoint(pgrid, xloc, yloc, zloc, 1, &pt);
+	return ReadGridValue(pgrid, &pt);
+}
+
+
+/* SameGridGeometry: 1 if the n grids are 3D time grids with the same geometry, so that they can share a GridPoint */
+inline int SameGridGeometry (const GridDesc *grids, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (grids[i].type == GRID_ANGLE || grids[i].type == GRID_ANGLE_2D || grids[i].type == GRID_TIME_2D)
+			return 0;
+		if (grids[i].numx != grids[0].numx || grids[i].numy != grids[0].numy || grids[i].numz != grids[0].numz ||
+			grids[i].origx != grids[0].origx || grids[i].origy != grids[0].origy || grids[i].origz != grids[0].origz ||
+			grids[i].dx != grids[0].dx || grids[i].dy != grids[0].dy || grids[i].dz != grids[0].dz)
+			return 0;
+	}
+
+	return 1;
+}
+
+
+#endif
@@ -722,8 +722,9 @@ float* AllocateGrid(GridDesc* pgrid)
 
 	pgrid->buffer = (float *) malloc((size_t)
 		(pgrid->numx * pgrid->numy * pgrid->numz * sizeof(float)));
-	if (pgrid->buffer != NULL)
-		NumAllocations++;
+//luca: not thread safe, and never read
+//	if (pgrid->buffer != NULL)
+//		NumAllocations++;
 
 	return(pgrid->buffer);
 }
@@ -736,7 +737,8 @@ void FreeGrid(GridDesc* pgrid)
 {
 	if (pgrid->buffer != NULL) {
 		free(pgrid->buffer);
-		NumAllocations--;
+//luca
+//		NumAllocations--;
 	}
 	pgrid->buffer = NULL;
 }
@@ -772,14 +774,16 @@ float*** CreateGridArray(GridDesc* pgrid)
 			malloc((size_t) pgrid->numx * sizeof(float **)))
 			== NULL)
 		return(garray);
-	NumAllocations++;
+//luca
+//	NumAllocations++;
 
 	numyz = pgrid->numy * pgrid->numz;
 	for (ix = 0; ix < pgrid->numx; ix++) {
         	if ((garray[ix] = (float **) malloc((size_t) pgrid->numy *
 				sizeof(float *))) == NULL)
 			return(NULL);
-		NumAllocations++;
+//luca
+//		NumAllocations++;
 		for (iy = 0; iy < pgrid->numy; iy++) {
         		garray[ix][iy] = pgrid->buffer +
 			ix * numyz + iy * pgrid->numz;
@@ -804,11 +808,13 @@ void DestroyGridArray(GridDesc* pgrid)
 
 		for (ix = 0; ix < pgrid->numx; ix++) {
         		free(pgrid->array[ix]);
-			NumAllocations--;
+//luca
+//			NumAllocations--;
 		}
 
 		free(pgrid->array);
-		NumAllocations--;
+//luca
+//		NumAllocations--;
 
 		pgrid->array = NULL;
 
@@ -1741,6 +1747,9 @@ int nparsed = sscanf(line, "%d %d %d  %lf %lf %lf  %lf %lf %lf  %s %*s",
 		psrce->y = psrce_buf.y;
 		psrce->z = psrce_buf.z;
 	}
+
+	pgrid->srcx = psrce_buf.x;
+	pgrid->srcy = psrce_buf.y;
 }
 
 	// save filename as grid identifier
@@ -1997,6 +2006,10 @@ INLINE float ReadAbsInterpGrid3d(/*FILE *fpgrid,*/ GridDesc* pgrid, double xloc,
 	int numx, numy, numz, numyz;
 	float *buffer;
 
+//luca: time grids are read with the inlined kernel (see GridInterp.h), only angles are interpolated here
+	if (pgrid->type != GRID_ANGLE && pgrid->type != GRID_ANGLE_2D)
+		return ReadTimeGrid3d(pgrid, xloc, yloc, zloc);
+
 	buffer = pgrid->buffer;
 	numx = pgrid->numx;
 	numy = pgrid->numy;
@@ -234,6 +234,12 @@ typedef struct
 	double sum;			/* sum of grid values */
 	int iSwapBytes;			/* flag to specify if hi/lo bytes should be swapped
 	                                        when reading grid from disk files */
+//luca
+	double srcx, srcy;		/* horizontal position of the source (station) of a time grid:
+						   2D grids are read at the epicentral distance from it */
+	unsigned short *qbuffer;	/* time values as 16-bit fixed point, in place of buffer (see GridQuant.cpp) */
+	double qscale, qoffset;		/* value = qoffset + qscale * q */
+	double qerror;			/* max abs error of the values w.r.t. the float grid */
 }
 GridDesc;
 
@@ -821,5 +827,8 @@ int WriteDiffArrival(FILE* fpio, HypoDesc* hypos, ArrivalDesc* parr, int iWriteT
 /* */
 /*------------------------------------------------------------/ */
 
+//luca
+#include "GridInterp.h"
+
 //luca
 #endif
@@ -0,0 +1,149 @@
+/*
+ * @file GridMap.cpp grid buffers mapped from their files
+ *
+ * Copyright (C) 2009-2015 Luca Elia
+ * This file is part of RTLoc, as modified for PRESTo Early Warning System.
+ *
+ * RTLoc is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * RTLoc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with RTLoc; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "rtloclib.h"
+
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+static size_t GridBufSize (const GridDesc *pgrid)
+{
+	return (size_t) pgrid->numx * pgrid->numy * pgrid->numz * sizeof(float);
+}
+
+
+/*
+   MapFileView: maps the first size bytes of a file read-only. Nothing is
+   copied: the pages are read from the file when first touched, and are
+   shared by all the processes mapping it.
+   Returns NULL if the file can not be mapped (missing or too short).
+*/
+void *MapFileView (const char *fname, size_t size)
+{
+	void *p;
+
+	if (size == 0)
+		return NULL;
+
+#if defined(WIN32)
+	{
+		HANDLE file, mapping;
+		LARGE_INTEGER filesize;
+
+		file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return NULL;
+
+		if (!GetFileSizeEx(file, &filesize) || (unsigned __int64) filesize.QuadPart < size) {
+			CloseHandle(file);
+			return NULL;
+		}
+
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (mapping == NULL)
+			return NULL;
+
+		/* the view keeps the mapping alive */
+		p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+		CloseHandle(mapping);
+		if (p == NULL)
+			return NULL;
+	}
+#else
+	{
+		int fd;
+		struct stat st;
+
+		fd = open(fname, O_RDONLY);
+		if (fd < 0)
+			return NULL;
+
+		if (fstat(fd, &st) != 0 || (size_t) st.st_size < size) {
+			close(fd);
+			return NULL;
+		}
+
+		p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (p == MAP_FAILED)
+			return NULL;
+
+		/* start reading the file in the background, so that the first location does not wait for the disk */
+		madvise(p, size, MADV_WILLNEED);
+	}
+#endif
+
+	return p;
+}
+
+
+/* UnmapFileView: releases a view made by MapFileView */
+void UnmapFileView (void *p, size_t size)
+{
+	if (p == NULL)
+		return;
+
+#if defined(WIN32)
+	UnmapViewOfFile(p);
+#else
+	munmap(p, size);
+#endif
+}
+
+
+/*
+   MapGrid3dBuf: maps the buffer file (fname.buf) of a grid read-only, in
+   place of AllocateGrid + ReadGrid3dBuf. The header must have been read
+   already (OpenGrid3dFile).
+   Returns pgrid->buffer, or NULL if the file can not be mapped (missing,
+   shorter than the header says, or in the opposite byte order).
+*/
+float *MapGrid3dBuf (GridDesc *pgrid, const char *fname)
+{
+	char fn_grid[FILENAME_MAX];
+
+	pgrid->buffer = NULL;
+
+	if (pgrid->iSwapBytes)
+		return NULL;
+
+	sprintf(fn_grid, "%s.buf", fname);
+
+	pgrid->buffer = (float *) MapFileView(fn_grid, GridBufSize(pgrid));
+	return pgrid->buffer;
+}
+
+
+/* UnmapGrid3dBuf: releases a buffer mapped by MapGrid3dBuf (in place of FreeGrid) */
+void UnmapGrid3dBuf (GridDesc *pgrid)
+{
+	UnmapFileView(pgrid->buffer, GridBufSize(pgrid));
+	pgrid->buffer = NULL;
+}
@@ -0,0 +1,274 @@
+/*
+ * @file GridQuant.cpp time grids stored as 16-bit fixed point
+ *
+ * Copyright (C) 2009-2015 Luca Elia
+ * This file is part of RTLoc, as modified for PRESTo Early Warning System.
+ *
+ * RTLoc is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * RTLoc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with RTLoc; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+   The valid times of a grid (>= 0) are mapped linearly on the codes
+   0..65534, from the smallest to the largest: value = qoffset + qscale * q.
+   65535 (QGRID_MASK) marks the invalid / mask nodes (negative times).
+   Rounding to the nearest code bounds the error by qscale / 2, i.e. the
+   range of the times / 131068: 0.76 ms for times up to 100 s. The actual
+   max error is measured when quantizing (qerror).
+
+   Grids can be quantized when loaded, or in advance by the quantgrid tool,
+   which writes the codes next to the float grid, in fname.buf16:
+   a QGridFileHeader followed by the codes, in the same order as fname.buf.
+   The header records the size and modification time of fname.buf, so that
+   a .buf16 file is not used once fname.buf has been written again (e.g. with
+   another velocity model), or copied without keeping its time.
+*/
+
+
+#include "rtloclib.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+
+#define QGRID_MAGIC		"RTLQ16V2"
+
+/* Header of a .buf16 file. The codes follow, in native byte order */
+struct QGridFileHeader {
+	char magic[8];						/* QGRID_MAGIC */
+	int byteorder;						/* 1, to detect files written on hosts of the opposite byte order */
+	int numx, numy, numz;				/* geometry of the float grid, to detect a stale file */
+	double origx, origy, origz;
+	double dx, dy, dz;
+	double bufsize, bufmtime;			/* of the fname.buf file quantized, to detect a stale file */
+	double qscale, qoffset, qerror;
+};
+
+
+static size_t GridNumNodes (const GridDesc *pgrid)
+{
+	return (size_t) pgrid->numx * pgrid->numy * pgrid->numz;
+}
+
+
+/*
+   QuantizeGrid: fills pgrid->qbuffer (and qscale, qoffset, qerror) from
+   the float values in pgrid->buffer, which is left untouched.
+   Returns 0, or -1 if out of memory.
+*/
+int QuantizeGrid (GridDesc *pgrid)
+{
+	size_t numnodes = GridNumNodes(pgrid), n;
+	const float *buffer = pgrid->buffer;
+	float vmin = 0, vmax = 0, v;
+	int nvalid = 0;
+	double q, err;
+
+	for (n=0; n<numnodes; n++) {
+		v = buffer[n];
+		if (!(v >= 0))
+			continue;
+		if (nvalid == 0 || v < vmin) vmin = v;
+		if (nvalid == 0 || v > vmax) vmax = v;
+		nvalid = 1;
+	}
+
+	pgrid->qoffset = vmin;
+	pgrid->qscale = (vmax > vmin) ? ((double) vmax - vmin) / (QGRID_MASK - 1) : 1.0;
+	pgrid->qerror = 0;
+
+	pgrid->qbuffer = (unsigned short *) malloc (numnodes * sizeof(unsigned short));
+	if (pgrid->qbuffer == NULL)
+		return -1;
+
+	for (n=0; n<numnodes; n++) {
+		v = buffer[n];
+		if (!(v >= 0)) {
+			pgrid->qbuffer[n] = QGRID_MASK;
+			continue;
+		}
+
+		q = floor((v - pgrid->qoffset) / pgrid->qscale + 0.5);
+		if (q > QGRID_MASK - 1)
+			q = QGRID_MASK - 1;
+		pgrid->qbuffer[n] = (unsigned short) q;
+
+		err = fabs(DequantizeGridValue(pgrid, pgrid->qbuffer[n]) - v);
+		if (err > pgrid->qerror)
+			pgrid->qerror = err;
+	}
+
+	return 0;
+}
+
+
+/* Size and modification time of fname.buf. Returns 0, or -1 if missing */
+static int StatGridBuf (const char *fname, double *size, double *mtime)
+{
+	char fn_grid[FILENAME_MAX];
+	struct stat st;
+
+	sprintf(fn_grid, "%s.buf", fname);
+
+	if (stat(fn_grid, &st) != 0)
+		return -1;
+
+	*size = (double) st.st_size;
+	*mtime = (double) st.st_mtime;
+	return 0;
+}
+
+
+/* Returns 0, or -1 if fname.buf is missing */
+static int SetQGridFileHeader (struct QGridFileHeader *phdr, const GridDesc *pgrid, const char *fname)
+{
+	memset(phdr, 0, sizeof(struct QGridFileHeader));
+	if (StatGridBuf(fname, &phdr->bufsize, &phdr->bufmtime) != 0)
+		return -1;
+	memcpy(phdr->magic, QGRID_MAGIC, sizeof(phdr->magic));
+	phdr->byteorder = 1;
+	phdr->numx = pgrid->numx;	phdr->numy = pgrid->numy;	phdr->numz = pgrid->numz;
+	phdr->origx = pgrid->origx;	phdr->origy = pgrid->origy;	phdr->origz = pgrid->origz;
+	phdr->dx = pgrid->dx;		phdr->dy = pgrid->dy;		phdr->dz = pgrid->dz;
+	phdr->qscale = pgrid->qscale;
+	phdr->qoffset = pgrid->qoffset;
+	phdr->qerror = pgrid->qerror;
+	return 0;
+}
+
+
+/*
+   1 if a .buf16 header was written for the geometry of pgrid, from the current fname.buf,
+   on a host with the same byte order. Sets the scale and error
+*/
+static int CheckQGridFileHeader (const struct QGridFileHeader *phdr, GridDesc *pgrid, const char *fname)
+{
+	double bufsize, bufmtime;
+
+	if (memcmp(phdr->magic, QGRID_MAGIC, sizeof(phdr->magic)) != 0 || phdr->byteorder != 1 ||
+		phdr->numx != pgrid->numx || phdr->numy != pgrid->numy || phdr->numz != pgrid->numz ||
+		phdr->origx != pgrid->origx || phdr->origy != pgrid->origy || phdr->origz != pgrid->origz ||
+		phdr->dx != pgrid->dx || phdr->dy != pgrid->dy || phdr->dz != pgrid->dz)
+		return 0;
+
+	if (StatGridBuf(fname, &bufsize, &bufmtime) != 0 ||
+		phdr->bufsize != bufsize || phdr->bufmtime != bufmtime)
+		return 0;
+
+	pgrid->qscale = phdr->qscale;
+	pgrid->qoffset = phdr->qoffset;
+	pgrid->qerror = phdr->qerror;
+	return 1;
+}
+
+
+/* WriteGrid3dBuf16: writes the codes of a quantized grid to fname.buf16. Returns 0, or -1 on error */
+int WriteGrid3dBuf16 (const GridDesc *pgrid, const char *fname)
+{
+	char fn_grid[FILENAME_MAX];
+	struct QGridFileHeader hdr;
+	FILE *fp;
+	int ok;
+
+	sprintf(fn_grid, "%s.buf16", fname);
+
+	if (SetQGridFileHeader(&hdr, pgrid, fname) != 0)
+		return -1;
+
+	if ((fp = fopen(fn_grid, "wb")) == NULL)
+		return -1;
+
+	ok =	fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+			fwrite(pgrid->qbuffer, GridNumNodes(pgrid) * sizeof(unsigned short), 1, fp) == 1;
+
+	if (fclose(fp) != 0)
+		ok = 0;
+
+	return ok ? 0 : -1;
+}
+
+
+/*
+   ReadGrid3dBuf16: reads the codes of a grid from fname.buf16, in place of
+   AllocateGrid + ReadGrid3dBuf. The header must have been read already
+   (OpenGrid3dFile). Returns pgrid->qbuffer, or NULL if the file is missing,
+   was made for another grid or host or from an older fname.buf, or if out of memory.
+*/
+unsigned short *ReadGrid3dBuf16 (GridDesc *pgrid, const char *fname)
+{
+	char fn_grid[FILENAME_MAX];
+	struct QGridFileHeader hdr;
+	size_t size = GridNumNodes(pgrid) * sizeof(unsigned short);
+	FILE *fp;
+
+	pgrid->qbuffer = NULL;
+
+	sprintf(fn_grid, "%s.buf16", fname);
+
+	if ((fp = fopen(fn_grid, "rb")) == NULL)
+		return NULL;
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) == 1 && CheckQGridFileHeader(&hdr, pgrid, fname)) {
+		pgrid->qbuffer = (unsigned short *) malloc (size);
+		if (pgrid->qbuffer != NULL && fread(pgrid->qbuffer, size, 1, fp) != 1)
+			FreeGrid16(pgrid);
+	}
+
+	fclose(fp);
+	return pgrid->qbuffer;
+}
+
+
+/* MapGrid3dBuf16: as ReadGrid3dBuf16, but maps the file read-only (see MapFileView) */
+unsigned short *MapGrid3dBuf16 (GridDesc *pgrid, const char *fname)
+{
+	char fn_grid[FILENAME_MAX];
+	size_t size = sizeof(struct QGridFileHeader) + GridNumNodes(pgrid) * sizeof(unsigned short);
+	char *p;
+
+	pgrid->qbuffer = NULL;
+
+	sprintf(fn_grid, "%s.buf16", fname);
+
+	p = (char *) MapFileView(fn_grid, size);
+	if (p == NULL)
+		return NULL;
+
+	if (!CheckQGridFileHeader((const struct QGridFileHeader *) p, pgrid, fname)) {
+		UnmapFileView(p, size);
+		return NULL;
+	}
+
+	pgrid->qbuffer = (unsigned short *) (p + sizeof(struct QGridFileHeader));
+	return pgrid->qbuffer;
+}
+
+
+/* FreeGrid16: releases the codes made by QuantizeGrid or read by ReadGrid3dBuf16 */
+void FreeGrid16 (GridDesc *pgrid)
+{
+	free(pgrid->qbuffer);
+	pgrid->qbuffer = NULL;
+}
+
+
+/* UnmapGrid3dBuf16: releases the codes mapped by MapGrid3dBuf16 */
+void UnmapGrid3dBuf16 (GridDesc *pgrid)
+{
+	if (pgrid->qbuffer == NULL)
+		return;
+
+	UnmapFileView((char *) pgrid->qbuffer - sizeof(struct QGridFileHeader),
+			sizeof(struct QGridFileHeader) + GridNumNodes(pgrid) * sizeof(unsigned short));
+	pgrid->qbuffer = NULL;
+}
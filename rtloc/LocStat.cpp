@@ -19,7 +19,8 @@
  */ 
 
 #include "rtloclib.h"
-extern float tnow;
+//luca: tnow is taken from the search parameters (reentrant)
+//extern float tnow;
 
 //TODO: simplify the API, maybe with a "hypocenter" data class
 //luca
@@ -276,7 +277,7 @@ else
 /* PRINT HYPOCENTER STATISTICS */
 //luca
 //	printstat("RTLOC\n");
-	printstat("TIME %4.2f\n", tnow);
+	printstat("TIME %4.2f\n", params->ctx->tnow);
 	printstat("HYPOCENTER x %6.3f y %6.3f z %6.3f OT %6.3f\n", fhypo.x, fhypo.y, fhypo.z, origtime);
 	printstat("QUALITY RMS %6.3f Nphs %d\n", rms, npick);
 //luca
@@ -30,11 +30,14 @@
 
 // Octtree
 //#include "octtree.h"
-Tree3D* octTree;		// the Octtree
-ResultTreeNode* resultTreeRoot;	// Octtree likelihood*volume results tree root node
+//luca: the octtree is local to LocOctree, the results tree is in the search context (reentrant)
+//Tree3D* octTree;		// the Octtree
+//ResultTreeNode* resultTreeRoot;	// Octtree likelihood*volume results tree root node
 #define OCTREE_UNDEF_VALUE -VERY_SMALL_DOUBLE
 
-Tree3D*  InitializeOcttree(GridDesc* ptgrid, OcttreeParams* octtreeParams);
+//luca
+//Tree3D*  InitializeOcttree(GridDesc* ptgrid, OcttreeParams* octtreeParams);
+Tree3D*  InitializeOcttree(GridDesc* ptgrid, OcttreeParams* octtreeParams, NodeArena* arena);
 
 
 int RTLocConvertOctTree2Grid(Tree3D* tree, double dx, double dy, double dz, char *grid_type, GridDesc *pgrid_out, double *maxvalue)
@@ -232,7 +235,9 @@ else
 
 //printf("addResult(resultTreeRoot %ld, log_value_volume %lf, volume %lf, poct_node %ld\n",
 //resultTreeRoot, log_value_volume, volume, poct_node);
-	resultTreeRoot = addResult(resultTreeRoot, log_value_volume, volume, poct_node);
+//luca
+//	resultTreeRoot = addResult(resultTreeRoot, log_value_volume, volume, poct_node);
+	params->ctx->resultTreeRoot = addResult(params->ctx->resultTreeRoot, log_value_volume, volume, poct_node, &params->ctx->rand, params->ctx->arena);
 
 	return(log_prob);
 
@@ -296,7 +301,7 @@ struct Station *station, int  nsta_working,
 	// first get solutions at each cell in Tree3D
 
 	nSamples = 0;
-	resultTreeRoot = NULL;
+	params->ctx->resultTreeRoot = NULL;
 	for (ix = 0; ix < pOctTree->numx; ix++) {
 		for (iy = 0; iy < pOctTree->numy; iy++) {
 			for (iz = 0; iz < pOctTree->numz; iz++) {
@@ -342,10 +347,14 @@ pick, station, nsta_working,
 
 	while (nSamples < octtreeParams->max_num_nodes) {
 
+//luca
+		if (params->ctx->cancel != NULL && SDL_AtomicGet(params->ctx->cancel))
+			break;
+
 		if (octtreeParams->stop_on_min_node_size) {
-			presult_node = getHighestLeafValue(resultTreeRoot);
+			presult_node = getHighestLeafValue(params->ctx->resultTreeRoot);
 		} else {
-			presult_node = getHighestLeafValueMinSize(resultTreeRoot,
+			presult_node = getHighestLeafValueMinSize(params->ctx->resultTreeRoot,
 				min_node_size_x, min_node_size_y, min_node_size_z);
 		}
 		// check if null node
@@ -407,7 +416,9 @@ pick, station, nsta_working,
 
 
 			// subdivide node and evaluate solution at each child
-			subdivide(neighbor_node, OCTREE_UNDEF_VALUE, NULL);
+//luca
+//			subdivide(neighbor_node, OCTREE_UNDEF_VALUE, NULL);
+			subdivide(neighbor_node, OCTREE_UNDEF_VALUE, NULL, params->ctx->arena);
 
 			for (ix = 0; ix < 2; ix++) {
 				for (iy = 0; iy < 2; iy++) {
@@ -565,7 +576,9 @@ struct Station *station, int nsta_working,
 	HypoDesc Hypo;
 
 
-	pOctTree = InitializeOcttree(Grid, &(params->octtreeParams));
+//luca
+//	pOctTree = InitializeOcttree(Grid, &(params->octtreeParams));
+	pOctTree = InitializeOcttree(Grid, &(params->octtreeParams), params->ctx->arena);
 
 
 	// do octTree search
@@ -586,10 +599,23 @@ f_prob_max = LocOctree(Grid, pick, params->npick, station, nsta_working,
 
 
 	// free octree allocations - IMPORTANT!
-	// free results tree
-	freeResultTree(resultTreeRoot);
-	// free octree memory
-	freeTree3D(pOctTree, 1);
+//luca: the nodes of both trees are released at once by resetting the arena (the octree nodes have no data)
+	if (params->ctx->arena != NULL)
+	{
+		params->ctx->resultTreeRoot = NULL;
+		freeTree3D(pOctTree, 0, params->ctx->arena);
+		resetNodeArena(params->ctx->arena);
+	}
+	else
+	{
+		// free results tree
+		freeResultTree(params->ctx->resultTreeRoot);
+		params->ctx->resultTreeRoot = NULL;
+		// free octree memory
+//luca
+//		freeTree3D(pOctTree, 1);
+		freeTree3D(pOctTree, 1, NULL);
+	}
 //luca
 //	NumAllocations--;
 
@@ -601,7 +627,9 @@ f_prob_max = LocOctree(Grid, pick, params->npick, station, nsta_working,
 
 /** function to initialize Octree search */
 
-Tree3D* InitializeOcttree(GridDesc* ptgrid, OcttreeParams* octtreeParams)
+//luca
+//Tree3D* InitializeOcttree(GridDesc* ptgrid, OcttreeParams* octtreeParams)
+Tree3D* InitializeOcttree(GridDesc* ptgrid, OcttreeParams* octtreeParams, NodeArena* arena)
 {
 
 	double dx, dy, dz;
@@ -616,7 +644,9 @@ Tree3D* InitializeOcttree(GridDesc* ptgrid, OcttreeParams* octtreeParams)
 	newTree = newTree3D(ptgrid->type, octtreeParams->init_num_cells_x,
 			    octtreeParams->init_num_cells_y, octtreeParams->init_num_cells_z,
 			    ptgrid->origx, ptgrid->origy, ptgrid->origz,
-			    dx, dy, dz, OCTREE_UNDEF_VALUE, pdata);
+//luca
+//			    dx, dy, dz, OCTREE_UNDEF_VALUE, pdata);
+			    dx, dy, dz, OCTREE_UNDEF_VALUE, pdata, arena);
 
 	return(newTree);
 
@@ -62,6 +62,8 @@ FILE *ReadCtrlFile (const char *ctrlfilename, struct Control *ctrl)
 //	ctrl->maxrms = 1;
 	ctrl->search_type = SEARCH_GRID;
 	ctrl->pdfcut = -9999;
+//luca
+	ctrl->locgrid.numx = ctrl->locgrid.numy = ctrl->locgrid.numz = 0;
 
 	if ((ctrlfile = fopen (ctrlfilename, "r")) == NULL) {
 		perror (ctrlfilename);
@@ -121,6 +123,15 @@ FILE *ReadCtrlFile (const char *ctrlfilename, struct Control *ctrl)
 		else if ( !strcmp (param, "PDFCUT") )
 			sscanf (line, "%*s %f", &ctrl->pdfcut);
 //luca
+else if ( !strcmp (param, "LOCGRID") ) {
+	if ( sscanf (line, "%*s %d %d %d %lf %lf %lf %lf %lf %lf",
+			&ctrl->locgrid.numx, &ctrl->locgrid.numy, &ctrl->locgrid.numz,
+			&ctrl->locgrid.origx, &ctrl->locgrid.origy, &ctrl->locgrid.origz,
+			&ctrl->locgrid.dx, &ctrl->locgrid.dy, &ctrl->locgrid.dz) != 9 ||
+		ctrl->locgrid.numx < 2 || ctrl->locgrid.numy < 2 || ctrl->locgrid.numz < 2 ||
+		ctrl->locgrid.dx <= 0 || ctrl->locgrid.dy <= 0 || ctrl->locgrid.dz <= 0 )
+		Fatal_Error("RTLoc: LOCGRID must be: numx numy numz origx origy origz dx dy dz (3D, in km) in " + string(ctrlfilename));
+}
 else if ( !strcmp (param, "STA") )
 	nsta++;
 else
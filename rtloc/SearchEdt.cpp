@@ -20,9 +20,10 @@
  */ 
 
 #include "rtloclib.h"
-extern float tnow;
-extern float sigma;
-extern int edt_null;
+//luca: tnow, sigma and edt_null are taken from the search parameters (reentrant)
+//extern float tnow;
+//extern float sigma;
+//extern int edt_null;
 
 	#include "../global.h"
 
@@ -105,6 +106,12 @@ float SearchEdt (GridDesc *Grid, struct Pick *pick, struct Station *station, int
 	prob_max=0.0;
 	f_prob_max = 0.0;
 
+//luca: scratch for the travel times at the node being evaluated (see calcEDTProb)
+	params->ctx->tt_pick = (double *) malloc ((params->npick > 0 ? params->npick : 1) * sizeof(double));
+	params->ctx->tt_sta  = (double *) malloc ((params->nsta  > 0 ? params->nsta  : 1) * sizeof(double));
+	if (params->ctx->tt_pick == NULL || params->ctx->tt_sta == NULL)
+		Fatal_Error("RTLoc: out of memory allocating the travel times scratch");
+
 	/* Call to grid search algorithm */
 	if (params->search_type == SEARCH_GRID) {
 //luca
@@ -148,7 +155,7 @@ LocStat (Grid, f_prob_max, Pgrid, Sgrid, mean, ml_hypo, station, evid, pick, par
 
 //Write grid to disk
 	if ( writeToDisk ) {
-		sprintf (suffix, "ev%2.2d.%05.2f", evid, tnow);
+		sprintf (suffix, "ev%2.2d.%05.2f", evid, params->ctx->tnow);
 //luca
 //		WriteGrid3dBuf(Grid, NULL, params->outfilename, suffix);
 //		fprintf (stderr, "Finished! Output basename: %s.%s\n", params->outfilename, suffix);
@@ -160,6 +167,11 @@ WriteGrid3dBuf(Grid, NULL, const_cast<char*>((sacs_dir + event_name).c_str()), s
 //		LocStat (Grid, f_prob_max, Pgrid, Sgrid, &ml_hypo, station, evid, pick, params);
 	}
 
+//luca
+	free(params->ctx->tt_pick);
+	free(params->ctx->tt_sta);
+	params->ctx->tt_pick = params->ctx->tt_sta = NULL;
+
 	return f_prob_max;
 }
 
@@ -205,6 +217,10 @@ nsta = nsta_working;
 	//xloc = Grid->origx + Grid->dx / 2.0;	// cell centered
 	for (ix=0; ix<numx; ix++) {
 
+//luca
+		if (params->ctx->cancel != NULL && SDL_AtomicGet(params->ctx->cancel))
+			break;
+
 		yloc = Grid->origy;	// grid centered
 		//yloc = Grid->origy + Grid->dy / 2.0;	// cell centered
 		for (iy=0; iy<numy; iy++) {
@@ -248,6 +264,32 @@ nsta = nsta_working;
 }
 
 
+//luca
+/* P travel time of a station at the point being evaluated: from the node-major table if there is one,
+   otherwise from the station grid. Unless the grids differ in geometry, the point is located once per node */
+static inline double ReadPTime (GridDesc *Pgrid, int statid, struct Control *params, const struct GridPoint *pt,
+			   double xloc, double yloc, double zloc, int interpolate)
+{
+	if (params->ptt != NULL)
+		return ReadGridPoint(params->ptt->buffer + statid, pt);
+
+	if (params->pgrid_shared)
+		return ReadGridValue(&(Pgrid[statid]), pt);
+
+	if (Pgrid[statid].type == GRID_TIME_2D)
+		return ReadTimeGrid2d(&(Pgrid[statid]), xloc, yloc, zloc, interpolate);
+
+	/* same as ReadAbsInterpGrid3d (interpolate) or ReadAbsGrid3dValue, also for 16-bit grids */
+//	if (interpolate)
+//		return ReadAbsInterpGrid3d(/*NULL,*/ &(Pgrid[statid]), xloc, yloc, zloc);
+//	else
+//		return ReadAbsGrid3dValue(/*NULL,*/ &(Pgrid[statid]), xloc, yloc, zloc, 1);
+	struct GridPoint pt_sta;
+	SetGridPoint(&(Pgrid[statid]), xloc, yloc, zloc, interpolate, &pt_sta);
+	return ReadGridValue(&(Pgrid[statid]), &pt_sta);
+}
+
+
 /**
    Calculate EDT probability
  *
@@ -276,11 +318,30 @@ INLINE double calcEDTProb (struct Pick *pick, struct Station *station,
 	int npick;
 	int nsta;
 
+//luca
+	struct GridPoint pt;
+	double *tt_pick = params->ctx->tt_pick;
+	double *tt_sta  = params->ctx->tt_sta;
+
 	npick=params->npick;
 	nsta=params->nsta;
 
+//luca: read the travel times at this node once, for the picks and the non-triggering stations.
+//      The loops below then run over these vectors, instead of reading the grids for every pair
+	if (params->ptt != NULL)
+		SetTTPoint(params->ptt, xloc, yloc, zloc, interpolate, &pt);
+	else if (params->pgrid_shared)
+		SetGridPoint(&(Pgrid[0]), xloc, yloc, zloc, interpolate, &pt);
+
+	for (n=0; n<npick; n++) if (pick[n].evid == evid)
+		tt_pick[n] = ReadPTime(Pgrid, pick[n].statid, params, &pt, xloc, yloc, zloc, interpolate);
 
-	*Pmax = prob = (double) edt_null; //cos dimentico tutto quello fatto agli step precedenti! forse posso cambiare
+	if (param_locate_use_non_triggering_stations)
+		for (statid=0; statid<nsta; statid++) if (station[statid].evid[evid] == 0)
+			tt_sta[statid] = ReadPTime(Pgrid, statid, params, &pt, xloc, yloc, zloc, interpolate);
+
+
+	*Pmax = prob = (double) params->edt_null; //cos dimentico tutto quello fatto agli step precedenti! forse posso cambiare
 
 	*ntriggered = 0;	// AJL 20070117
 	*nevaluated=0;
@@ -297,10 +358,12 @@ INLINE double calcEDTProb (struct Pick *pick, struct Station *station,
 		// AJL 20070110
 		//ttA = Read4dBuf (Ptt, ix, iy, numy, iz, numz, pick[n].statid, nsta);
 		//ttA = ReadGrid3dValue (NULL, ix, iy, iz, &(Pgrid[pick[n].statid]));
-		if (interpolate)
-			ttA = ReadAbsInterpGrid3d(/*NULL,*/ &(Pgrid[pick[n].statid]), xloc, yloc, zloc);
-		else
-			ttA = ReadAbsGrid3dValue(/*NULL,*/ &(Pgrid[pick[n].statid]), xloc, yloc, zloc, 1);
+//luca
+//		if (interpolate)
+//			ttA = ReadAbsInterpGrid3d(/*NULL,*/ &(Pgrid[pick[n].statid]), xloc, yloc, zloc);
+//		else
+//			ttA = ReadAbsGrid3dValue(/*NULL,*/ &(Pgrid[pick[n].statid]), xloc, yloc, zloc, 1);
+		ttA = tt_pick[n];
 		// -AJL
 		//if (n == 0)	// AJL 20070116 - Bug fix?  !!!Claudio: Is this now correct?
 			*ntriggered = 1;
@@ -311,12 +374,14 @@ INLINE double calcEDTProb (struct Pick *pick, struct Station *station,
 			// AJL 20070110
 			//ttB = Read4dBuf (Ptt, ix, iy, numy, iz, numz, pick[m].statid, nsta);
 			//ttB = ReadGrid3dValue (NULL, ix, iy, iz, &(Pgrid[pick[m].statid]));
-			if (interpolate)
-				ttB = ReadAbsInterpGrid3d(/*NULL,*/ &(Pgrid[pick[m].statid]), xloc, yloc, zloc);
-			else
-				ttB = ReadAbsGrid3dValue(/*NULL,*/ &(Pgrid[pick[m].statid]), xloc, yloc, zloc, 1);
+//luca
+//			if (interpolate)
+//				ttB = ReadAbsInterpGrid3d(/*NULL,*/ &(Pgrid[pick[m].statid]), xloc, yloc, zloc);
+//			else
+//				ttB = ReadAbsGrid3dValue(/*NULL,*/ &(Pgrid[pick[m].statid]), xloc, yloc, zloc, 1);
+			ttB = tt_pick[m];
 			// -AJL
-			edt = do_edt (ttA, ttB, pick[n].time, pick[m].time);
+			edt = do_edt (ttA, ttB, pick[n].time, pick[m].time, params);
 			(*nevaluated)++;
 			*total_weight += 1.0;	// AJL 20070116
 			//if (n == 0)	// AJL 20070116 - Bug fix?  !!!Claudio: Is this now correct?
@@ -351,12 +416,14 @@ for (statid=0; statid<nsta; statid++) if (station[statid].evid[evid] == 0) {
 			// AJL 20070110
 			//ttB = Read4dBuf (Ptt, ix, iy, numy, iz, numz, statid, nsta);
 			//ttB = ReadGrid3dValue (NULL, ix, iy, iz, &(Pgrid[statid]));
-			if (interpolate)
-				ttB = ReadAbsInterpGrid3d(/*NULL,*/ &(Pgrid[statid]), xloc, yloc, zloc);
-			else
-				ttB = ReadAbsGrid3dValue(/*NULL,*/ &(Pgrid[statid]),  xloc, yloc, zloc, 1);
+//luca
+//			if (interpolate)
+//				ttB = ReadAbsInterpGrid3d(/*NULL,*/ &(Pgrid[statid]), xloc, yloc, zloc);
+//			else
+//				ttB = ReadAbsGrid3dValue(/*NULL,*/ &(Pgrid[statid]),  xloc, yloc, zloc, 1);
+			ttB = tt_sta[statid];
 			// -AJL
-			edt = do_edt (ttA, ttB, pick[n].time, 10000);
+			edt = do_edt (ttA, ttB, pick[n].time, 10000, params);
 			(*nevaluated)++;
 
 			weight = 1.0;
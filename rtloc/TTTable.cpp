@@ -0,0 +1,103 @@
+/*
+ * @file TTTable.cpp travel times of all the stations, node-major
+ *
+ * Copyright (C) 2009-2015 Luca Elia
+ * This file is part of RTLoc, as modified for PRESTo Early Warning System.
+ *
+ * RTLoc is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * RTLoc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with RTLoc; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "rtloclib.h"
+
+
+/*
+   CreateTTTable: copies the travel time grids of nsta stations into a
+   single node-major table. Returns NULL if the grids do not share the
+   same geometry (or are not time grids), or if out of memory.
+   The station grids are left untouched. 16-bit grids are dequantized.
+*/
+struct TTTable *CreateTTTable (GridDesc *grids, int nsta)
+{
+	struct TTTable *ptt;
+	long numnodes, n;
+	int s;
+
+	if (nsta <= 0)
+		return NULL;
+
+	if (!SameGridGeometry(grids, nsta))
+		return NULL;
+
+	ptt = (struct TTTable *) malloc (sizeof(struct TTTable));
+	if (ptt == NULL)
+		return NULL;
+
+	ptt->nsta = nsta;
+	ptt->numx = grids[0].numx;
+	ptt->numy = grids[0].numy;
+	ptt->numz = grids[0].numz;
+	ptt->origx = grids[0].origx;
+	ptt->origy = grids[0].origy;
+	ptt->origz = grids[0].origz;
+	ptt->dx = grids[0].dx;
+	ptt->dy = grids[0].dy;
+	ptt->dz = grids[0].dz;
+
+	numnodes = (long) ptt->numx * ptt->numy * ptt->numz;
+
+	ptt->buffer = (float *) malloc ((size_t) numnodes * nsta * sizeof(float));
+	if (ptt->buffer == NULL) {
+		free (ptt);
+		return NULL;
+	}
+
+	/* Station-major reads, node-major writes */
+	for (s=0; s<nsta; s++) {
+		const float *src = grids[s].buffer;
+		const unsigned short *qsrc = grids[s].qbuffer;
+		float *dst = ptt->buffer + s;
+		if (qsrc != NULL) {
+			for (n=0; n<numnodes; n++)
+				dst[n * nsta] = DequantizeGridValue(&grids[s], qsrc[n]);
+		} else {
+			for (n=0; n<numnodes; n++)
+				dst[n * nsta] = src[n];
+		}
+	}
+
+	return ptt;
+}
+
+
+void FreeTTTable (struct TTTable *ptt)
+{
+	if (ptt == NULL)
+		return;
+
+	free (ptt->buffer);
+	free (ptt);
+}
+
+
+/*
+   SetTTPoint: locates (xloc, yloc, zloc) in the table, once for all
+   the stations. The travel time of a station at this point is then
+   ReadGridPoint(ptt->buffer + statid, ppt) (see GridInterp.h).
+*/
+void SetTTPoint (const struct TTTable *ptt, double xloc, double yloc, double zloc, int interpolate, struct GridPoint *ppt)
+{
+	LocateGridPoint(ptt->numx, ptt->numy, ptt->numz, ptt->origx, ptt->origy, ptt->origz,
+			ptt->dx, ptt->dy, ptt->dz, ptt->nsta, xloc, yloc, zloc, interpolate, ppt);
+}
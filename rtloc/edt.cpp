@@ -20,19 +20,23 @@
 
 #include "rtloclib.h"
 
-extern float tnow;
-extern float sigma;
-extern int edt_null;
+//luca: tnow, sigma and edt_null are taken from the search parameters (reentrant)
+//extern float tnow;
+//extern float sigma;
+//extern int edt_null;
 
 //luca
 //INLINE double do_edt (double tta, double ttb, double ta, double tb)
-extern INLINE double do_edt (double tta, double ttb, double ta, double tb)
+extern INLINE double do_edt (double tta, double ttb, double ta, double tb, const struct Control *params)
 {
 	double edt;
 	double tt1, tt2;
 	double t1, t2;
 	double sigma2;
 
+	const float sigma = params->sigma;
+	const float tnow = params->ctx->tnow;
+
 	sigma2 = sigma * sigma;
 
 	/* Pick order is not important */
@@ -70,7 +74,7 @@ extern INLINE double do_edt (double tta, double ttb, double ta, double tb)
 
 
 	/* If no station has yet triggered, simply do nothing */
-	return (double) edt_null;
+	return (double) params->edt_null;
 }
 
 
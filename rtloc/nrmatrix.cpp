@@ -216,12 +216,13 @@ void 	DisplayDMatrix(char* name, double** matrix, int num_rows, int num_cols)
 /* NOTE!!!! */
 /* 22JUN1998  AJL  changed from 1->N to 0->(N-1) indexing */
 
-static float at,bt,ct;
+//luca: at,bt,ct and maxarg1,maxarg2 are locals of svdcmp0/svdcmp (reentrant)
+//static float at,bt,ct;
 //luca
 #define PYTHAG(a,b) ((at=fabs(a)) > (bt=fabs(b)) ? \
 (ct=bt/at,at*sqrt(1.0f+ct*ct)) : (bt ? (ct=at/bt,bt*sqrt(1.0f+ct*ct)): 0.0f))
 
-static float maxarg1,maxarg2;
+//static float maxarg1,maxarg2;
 #define MAX(a,b) (maxarg1=(a),maxarg2=(b),(maxarg1) > (maxarg2) ?\
 	(maxarg1) : (maxarg2))
 //luca
@@ -237,6 +238,8 @@ float **a, int m, int n, float *w, float **v)
 	float c,f,h,s,x,y,z;
 	float anorm=0.0,g=0.0,scale=0.0;
 //luca
+	float at,bt,ct;
+	float maxarg1,maxarg2;
 	float *rv1/*,*vector()*/;
 //	void nrerror(),free_vector();
 
@@ -529,6 +532,8 @@ float **a, int m, int n, float *w, float **v)
 	float c,f,h,s,x,y,z;
 	float anorm=0.0,g=0.0,scale=0.0;
 //luca
+	float at,bt,ct;
+	float maxarg1,maxarg2;
 	float *rv1/*,*vector()*/;
 //	void nrerror(),free_vector();
 
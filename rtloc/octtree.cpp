@@ -50,15 +50,90 @@ tel: +33(0)493752502  e-mail: anthony@alomax.net  web: http://www.alomax.net
 #include "ran1.h"
 
 
+//luca
+/*** functions of the bump allocator for the nodes of a search ***/
+
+/* allocations are rounded up to this, so that all nodes are aligned as their doubles */
+#define NODE_ARENA_ALIGN	sizeof(double)
+
+/* the first block is block_size bytes (it should hold all the nodes of a typical search), each new one is twice as large */
+void initNodeArena(NodeArena* arena, size_t block_size)
+{
+	arena->first = arena->current = NULL;
+	arena->used = 0;
+	arena->block_size = block_size > 0 ? block_size : 64 * 1024;
+}
+
+/* returns NULL if out of memory */
+void* allocNodeArena(NodeArena* arena, size_t size)
+{
+	NodeArenaBlock* block;
+	void* p;
+
+	size = (size + NODE_ARENA_ALIGN - 1) / NODE_ARENA_ALIGN * NODE_ARENA_ALIGN;
+
+	while (arena->current == NULL || arena->used + size > arena->current->size) {
+		/* next block: kept from before a reset, or a new one */
+		block = (arena->current == NULL) ? arena->first : arena->current->next;
+		if (block == NULL) {
+			if (arena->block_size < size)
+				arena->block_size = size;
+			if ((block = (NodeArenaBlock*) malloc(sizeof(NodeArenaBlock) + arena->block_size)) == NULL)
+				return(NULL);
+			block->next = NULL;
+			block->size = arena->block_size;
+			if (arena->current == NULL)
+				arena->first = block;
+			else
+				arena->current->next = block;
+			arena->block_size *= 2;
+		}
+		arena->current = block;
+		arena->used = 0;
+	}
+
+	p = (char*) (arena->current + 1) + arena->used;
+	arena->used += size;
+	return(p);
+}
+
+/* releases all the nodes at once (O(1)): the blocks are kept for the next search */
+void resetNodeArena(NodeArena* arena)
+{
+	arena->current = NULL;
+	arena->used = 0;
+}
+
+void freeNodeArena(NodeArena* arena)
+{
+	NodeArenaBlock* block;
+
+	while ((block = arena->first) != NULL) {
+		arena->first = block->next;
+		free(block);
+	}
+	arena->current = NULL;
+	arena->used = 0;
+}
+
+
+
 /*** function to create a new OctNode */
 
-OctNode* newOctNode(OctNode* parent, Vect3D center, Vect3D ds, double value, void *pdata)
+//luca
+//OctNode* newOctNode(OctNode* parent, Vect3D center, Vect3D ds, double value, void *pdata)
+OctNode* newOctNode(OctNode* parent, Vect3D center, Vect3D ds, double value, void *pdata, NodeArena* arena)
 {
 
 	int l, m, n;
 	OctNode* node;
 
-	node = (OctNode*) malloc(sizeof(OctNode));
+//luca
+//	node = (OctNode*) malloc(sizeof(OctNode));
+	if (arena != NULL)
+		node = (OctNode*) allocNodeArena(arena, sizeof(OctNode));
+	else
+		node = (OctNode*) malloc(sizeof(OctNode));
 
 	node->parent = parent;
 	node->center = center;
@@ -80,9 +155,13 @@ OctNode* newOctNode(OctNode* parent, Vect3D center, Vect3D ds, double value, voi
 
 /*** function to create a new Tree3D - an x, y, z array of octtree root nodes ***/
 
+//luca
+//Tree3D* newTree3D(int data_code, int numx, int numy, int numz,
+//	double origx, double origy, double origz,
+//	double dx,  double dy,  double dz, double value, void *pdata)
 Tree3D* newTree3D(int data_code, int numx, int numy, int numz,
 	double origx, double origy, double origz,
-	double dx,  double dy,  double dz, double value, void *pdata)
+	double dx,  double dy,  double dz, double value, void *pdata, NodeArena* arena)
 {
 
 	int ix, iy, iz;
@@ -111,7 +190,9 @@ Tree3D* newTree3D(int data_code, int numx, int numy, int numz,
 				return(NULL);
 			for (iz = 0; iz < numz; iz++) {
 				center.z = origz + (double) iz * dz + dz / 2.0;
-				garray[ix][iy][iz] = newOctNode(NULL, center, ds, value, pdata);
+//luca
+//				garray[ix][iy][iz] = newOctNode(NULL, center, ds, value, pdata);
+				garray[ix][iy][iz] = newOctNode(NULL, center, ds, value, pdata, arena);
 			}
 		}
 	}
@@ -138,7 +219,9 @@ Tree3D* newTree3D(int data_code, int numx, int numy, int numz,
 
 /*** function to sudivide a node into child nodes ***/
 
-void subdivide(OctNode* parent, double value, void *pdata) {
+//luca
+//void subdivide(OctNode* parent, double value, void *pdata) {
+void subdivide(OctNode* parent, double value, void *pdata, NodeArena* arena) {
 
 	int ix, iy, iz;
 	Vect3D center, ds;
@@ -157,7 +240,9 @@ void subdivide(OctNode* parent, double value, void *pdata) {
 				center.z = parent->center.z +
 					(double) (2 * iz - 1) * ds.z / 2.0;
 				parent->child[ix][iy][iz] =
-					newOctNode(parent, center, ds, value, pdata);
+//luca
+//					newOctNode(parent, center, ds, value, pdata);
+					newOctNode(parent, center, ds, value, pdata, arena);
 			}
 		}
 	}
@@ -170,7 +255,9 @@ void subdivide(OctNode* parent, double value, void *pdata) {
 
 /*** function to free a Tree3D ***/
 
-void freeTree3D(Tree3D* tree, int freeDataPointer)
+//luca: nodes allocated from an arena are released with it, they are only visited to free their data
+//void freeTree3D(Tree3D* tree, int freeDataPointer)
+void freeTree3D(Tree3D* tree, int freeDataPointer, NodeArena* arena)
 {
 
 	int ix, iy, iz;
@@ -178,12 +265,17 @@ void freeTree3D(Tree3D* tree, int freeDataPointer)
 	for (ix = 0; ix < tree->numx; ix++) {
 		for (iy = 0; iy < tree->numy; iy++) {
 			for (iz = 0; iz < tree->numz; iz++) {
-				freeNode(tree->nodeArray[ix][iy][iz], freeDataPointer);
+//luca
+//				freeNode(tree->nodeArray[ix][iy][iz], freeDataPointer);
+				if (arena == NULL || freeDataPointer)
+					freeNode(tree->nodeArray[ix][iy][iz], freeDataPointer, arena);
 			}
        			free(tree->nodeArray[ix][iy]);
 		}
         	free(tree->nodeArray[ix]);
 	}
+//luca
+	free(tree->nodeArray);
 
 	free(tree);
 
@@ -193,14 +285,18 @@ void freeTree3D(Tree3D* tree, int freeDataPointer)
 
 /*** function to free an OctNode and all its child nodes ***/
 
-void freeNode(OctNode* node, int freeDataPointer) {
+//luca
+//void freeNode(OctNode* node, int freeDataPointer) {
+void freeNode(OctNode* node, int freeDataPointer, NodeArena* arena) {
 
 	int ix, iy, iz;
 	for (ix = 0; ix < 2; ix++) {
 		for (iy = 0; iy < 2; iy++) {
 			for (iz = 0; iz < 2; iz++) {
 				if (node->child[ix][iy][iz] != NULL)
-					freeNode(node->child[ix][iy][iz], freeDataPointer);
+//luca
+//					freeNode(node->child[ix][iy][iz], freeDataPointer);
+					freeNode(node->child[ix][iy][iz], freeDataPointer, arena);
 			}
 		}
 	}
@@ -208,7 +304,10 @@ void freeNode(OctNode* node, int freeDataPointer) {
 	// try to free data
 	if (freeDataPointer)
 		free(node->pdata);
-	free(node);
+//luca
+//	free(node);
+	if (arena == NULL)
+		free(node);
 
 }
 
@@ -325,12 +424,18 @@ int extendedNodeContains(OctNode* node, double x, double y, double z, int checkZ
 
 /*** function to put Octtree node in results tree in order of value */
 
-ResultTreeNode* addResult(ResultTreeNode* prtree, double value, double volume, OctNode* pnode)
+//luca: random numbers from the caller's generator (reentrant)
+//ResultTreeNode* addResult(ResultTreeNode* prtree, double value, double volume, OctNode* pnode)
+//luca: nodes from arena (if not NULL)
+//ResultTreeNode* addResult(ResultTreeNode* prtree, double value, double volume, OctNode* pnode, struct UniState *rand_state)
+ResultTreeNode* addResult(ResultTreeNode* prtree, double value, double volume, OctNode* pnode, struct UniState *rand_state, NodeArena* arena)
 {
 	/* put address in result tree based on value */
 
 	if (prtree == NULL) {	/* at empty node */
-		if ((prtree = (ResultTreeNode* ) malloc(sizeof(ResultTreeNode))) == NULL)
+//luca
+//		if ((prtree = (ResultTreeNode* ) malloc(sizeof(ResultTreeNode))) == NULL)
+		if ((prtree = (ResultTreeNode* ) (arena != NULL ? allocNodeArena(arena, sizeof(ResultTreeNode)) : malloc(sizeof(ResultTreeNode)))) == NULL)
 			fprintf(stderr, "ERROR allocating memory for result-tree node.\n");
 		prtree->value = value;
 		prtree->volume = volume;	// node volume depends on geometry in physical space, may not be dx*dy*dz
@@ -338,16 +443,16 @@ ResultTreeNode* addResult(ResultTreeNode* prtree, double value, double volume, O
 		prtree->left = prtree->right = NULL;
 
 	} else if (value == prtree->value)  {	// prevent assymetric tree if multiple identical values
-		if (get_rand_int(-10000, 9999) < 0)
-			prtree->left = addResult(prtree->left, value, volume, pnode);
+		if (get_rand_int_r(rand_state, -10000, 9999) < 0)
+			prtree->left = addResult(prtree->left, value, volume, pnode, rand_state, arena);
 		else
-			prtree->right = addResult(prtree->right, value, volume, pnode);
+			prtree->right = addResult(prtree->right, value, volume, pnode, rand_state, arena);
 
 	} else if (value < prtree->value)  {
-		prtree->left = addResult(prtree->left, value, volume, pnode);
+		prtree->left = addResult(prtree->left, value, volume, pnode, rand_state, arena);
 
 	} else  {
-		prtree->right = addResult(prtree->right, value, volume, pnode);
+		prtree->right = addResult(prtree->right, value, volume, pnode, rand_state, arena);
 	}
 
 	return (prtree);
@@ -459,7 +564,9 @@ Tree3D* readTree3D(FILE *fpio)
 	if (istat < 6)
 		return(NULL);
 
-	tree = newTree3D(data_code, numx, numy, numz, orig.x, orig.y, orig.z, ds.x, ds.y, ds.z, -1.0, NULL);
+//luca
+//	tree = newTree3D(data_code, numx, numy, numz, orig.x, orig.y, orig.z, ds.x, ds.y, ds.z, -1.0, NULL);
+	tree = newTree3D(data_code, numx, numy, numz, orig.x, orig.y, orig.z, ds.x, ds.y, ds.z, -1.0, NULL, NULL);
 
 	istat_cum = 0;
 	for (ix = 0; ix < tree->numx; ix++) {
@@ -501,7 +608,9 @@ int readNode(FILE *fpio, OctNode* node)
 	if (node->isLeaf)
 		return(1);
 
-	subdivide(node, -1.0, NULL);
+//luca
+//	subdivide(node, -1.0, NULL);
+	subdivide(node, -1.0, NULL, NULL);
 
 	istat_cum = 1;
 
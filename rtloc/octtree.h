@@ -108,6 +108,24 @@ typedef struct resultTreeNode {
 } ResultTreeNode;
 
 
+//luca
+/* bump allocator for the nodes of a search (octree and results tree):
+   nodes are never freed one by one, the whole arena is reset at once */
+
+typedef struct nodeArenaBlock {
+	struct nodeArenaBlock* next;	/* next block, kept after a reset */
+	size_t size;			/* bytes after this header */
+} NodeArenaBlock;
+
+typedef struct
+{
+	NodeArenaBlock* first;		/* blocks, in order of use */
+	NodeArenaBlock* current;	/* block being used (NULL = none yet, or reset) */
+	size_t used;			/* bytes used in current */
+	size_t block_size;		/* size of the next new block */
+} NodeArena;
+
+
 
 /* */
 /*------------------------------------------------------------/ */
@@ -130,18 +148,35 @@ typedef struct resultTreeNode {
 /* function declarations */
 /*------------------------------------------------------------/ */
 
+//luca: nodes are allocated from arena, or with malloc if it is NULL
+//Tree3D* newTree3D(int data_code, int numx, int numy, int numz, 
+//	double origx, double origy, double origz,
+//	double dx,  double dy,  double dz, double value, void *pdata);
+//OctNode* newOctNode(OctNode* parent, Vect3D center, Vect3D ds, double value, void *pdata);
+//void subdivide(OctNode* parent, double value, void *pdata);
+//void freeTree3D(Tree3D* tree, int freeDataPointer);
+//void freeNode(OctNode* node, int freeDataPointer);
 Tree3D* newTree3D(int data_code, int numx, int numy, int numz, 
 	double origx, double origy, double origz,
-	double dx,  double dy,  double dz, double value, void *pdata);
-OctNode* newOctNode(OctNode* parent, Vect3D center, Vect3D ds, double value, void *pdata);
-void subdivide(OctNode* parent, double value, void *pdata);
-void freeTree3D(Tree3D* tree, int freeDataPointer);
-void freeNode(OctNode* node, int freeDataPointer);
+	double dx,  double dy,  double dz, double value, void *pdata, NodeArena* arena);
+OctNode* newOctNode(OctNode* parent, Vect3D center, Vect3D ds, double value, void *pdata, NodeArena* arena);
+void subdivide(OctNode* parent, double value, void *pdata, NodeArena* arena);
+void freeTree3D(Tree3D* tree, int freeDataPointer, NodeArena* arena);
+void freeNode(OctNode* node, int freeDataPointer, NodeArena* arena);
 OctNode* getLeafNodeContaining(Tree3D* tree, Vect3D coords);
 OctNode* getLeafContaining(OctNode* node, double x, double y, double z);
 
-ResultTreeNode* addResult(ResultTreeNode* prtn, double value, double volume, OctNode* pnode);
-void freeResultTree(ResultTreeNode* prtn);
+//luca
+//ResultTreeNode* addResult(ResultTreeNode* prtn, double value, double volume, OctNode* pnode);
+struct UniState;
+//ResultTreeNode* addResult(ResultTreeNode* prtn, double value, double volume, OctNode* pnode, struct UniState *rand_state);
+ResultTreeNode* addResult(ResultTreeNode* prtn, double value, double volume, OctNode* pnode, struct UniState *rand_state, NodeArena* arena);
+void freeResultTree(ResultTreeNode* prtn);	/* only for trees allocated without an arena */
+
+void initNodeArena(NodeArena* arena, size_t block_size);
+void* allocNodeArena(NodeArena* arena, size_t size);
+void resetNodeArena(NodeArena* arena);
+void freeNodeArena(NodeArena* arena);
 ResultTreeNode*  getHighestValue(ResultTreeNode* prtn);
 ResultTreeNode* getHighestLeafValue(ResultTreeNode* prtree);
 ResultTreeNode* getHighestLeafValueMinSize(ResultTreeNode* prtree, double sizeMinX, double sizeMinY, double sizeMinZ);
@@ -0,0 +1,98 @@
+/*
+ * @file quantgrid.cpp
+ *
+ * quantgrid: converts NLLoc time grids to the 16-bit fixed point files read
+ * by RTLoc with locate_quantized_grids = 1 (see GridQuant.cpp)
+ *
+ * Usage: quantgrid <grid> [<grid> ...]
+ * where <grid> is the grid file name without the .hdr / .buf extension.
+ * Writes <grid>.buf16 next to <grid>.buf, and prints the max error.
+ * The .buf16 files must be made again whenever the grids change: each one
+ * records the size and modification time of its .buf, and RTLoc ignores it
+ * (with a warning, quantizing the .buf when loading) if they don't match.
+ * Copy the grids keeping the times (e.g. cp -p), or run quantgrid again.
+ *
+ * Build: make quantgrid (in PRESTo_CB10), or by hand from src/rtloc with:
+ * g++ -O2 -Wno-write-strings -DEXTERN_MODE -DINLINE="" -D_finite=isfinite -I/usr/include/SDL2
+ *     quantgrid.cpp GridLib.cpp GridQuant.cpp GridMap.cpp nrutil.cpp nrmatrix.cpp octtree.cpp
+ *     util.cpp geo.cpp map_project.cpp ran1.cpp -lm -o quantgrid
+ *
+ * Copyright (C) 2009-2015 Luca Elia
+ * This file is part of RTLoc, as modified for PRESTo Early Warning System.
+ *
+ * RTLoc is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * RTLoc is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with RTLoc; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <string>
+#include "rtloclib.h"
+
+// GridLib reports bad grid headers with Fatal_Error, which PRESTo defines in global.cpp
+void Fatal_Error(const std::string & errstr)
+{
+	fprintf(stderr, "%s\n", errstr.c_str());
+	exit(EXIT_FAILURE);
+}
+
+int main (int argc, char **argv)
+{
+	GridDesc grid;
+	FILE *buf, *hdr;
+	int i;
+	double mb;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <grid> [<grid> ...]\n", argv[0]);
+		return 1;
+	}
+
+	SetConstants();
+
+	for (i=1; i<argc; i++) {
+		memset(&grid, 0, sizeof(grid));
+
+		if (OpenGrid3dFile(argv[i], &buf, &hdr, &grid, "time", NULL, 0) < 0) {
+			fprintf(stderr, "%s: can't open grid file\n", argv[i]);
+			return 1;
+		}
+		if (grid.type != GRID_TIME && grid.type != GRID_TIME_2D) {
+			fprintf(stderr, "%s: not a time grid\n", argv[i]);
+			return 1;
+		}
+		if (AllocateGrid(&grid) == NULL || ReadGrid3dBuf(&grid, buf) != 0) {
+			fprintf(stderr, "%s: can't read grid file\n", argv[i]);
+			return 1;
+		}
+		CloseGrid3dFile(&buf, &hdr);
+
+		if (QuantizeGrid(&grid) != 0) {
+			fprintf(stderr, "%s: out of memory\n", argv[i]);
+			return 1;
+		}
+		if (WriteGrid3dBuf16(&grid, argv[i]) != 0) {
+			fprintf(stderr, "%s.buf16: can't write file\n", argv[i]);
+			return 1;
+		}
+
+		mb = (double) grid.numx * grid.numy * grid.numz * sizeof(float) / (1024 * 1024);
+		printf("%s.buf16: %d x %d x %d nodes, %.1f MB -> %.1f MB, max error %.3f ms\n",
+			argv[i], grid.numx, grid.numy, grid.numz, mb, mb / 2, grid.qerror * 1000);
+
+		FreeGrid16(&grid);
+		FreeGrid(&grid);
+	}
+
+	return 0;
+}
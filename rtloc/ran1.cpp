@@ -21,6 +21,14 @@ extern INLINE int get_rand_int(const int imin, const int imax)
 			/ (double) RAND_MAX1 ) );
 }
 
+//luca: same as above, from the generator state s
+int get_rand_int_r(struct UniState *s, const int imin, const int imax)
+{
+
+	return( imin + (int) ( uni_r(s) * (double) (imax - imin + 1)
+			/ (double) RAND_MAX1 ) );
+}
+
 
 /*** function to get random double between xmin and xmax */
 
@@ -178,36 +186,48 @@ INLINE double ran1(int* idum)
  *	Global variables for rstart & uni
  */
 
-double uni_u[98];	/* Was U(97) in Fortran version -- too lazy to fix */
-double uni_c, uni_cd, uni_cm;
-int uni_ui, uni_uj;
+//luca: the state is now a struct, so that uni_r/rstart_r/rinit_r can work on a generator owned by the caller
+//double uni_u[98];	/* Was U(97) in Fortran version -- too lazy to fix */
+//double uni_c, uni_cd, uni_cm;
+//int uni_ui, uni_uj;
+static struct UniState uni_state;
 
 INLINE double uni(void)
+{
+	return uni_r(&uni_state);
+}
+
+double uni_r(struct UniState *s)
 {
 	double luni;			/* local variable for uni */
 
-	luni = uni_u[uni_ui] - uni_u[uni_uj];
+	luni = s->u[s->ui] - s->u[s->uj];
 	if (luni < 0.0)
 		luni += 1.0;
-	uni_u[uni_ui] = luni;
-	if (--uni_ui == 0)
-		uni_ui = 97;
-	if (--uni_uj == 0)
-		uni_uj = 97;
-	if ((uni_c -= uni_cd) < 0.0)
-		uni_c += uni_cm;
-	if ((luni -= uni_c) < 0.0)
+	s->u[s->ui] = luni;
+	if (--s->ui == 0)
+		s->ui = 97;
+	if (--s->uj == 0)
+		s->uj = 97;
+	if ((s->c -= s->cd) < 0.0)
+		s->c += s->cm;
+	if ((luni -= s->c) < 0.0)
 		luni += 1.0;
 	return (double) luni;
 }
 
 INLINE void rstart(int i, int j, int k, int l)
+{
+	rstart_r(&uni_state, i, j, k, l);
+}
+
+void rstart_r(struct UniState *s, int i, int j, int k, int l)
 {
 	int ii, jj, m;
-	double s, t;
+	double sum, t;
 
 	for (ii = 1; ii <= 97; ii++) {
-		s = 0.0;
+		sum = 0.0;
 		t = 0.5;
 		for (jj = 1; jj <= 24; jj++) {
 			m = ((i*j % 179) * k) % 179;
@@ -216,16 +236,16 @@ INLINE void rstart(int i, int j, int k, int l)
 			k = m;
 			l = (53*l+1) % 169;
 			if (l*m % 64 >= 32)
-				s += t;
+				sum += t;
 			t *= 0.5;
 		}
-		uni_u[ii] = s;
+		s->u[ii] = sum;
 	}
-	uni_c  = 362436.0   / 16777216.0;
-	uni_cd = 7654321.0  / 16777216.0;
-	uni_cm = 16777213.0 / 16777216.0;
-	uni_ui = 97;	/*  There is a bug in the original Fortran version */
-	uni_uj = 33;	/*  of UNI -- i and j should be SAVEd in UNI()     */
+	s->c  = 362436.0   / 16777216.0;
+	s->cd = 7654321.0  / 16777216.0;
+	s->cm = 16777213.0 / 16777216.0;
+	s->ui = 97;	/*  There is a bug in the original Fortran version */
+	s->uj = 33;	/*  of UNI -- i and j should be SAVEd in UNI()     */
 }
 
 
@@ -247,6 +267,11 @@ INLINE void rstart(int i, int j, int k, int l)
  */
 
 void rinit(int ijkl)
+{
+	rinit_r(&uni_state, ijkl);
+}
+
+void rinit_r(struct UniState *s, int ijkl)
 {
 	int i, j, k, l, ij, kl;
 
@@ -307,7 +332,7 @@ void rinit(int ijkl)
 /*        printf("rinit: initialising RNG via rstart(%d, %d, %d, %d)\n",
 				i, j, k, l); */
 
-        rstart(i, j, k, l);
+        rstart_r(s, i, j, k, l);
 
 }
 
@@ -77,3 +77,18 @@ INLINE double ran1(int* idum);
 INLINE double uni(void);
 INLINE void rstart(int i, int j, int k, int l);
 void rinit(int ijkl);
+
+//luca: reentrant UNI, each user (e.g. a location search) owns its generator state
+#ifndef UNI_STATE_DEF
+#define UNI_STATE_DEF
+struct UniState {
+	double u[98];
+	double c, cd, cm;
+	int ui, uj;
+};
+#endif
+
+double uni_r(struct UniState *s);
+void rstart_r(struct UniState *s, int i, int j, int k, int l);
+void rinit_r(struct UniState *s, int ijkl);
+int get_rand_int_r(struct UniState *s, const int imin, const int imax);
@@ -25,6 +25,9 @@
 #include <ctype.h>
 #include <math.h>
 
+//luca
+#include "SDL_atomic.h"
+
 #include "GridLib.h"
 
 #define LINEBUFSIZE 120
@@ -65,6 +68,37 @@ struct Station {
 	SourceDesc desc; 
 };
 
+//luca
+/* Travel times of all the stations in a single buffer, node-major and station-minor: the times of a grid node
+   for all the stations are contiguous, so that evaluating a node reads a few cache lines per trilinear corner
+   instead of touching nsta separate grids. The grids must share the same geometry (see TTTable.cpp) */
+struct TTTable {
+	float *buffer;						/* numx * numy * numz * nsta */
+	int nsta;
+	int numx, numy, numz;
+	double origx, origy, origz;
+	double dx, dy, dz;
+};
+
+//luca
+/* Location grid geometry (LOCGRID in the control file). numx = 0 if not given: the first P grid is used */
+struct LocGrid {
+	int numx, numy, numz;
+	double origx, origy, origz;
+	double dx, dy, dz;
+};
+
+//luca
+/* State of a single location search, so that several searches can run at once (on different threads) */
+struct SearchContext {
+	float tnow;							/* current time, relative to the first pick */
+	ResultTreeNode *resultTreeRoot;		/* octtree likelihood*volume results tree root node */
+	struct UniState rand;				/* random numbers for the octtree */
+	double *tt_pick, *tt_sta;			/* P travel times at the node being evaluated, of each pick and station (allocated by SearchEdt) */
+	SDL_atomic_t *cancel;				/* if not NULL, the search stops early when set (the result is discarded) */
+	NodeArena *arena;					/* nodes of the octtree and results tree, reset after the search (NULL = malloc each node) */
+};
+
 struct Control {
 //luca
 //	char outfilename[80];
@@ -87,6 +121,12 @@ struct Control {
 	OcttreeParams octtreeParams;		/* Octtree parameters */
 	// -AJL
 	float pdfcut;
+//luca
+	int edt_null;						/* edt when no station has triggered yet: 0 for sum, 1 for mul */
+	struct TTTable *ptt;				/* P travel times of all the stations, node-major (NULL = use the station grids) */
+	int pgrid_shared;					/* the P grids of the stations share the same geometry (see GridInterp.h) */
+	struct LocGrid locgrid;				/* location grid, needed with 2D travel time grids */
+	struct SearchContext *ctx;			/* state of the search in progress */
 };
 
 
@@ -100,7 +140,9 @@ int GetSearchType(char* line1, struct Control *ctrl);
 
 int stat_lookup (struct Station *sta, int nsta, char *stname);
 
-INLINE double do_edt (double tta, double ttb, double ta, double tb);
+//luca
+//INLINE double do_edt (double tta, double ttb, double ta, double tb);
+INLINE double do_edt (double tta, double ttb, double ta, double tb, const struct Control *params);
 //luca
 //INLINE double normalize (double edt, int nsta);
 INLINE double normalize (double edt, double nsta);
@@ -130,6 +172,28 @@ int nsta_working,
 
 void initLocGrid (GridDesc *prototype, GridDesc *locgrid);
 
+//luca
+/* TTTable.cpp */
+struct TTTable *CreateTTTable (GridDesc *grids, int nsta);
+void FreeTTTable (struct TTTable *ptt);
+void SetTTPoint (const struct TTTable *ptt, double xloc, double yloc, double zloc, int interpolate, struct GridPoint *ppt);
+
+//luca
+/* GridMap.cpp */
+void *MapFileView (const char *fname, size_t size);
+void UnmapFileView (void *p, size_t size);
+float *MapGrid3dBuf (GridDesc *pgrid, const char *fname);
+void UnmapGrid3dBuf (GridDesc *pgrid);
+
+//luca
+/* GridQuant.cpp */
+int QuantizeGrid (GridDesc *pgrid);
+int WriteGrid3dBuf16 (const GridDesc *pgrid, const char *fname);
+unsigned short *ReadGrid3dBuf16 (GridDesc *pgrid, const char *fname);
+unsigned short *MapGrid3dBuf16 (GridDesc *pgrid, const char *fname);
+void FreeGrid16 (GridDesc *pgrid);
+void UnmapGrid3dBuf16 (GridDesc *pgrid);
+
 void printlog (const char *format, ...);
 void printstat (const char *format, ...);
 
@@ -151,5 +215,7 @@ double LocOctree(GridDesc *Grid, struct Pick *pick, int npick, struct Station *s
 //luca
 //double OctTreeSearch(GridDesc *Grid, struct Pick *pick, struct Station *station, GridDesc *Pgrid, GridDesc *Sgrid, int evid, struct Control *params, int *nevaluated, double *prob_max, Vect3D *ml_hypo);
 double OctTreeSearch(GridDesc *Grid, struct Pick *pick, struct Station *station, int nsta_working, GridDesc *Pgrid, GridDesc *Sgrid, int evid, struct Control *params, int *nevaluated, double *prob_max, Vect3D *ml_hypo);
-Tree3D *InitializeOcttree(GridDesc *ptgrid, OcttreeParams *octtreeParams);
+//luca
+//Tree3D *InitializeOcttree(GridDesc *ptgrid, OcttreeParams *octtreeParams);
+Tree3D *InitializeOcttree(GridDesc *ptgrid, OcttreeParams *octtreeParams, NodeArena *arena);
 
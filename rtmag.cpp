@@ -107,6 +107,43 @@ rtmag_t :: ~rtmag_t()
 	delete [] gr;
 }
 
+rtmag_t :: rtmag_t(const rtmag_t & other)
+:	samples(NULL), buffer(NULL), gr(NULL)
+{
+	*this = other;
+}
+
+rtmag_t & rtmag_t :: operator=(const rtmag_t & other)
+{
+	if (this == &other)
+		return *this;
+
+	m_min		=	other.m_min;
+	m_max		=	other.m_max;
+	m_step		=	other.m_step;
+	num_samples	=	other.num_samples;
+
+	delete [] samples;
+	delete [] buffer;
+	delete [] gr;
+	samples = buffer = gr = NULL;
+
+	if (other.gr != NULL)
+	{
+		samples	=	new double[num_samples];
+		buffer	=	new double[num_samples];
+		gr		=	new double[num_samples];
+
+		memcpy(samples,	other.samples,	num_samples * sizeof(samples[0]));
+		memcpy(buffer,	other.buffer,	num_samples * sizeof(buffer[0]));
+		memcpy(gr,		other.gr,		num_samples * sizeof(gr[0]));
+	}
+
+	inputs = other.inputs;
+
+	return *this;
+}
+
 void rtmag_t :: ClearPeaks()
 {
 	inputs.clear();
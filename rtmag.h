@@ -87,6 +87,10 @@ public:
 	rtmag_t();
 	~rtmag_t();
 
+	// Deep copies, so that each thread can compute magnitudes on its own rtmag_t
+	rtmag_t(const rtmag_t & other);
+	rtmag_t & operator=(const rtmag_t & other);
+
 	void Init(double _m_min, double _m_max, double _m_step, const string & filename);
 
 	void ClearPeaks();
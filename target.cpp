@@ -56,7 +56,7 @@ target_t :: target_t(const string & _fullname, const string & _name, bool _shown
 }
 
 targets_t :: targets_t()
-:	sock(NULL), pack(NULL)
+:	sock(NULL), pack(NULL), mutex(SDL_CreateMutex())
 {
 }
 
@@ -67,6 +67,9 @@ targets_t :: ~targets_t()
 
 	SDLNet_FreePacket(pack);
 	pack = NULL;
+
+	SDL_DestroyMutex(mutex);
+	mutex = NULL;
 }
 
 void targets_t :: SendAlarm(const string & s, const IPaddress * const ipaddress)
@@ -79,6 +82,8 @@ void targets_t :: SendAlarm(const string & s, const IPaddress * const ipaddress)
 
 	int len = min(int(s.length()), ALARM_DATA_SIZE);
 
+	Lock();
+
 	pack->len = len;
 	memcpy(pack->data, s.data(), len);
 
@@ -95,6 +100,8 @@ void targets_t :: SendAlarm(const string & s, const IPaddress * const ipaddress)
 		// Send to all targets
 		numsent = SDLNet_UDP_Send(sock, ALARM_CHAN, pack);
 	}
+
+	Unlock();
 }
 
 void targets_t :: Load(const string & filename)
@@ -30,6 +30,7 @@
 #include <string>
 #include <vector>
 #include "SDL_net.h"
+#include "SDL_thread.h"
 
 #include "global.h"
 
@@ -62,6 +63,19 @@ private:
 	UDPsocket sock;
 	UDPpacket *pack;
 
+	SDL_mutex *mutex;	// the packet is shared by the threads sending alarms
+
+	void Lock()
+	{
+		if (mutex)
+			SDL_LockMutex(mutex);
+	}
+	void Unlock()
+	{
+		if (mutex)
+			SDL_UnlockMutex(mutex);
+	}
+
 public:
 
 	targets_t();
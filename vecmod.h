@@ -0,0 +1,322 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	Vector module kernels
+
+	Squared module of up to three components and the position of its maximum,
+	computed in a single pass (SSE when available). Taking the square root of
+	the peak only gives the peak module without a sqrt per sample.
+
+	alignedbuf_t is a growable float buffer whose samples can be placed
+	so that a given index falls on a 16-byte boundary, letting the kernels
+	use aligned loads on the requested time window.
+
+	FindFirstAbsAtLeast scans a packet for clipped samples.
+
+*******************************************************************************/
+
+#ifndef VECMOD_H_DEF
+#define VECMOD_H_DEF
+
+#include <cstddef>
+#include <cmath>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+/*******************************************************************************
+
+	alignedbuf_t
+
+*******************************************************************************/
+
+class alignedbuf_t
+{
+public:
+
+	enum { ALIGN_FLOATS = 4 };		// 16 bytes
+
+	alignedbuf_t() : mem(NULL), size(0)	{ }
+	~alignedbuf_t()						{ delete [] mem; }
+
+	// The contents are scratch: copies start empty and assignment keeps the own buffer
+	alignedbuf_t(const alignedbuf_t &) : mem(NULL), size(0)	{ }
+	alignedbuf_t & operator=(const alignedbuf_t &)			{ return *this; }
+
+	// Return room for num samples, with the sample at index skip being 16-byte aligned
+	float *Get(int num, int skip)
+	{
+		int needed = num + 2 * ALIGN_FLOATS;
+		if (needed > size)
+		{
+			delete [] mem;
+			size	=	needed + needed / 2;
+			mem		=	new float[size];
+		}
+
+		size_t misalign	=	(size_t(mem) / sizeof(float)) % ALIGN_FLOATS;
+		float *aligned	=	mem + (ALIGN_FLOATS - misalign) % ALIGN_FLOATS;
+
+		return aligned + (ALIGN_FLOATS - skip % ALIGN_FLOATS) % ALIGN_FLOATS;
+	}
+
+private:
+
+	float *mem;
+	int size;
+};
+
+/*******************************************************************************
+
+	Squared module kernels: out[i] = a[i]^2 (+ b[i]^2 (+ c[i]^2)).
+	out may be one of the inputs. Return the index of the (first) maximum
+	of out (0 if num is 0).
+
+*******************************************************************************/
+
+inline bool IsAligned16(const float *p)
+{
+	return (size_t(p) & 15) == 0;
+}
+
+#ifdef __SSE__
+// Running maximum of each of 4 lanes and the index of the sample where it was found.
+// The indices are kept as floats, exact below 2^24 samples
+struct vecpeak_t
+{
+	__m128 vpeak, vidx, vi;
+
+	vecpeak_t(int i) : vpeak(_mm_setzero_ps()), vidx(_mm_setzero_ps()), vi(_mm_setr_ps(float(i), float(i+1), float(i+2), float(i+3)))	{ }
+
+	// v holds the samples i..i+3, the next call gets i+4..i+7
+	void Update(__m128 v)
+	{
+		__m128 m = _mm_cmpgt_ps(v, vpeak);
+		vpeak	=	_mm_max_ps(vpeak, v);
+		vidx	=	_mm_or_ps(_mm_and_ps(m, vi), _mm_andnot_ps(m, vidx));
+		vi		=	_mm_add_ps(vi, _mm_set1_ps(4.0f));
+	}
+
+	// Merge the lanes into peak / peak_i, keeping the first index among equal maxima
+	void Reduce(float & peak, int & peak_i) const
+	{
+		float p[4], idx[4];
+		_mm_storeu_ps(p, vpeak);
+		_mm_storeu_ps(idx, vidx);
+		for (int k = 0; k < 4; k++)
+		{
+			if (p[k] > peak || (p[k] == peak && int(idx[k]) < peak_i))
+			{
+				peak	=	p[k];
+				peak_i	=	int(idx[k]);
+			}
+		}
+	}
+};
+#endif
+
+inline int SqrModulusMax(float *out, const float *a, const float *b, const float *c, int num)
+{
+	float peak = 0;
+	int peak_i = 0;
+	int i = 0;
+
+#ifdef __SSE__
+	// Scalar samples until out is aligned
+	for (; i < num && !IsAligned16(out + i); i++)
+	{
+		out[i] = a[i]*a[i] + b[i]*b[i] + c[i]*c[i];
+		if (out[i] > peak)	{ peak = out[i]; peak_i = i; }
+	}
+
+	int num4 = i + ((num - i) & ~3);
+	if (i < num4)
+	{
+		vecpeak_t vpeak(i);
+		if (IsAligned16(a + i) && IsAligned16(b + i) && IsAligned16(c + i))
+		{
+			for (; i < num4; i += 4)
+			{
+				__m128 va = _mm_load_ps(a + i), vb = _mm_load_ps(b + i), vc = _mm_load_ps(c + i);
+				__m128 v  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(va,va), _mm_mul_ps(vb,vb)), _mm_mul_ps(vc,vc));
+				_mm_store_ps(out + i, v);
+				vpeak.Update(v);
+			}
+		}
+		else
+		{
+			for (; i < num4; i += 4)
+			{
+				__m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i), vc = _mm_loadu_ps(c + i);
+				__m128 v  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(va,va), _mm_mul_ps(vb,vb)), _mm_mul_ps(vc,vc));
+				_mm_store_ps(out + i, v);
+				vpeak.Update(v);
+			}
+		}
+
+		vpeak.Reduce(peak, peak_i);
+	}
+#endif
+
+	for (; i < num; i++)
+	{
+		out[i] = a[i]*a[i] + b[i]*b[i] + c[i]*c[i];
+		if (out[i] > peak)	{ peak = out[i]; peak_i = i; }
+	}
+
+	return peak_i;
+}
+
+inline int SqrModulusMax(float *out, const float *a, const float *b, int num)
+{
+	float peak = 0;
+	int peak_i = 0;
+	int i = 0;
+
+#ifdef __SSE__
+	for (; i < num && !IsAligned16(out + i); i++)
+	{
+		out[i] = a[i]*a[i] + b[i]*b[i];
+		if (out[i] > peak)	{ peak = out[i]; peak_i = i; }
+	}
+
+	int num4 = i + ((num - i) & ~3);
+	if (i < num4)
+	{
+		vecpeak_t vpeak(i);
+		if (IsAligned16(a + i) && IsAligned16(b + i))
+		{
+			for (; i < num4; i += 4)
+			{
+				__m128 va = _mm_load_ps(a + i), vb = _mm_load_ps(b + i);
+				__m128 v  = _mm_add_ps(_mm_mul_ps(va,va), _mm_mul_ps(vb,vb));
+				_mm_store_ps(out + i, v);
+				vpeak.Update(v);
+			}
+		}
+		else
+		{
+			for (; i < num4; i += 4)
+			{
+				__m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i);
+				__m128 v  = _mm_add_ps(_mm_mul_ps(va,va), _mm_mul_ps(vb,vb));
+				_mm_store_ps(out + i, v);
+				vpeak.Update(v);
+			}
+		}
+
+		vpeak.Reduce(peak, peak_i);
+	}
+#endif
+
+	for (; i < num; i++)
+	{
+		out[i] = a[i]*a[i] + b[i]*b[i];
+		if (out[i] > peak)	{ peak = out[i]; peak_i = i; }
+	}
+
+	return peak_i;
+}
+
+inline int SqrModulusMax(float *out, const float *a, int num)
+{
+	float peak = 0;
+	int peak_i = 0;
+	int i = 0;
+
+#ifdef __SSE__
+	for (; i < num && !IsAligned16(out + i); i++)
+	{
+		out[i] = a[i]*a[i];
+		if (out[i] > peak)	{ peak = out[i]; peak_i = i; }
+	}
+
+	int num4 = i + ((num - i) & ~3);
+	if (i < num4)
+	{
+		vecpeak_t vpeak(i);
+		if (IsAligned16(a + i))
+		{
+			for (; i < num4; i += 4)
+			{
+				__m128 va = _mm_load_ps(a + i);
+				__m128 v  = _mm_mul_ps(va,va);
+				_mm_store_ps(out + i, v);
+				vpeak.Update(v);
+			}
+		}
+		else
+		{
+			for (; i < num4; i += 4)
+			{
+				__m128 va = _mm_loadu_ps(a + i);
+				__m128 v  = _mm_mul_ps(va,va);
+				_mm_store_ps(out + i, v);
+				vpeak.Update(v);
+			}
+		}
+
+		vpeak.Reduce(peak, peak_i);
+	}
+#endif
+
+	for (; i < num; i++)
+	{
+		out[i] = a[i]*a[i];
+		if (out[i] > peak)	{ peak = out[i]; peak_i = i; }
+	}
+
+	return peak_i;
+}
+
+/*******************************************************************************
+
+	Return the index of the first sample with abs(s[i]) >= threshold, or -1
+
+*******************************************************************************/
+
+inline int FindFirstAbsAtLeast(const float *s, int num, float threshold)
+{
+	int i = 0;
+
+#ifdef __SSE__
+	// Skip groups of 4 samples below the threshold, then find the exact one below
+	const __m128 vsign	=	_mm_set1_ps(-0.0f);
+	const __m128 vthr	=	_mm_set1_ps(threshold);
+
+	int num4 = num & ~3;
+	for (; i < num4; i += 4)
+	{
+		__m128 v = _mm_andnot_ps(vsign, _mm_loadu_ps(s + i));
+		if (_mm_movemask_ps(_mm_cmpge_ps(v, vthr)))
+			break;
+	}
+#endif
+
+	for (; i < num; i++)
+		if (std::fabs(s[i]) >= threshold)
+			return i;
+
+	return -1;
+}
+
+#endif
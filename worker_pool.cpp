@@ -0,0 +1,199 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	Threads to run jobs on (see worker_pool.h)
+
+*******************************************************************************/
+
+#include <algorithm>
+
+#include "worker_pool.h"
+
+using namespace std;
+
+worker_pool_t :: worker_pool_t()
+:	exitThreads(false), mutex(NULL), cond_jobs(NULL), cond_done(NULL)
+{
+}
+
+worker_pool_t :: ~worker_pool_t()
+{
+	Stop();
+}
+
+void worker_pool_t :: Start(int num_threads, const string & name)
+{
+	Stop();
+
+	mutex		=	SDL_CreateMutex();
+	cond_jobs	=	SDL_CreateCond();
+	cond_done	=	SDL_CreateCond();
+	if (mutex == NULL || cond_jobs == NULL || cond_done == NULL)
+		Fatal_Error("Can't create " + name + " worker pool mutex");
+
+	exitThreads = false;
+
+	threads.resize(num_threads);
+	for (int i = 0; i < num_threads; i++)
+	{
+		thread_t & t = threads[i];
+		t.pool		=	this;
+		t.worker	=	i + 1;
+		t.thread	=	SDL_CreateThread( Thread_Func, (name + ToString(t.worker)).c_str(), &t );
+		if (t.thread == NULL)
+			Fatal_Error("Can't create " + name + " worker thread");
+	}
+}
+
+void worker_pool_t :: Stop()
+{
+	if (mutex == NULL)
+		return;
+
+	// Let the threads finish the queued jobs, then exit
+	Lock();
+	exitThreads = true;
+	SDL_CondBroadcast(cond_jobs);
+	Unlock();
+
+	for (size_t i = 0; i < threads.size(); i++)
+		SDL_WaitThread(threads[i].thread, NULL);
+	threads.clear();
+
+	SDL_DestroyCond(cond_done);
+	SDL_DestroyCond(cond_jobs);
+	SDL_DestroyMutex(mutex);
+	cond_done = cond_jobs = NULL;
+	mutex = NULL;
+}
+
+int worker_pool_t :: Thread_Func(void *data)
+{
+	thread_t *t = (thread_t *)data;
+	t->pool->Update(t->worker);
+	return 0;
+}
+
+void worker_pool_t :: Update(int worker)
+{
+	Lock();
+
+	for (;;)
+	{
+		while (jobs.empty() && !exitThreads)
+			SDL_CondWait(cond_jobs, mutex);
+
+		if (jobs.empty())
+			break;
+
+		job_t job = jobs.front();
+		jobs.pop_front();
+
+		if (job.batch != NULL)
+		{
+			RunBatch(*job.batch, worker);
+
+			--job.batch->helpers;
+			SDL_CondBroadcast(cond_done);
+		}
+		else
+		{
+			Unlock();
+			job.func(job.arg, worker);
+			Lock();
+		}
+	}
+
+	Unlock();
+}
+
+// Take the arguments of a batch one at a time, until there are none left. Called with the mutex locked
+void worker_pool_t :: RunBatch(batch_t & b, int worker)
+{
+	while (b.next < b.num_args)
+	{
+		void *arg = b.args[b.next++];
+
+		Unlock();
+		b.func(arg, worker);
+		Lock();
+	}
+}
+
+void worker_pool_t :: Run(job_func_t func, void * const *args, int num_args)
+{
+	if (num_args <= 0)
+		return;
+
+	if (threads.empty())
+	{
+		for (int i = 0; i < num_args; i++)
+			func(args[i], 0);
+		return;
+	}
+
+	batch_t b;
+	b.func		=	func;
+	b.args		=	args;
+	b.num_args	=	num_args;
+	b.next		=	0;
+	b.helpers	=	min(num_args - 1, int(threads.size()));
+
+	Lock();
+
+	for (int i = 0; i < b.helpers; i++)
+		jobs.push_back( job_t(NULL, NULL, &b) );
+	SDL_CondBroadcast(cond_jobs);
+
+	RunBatch(b, 0);
+
+	// Drop the helpers that no thread picked up yet (e.g. all busy with submitted jobs)
+	for (deque<job_t>::iterator j = jobs.begin(); j != jobs.end(); )
+	{
+		if (j->batch == &b)
+		{
+			j = jobs.erase(j);
+			--b.helpers;
+		}
+		else
+			++j;
+	}
+
+	// Wait for the arguments taken by the threads
+	while (b.helpers > 0)
+		SDL_CondWait(cond_done, mutex);
+
+	Unlock();
+}
+
+void worker_pool_t :: Submit(job_func_t func, void *arg)
+{
+	if (threads.empty())
+	{
+		func(arg, 0);
+		return;
+	}
+
+	Lock();
+	jobs.push_back( job_t(func, arg, NULL) );
+	SDL_CondSignal(cond_jobs);
+	Unlock();
+}
@@ -0,0 +1,116 @@
+/*******************************************************************************
+ This file is part of PRESTo Early Warning System
+ Copyright (C) 2009-2015 Luca Elia
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*******************************************************************************/
+
+/*******************************************************************************
+
+	worker_pool_t - A few threads to run jobs on
+
+	Jobs are a function and an argument, and are passed the index of the
+	worker running them (0 is the thread calling Run, 1..NumWorkers()-1 are
+	the pool threads), so that each worker can use its own scratch state.
+
+	Run is fork-join: it runs a function on a set of arguments, using the
+	pool threads and the calling thread, and returns when all are done.
+	Submit queues a job for the pool threads and returns at once.
+
+*******************************************************************************/
+
+#ifndef WORKER_POOL_H_DEF
+#define WORKER_POOL_H_DEF
+
+#include <vector>
+#include <deque>
+#include "SDL_thread.h"
+
+#include "global.h"
+
+class worker_pool_t
+{
+public:
+
+	typedef void (*job_func_t)(void *arg, int worker);
+
+private:
+
+	// Arguments of a Run call
+	struct batch_t
+	{
+		job_func_t func;
+		void * const *args;
+		int num_args;
+		int next;		// first argument not taken yet
+		int helpers;	// pool threads (queued or running) helping with the batch
+	};
+
+	struct job_t
+	{
+		job_func_t func;
+		void *arg;
+		batch_t *batch;	// if not NULL, help with this batch instead
+
+		job_t(job_func_t _func, void *_arg, batch_t *_batch) : func(_func), arg(_arg), batch(_batch)	{ }
+	};
+
+	struct thread_t
+	{
+		worker_pool_t *pool;
+		int worker;
+		SDL_Thread *thread;
+	};
+
+	std::vector<thread_t> threads;
+	std::deque<job_t> jobs;
+
+	bool exitThreads;
+
+	SDL_mutex *mutex;
+	SDL_cond *cond_jobs;	// new jobs or exiting
+	SDL_cond *cond_done;	// a helper finished with its batch
+
+	void Lock()		{ SDL_LockMutex(mutex);		}
+	void Unlock()	{ SDL_UnlockMutex(mutex);	}
+
+	void RunBatch(batch_t & b, int worker);
+
+	static int Thread_Func(void *data);
+	void Update(int worker);
+
+	// non copyable
+	worker_pool_t(const worker_pool_t &);
+	worker_pool_t & operator=(const worker_pool_t &);
+
+public:
+
+	worker_pool_t();
+	~worker_pool_t();
+
+	// Create the threads (none: jobs run on the thread calling Run)
+	void Start(int num_threads, const string & name);
+	void Stop();
+
+	int NumWorkers() const	{ return int(threads.size()) + 1; }
+
+	// Run func on all the args, return when all are done
+	void Run(job_func_t func, void * const *args, int num_args);
+
+	// Queue func(arg) for a pool thread (or run it now if there are none)
+	void Submit(job_func_t func, void *arg);
+};
+
+#endif